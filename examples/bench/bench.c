@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libdragon.h>
+#include <system.h>
+
+static resolution_t res = RESOLUTION_320x240;
+static bitdepth_t bit = DEPTH_32_BPP;
+
+/* Number of iterations for each benchmark */
+#define ITERATIONS 10000
+
+/* Files kept open while benchmarking so lookups can't get lucky */
+#define EXTRA_FILES 50
+
+/* Loop iterations of work interrupted while measuring interrupt cost */
+#define SPIN_ITERATIONS 2000000
+
+/* Ticks between timer interrupts while measuring interrupt cost */
+#define INTERRUPT_PERIOD 1000
+
+/* Timestamps read while timer callbacks take their own */
+#define TIMESTAMP_READS 200000
+
+/* Save store writes measured, and the keys and record size they cycle through */
+#define SAVE_WRITES 2000
+#define SAVE_KEYS 16
+#define SAVE_RECORD 100
+
+/* Power cuts tried on the save store, and the bytes written between them */
+#define SAVE_CUTS 500
+#define SAVE_CUT_STEP 7
+
+/* A filesystem that does no work, so only the syscall layer is measured */
+static int null_file;
+
+static void *null_open( char *name, int flags )
+{
+    return &null_file;
+}
+
+static int null_read( void *file, uint8_t *ptr, int len )
+{
+    return len;
+}
+
+static int null_lseek( void *file, int ptr, int dir )
+{
+    return 0;
+}
+
+static int null_close( void *file )
+{
+    return 0;
+}
+
+static filesystem_t null_fs = {
+    .open = null_open,
+    .read = null_read,
+    .lseek = null_lseek,
+    .close = null_close,
+};
+
+static int bench_fd;
+static FILE *bench_fp;
+
+/* One byte read() straight into the syscall layer */
+static void bench_read( void )
+{
+    char c;
+
+    for( int i = 0; i < ITERATIONS; i++ )
+    {
+        read( bench_fd, &c, 1 );
+    }
+}
+
+/* Seek without moving, the cheapest call there is */
+static void bench_lseek( void )
+{
+    for( int i = 0; i < ITERATIONS; i++ )
+    {
+        lseek( bench_fd, 0, SEEK_CUR );
+    }
+}
+
+/* Small fread() calls going through the stdio buffer */
+static void bench_fread( void )
+{
+    char buf[4];
+
+    for( int i = 0; i < ITERATIONS; i++ )
+    {
+        fread( buf, 1, sizeof(buf), bench_fp );
+    }
+}
+
+/* Opening and closing a file */
+static void bench_open_close( void )
+{
+    for( int i = 0; i < ITERATIONS; i++ )
+    {
+        close( open( "null:/file", O_RDONLY ) );
+    }
+}
+
+static volatile int interrupts;
+
+static void count_interrupt( int ovfl )
+{
+    interrupts++;
+}
+
+/* Fixed amount of work, returning the ticks it took */
+static unsigned long spin( void )
+{
+    long long start = timer_ticks_fast();
+
+    for( volatile int i = 0; i < SPIN_ITERATIONS; i++ ) { }
+
+    return timer_ticks_fast() - start;
+}
+
+static volatile long long last_stamp;
+static volatile int stamps_backwards;
+
+/* Takes a timestamp, counting it if it is older than the last one */
+static void stamp( void )
+{
+    long long now = timer_ticks_fast();
+
+    if( now < last_stamp ) { stamps_backwards++; }
+    last_stamp = now;
+}
+
+static void stamp_interrupt( int ovfl )
+{
+    stamp();
+}
+
+/* Timestamps from timer callbacks and the code they interrupt must agree,
+   returning how many went backwards */
+static int bench_timestamps( void )
+{
+    stamps_backwards = 0;
+    last_stamp = timer_ticks_fast();
+
+    timer_link_t *timer = new_timer( INTERRUPT_PERIOD, TF_CONTINUOUS, stamp_interrupt );
+
+    for( int i = 0; i < TIMESTAMP_READS; i++ )
+    {
+        /* The callback must not land between reading and storing */
+        disable_interrupts();
+        stamp();
+        enable_interrupts();
+    }
+
+    delete_timer( timer );
+
+    return stamps_backwards;
+}
+
+/* CPU cycles each timer interrupt adds to the same work */
+static unsigned long bench_interrupt( int fpu_save )
+{
+    set_interrupt_fpu_save( fpu_save );
+
+    unsigned long base = spin();
+
+    interrupts = 0;
+    timer_link_t *timer = new_timer( INTERRUPT_PERIOD, TF_CONTINUOUS, count_interrupt );
+    unsigned long loaded = spin();
+    delete_timer( timer );
+
+    set_interrupt_fpu_save( 1 );
+
+    /* The count register runs at half the CPU clock */
+    return interrupts ? (loaded - base) * 2 / interrupts : 0;
+}
+
+/* A RAM medium laid out like FlashRAM */
+static uint8_t save_mem[131072];
+static save_media_t save_media;
+
+/* Writes to the save store, returning the ticks per write */
+static unsigned long bench_save( save_stats_t *stats )
+{
+    uint8_t data[SAVE_RECORD];
+
+    save_media_ram( &save_media, save_mem, sizeof(save_mem), 16384, 128, 1 );
+    save_format( &save_media );
+
+    long long start = timer_ticks_fast();
+
+    for( int i = 0; i < SAVE_WRITES; i++ )
+    {
+        memset( data, i, sizeof(data) );
+        save_write( i % SAVE_KEYS, data, sizeof(data) );
+    }
+
+    unsigned long ticks = timer_ticks_fast() - start;
+
+    save_get_stats( stats );
+
+    return ticks / SAVE_WRITES;
+}
+
+/* Cuts power partway through writes, returning how many lost a key */
+static int bench_save_power_loss( void )
+{
+    uint8_t data[SAVE_RECORD];
+    uint8_t check[SAVE_RECORD];
+    int lost = 0;
+
+    for( int i = 0; i < SAVE_CUTS; i++ )
+    {
+        int key = i % SAVE_KEYS;
+
+        save_read( key, check, sizeof(check) );
+        memset( data, ~i, sizeof(data) );
+
+        save_media_ram_cut( i * SAVE_CUT_STEP );
+        save_write( key, data, sizeof(data) );
+        save_media_ram_cut( SAVE_NO_CUT );
+
+        uint8_t old = check[0];
+
+        /* Power comes back, the key has to hold either value */
+        if( save_mount( &save_media ) != SAVE_ESUCCESS ||
+            save_read( key, check, sizeof(check) ) != sizeof(check) ||
+            (check[0] != old && check[0] != data[0]) )
+        {
+            lost++;
+        }
+    }
+
+    return lost;
+}
+
+typedef struct
+{
+    const char *name;
+    void (*run)( void );
+} bench_t;
+
+static const bench_t benchmarks[] = {
+    { "read 1 byte", bench_read },
+    { "lseek", bench_lseek },
+    { "fread 4 bytes", bench_fread },
+    { "open+close", bench_open_close },
+};
+
+#define NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+int main(void)
+{
+    static unsigned long ticks[NUM_BENCHMARKS];
+
+    /* enable interrupts (on the CPU) */
+    init_interrupts();
+
+    /* Initialize peripherals */
+    display_init( res, bit, 2, GAMMA_NONE, ANTIALIAS_RESAMPLE );
+    console_init();
+
+    console_set_render_mode(RENDER_MANUAL);
+
+    timer_init();
+
+    attach_filesystem( "null:/", &null_fs );
+
+    for( int i = 0; i < EXTRA_FILES; i++ )
+    {
+        open( "null:/file", O_RDONLY );
+    }
+
+    bench_fd = open( "null:/file", O_RDONLY );
+    bench_fp = fopen( "null:/file", "rb" );
+
+    for( int i = 0; i < NUM_BENCHMARKS; i++ )
+    {
+        long long start = timer_ticks_fast();
+        benchmarks[i].run();
+        ticks[i] = timer_ticks_fast() - start;
+    }
+
+    unsigned long with_fpu = bench_interrupt( 1 );
+    unsigned long without_fpu = bench_interrupt( 0 );
+    int backwards = bench_timestamps();
+
+    save_stats_t save_stats;
+    unsigned long save_ticks = bench_save( &save_stats );
+    int save_lost = bench_save_power_loss();
+
+    console_clear();
+
+    printf( "Syscall overhead, %d iterations\n\n", ITERATIONS );
+    printf( "%-16s %10s %8s\n", "test", "ticks/op", "ns/op" );
+
+    for( int i = 0; i < NUM_BENCHMARKS; i++ )
+    {
+        unsigned long per_op = ticks[i] / ITERATIONS;
+
+        printf( "%-16s %10lu %8lu\n", benchmarks[i].name, per_op,
+                (unsigned long)((unsigned long long)ticks[i] * 1000000000ULL / COUNTS_PER_SECOND / ITERATIONS) );
+    }
+
+    printf( "\nInterrupt entry and exit\n\n" );
+    printf( "%-16s %10s\n", "mode", "cycles" );
+    printf( "%-16s %10lu\n", "save FPU", with_fpu );
+    printf( "%-16s %10lu\n", "integer only", without_fpu );
+    printf( "%-16s %10d\n", "stamps backward", backwards );
+
+    printf( "\nSave store, %d byte records on RAM\n\n", SAVE_RECORD );
+    printf( "%-16s %10lu\n", "ticks/write", save_ticks );
+    printf( "%-16s %10lu\n", "bytes written", (unsigned long)save_stats.bytes_written );
+    printf( "%-16s %10lu\n", "relocations", (unsigned long)save_stats.relocations );
+    printf( "%-16s %6d/%d\n", "lost in cuts", save_lost, SAVE_CUTS );
+
+    console_render();
+
+    while(1) {}
+}
@@ -86,7 +86,17 @@
 #define CI_STAT_USB_WR_IDLE				0x0
 #define CI_STAT_USB_WR_BUSY				0xF
 
+//
+// USB data types, telling the host how to treat the data
+//
+
+#define USB_DATATYPE_TEXT				0x01
+#define USB_DATATYPE_BINARY				0x02
+
+uint32_t _64Drive_usb_status_write();
 void _64Drive_usb_spin_write();
+int _64Drive_usb_write_data(const void *data, int len, int datatype);
+int _64Drive_usb_write_async(const void *data, int len);
 void _64Drive_putstring(char *str);
 uint32_t _64Drive_wait();
 void _64Drive_rom_writable(uint32_t enable);
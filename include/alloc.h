@@ -0,0 +1,156 @@
+/**
+ * @file alloc.h
+ * @brief Memory Allocators
+ * @ingroup alloc
+ */
+#ifndef __LIBDRAGON_ALLOC_H
+#define __LIBDRAGON_ALLOC_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup alloc
+ * @{
+ */
+
+/** @brief Size of a data cache line, which DMA buffers are aligned to */
+#define ALLOC_CACHE_LINE    16
+
+/** @brief Size of an RDRAM bank in bytes */
+#define RDRAM_BANK_SIZE     ( 1024 * 1024 )
+
+/** @brief Let #bank_heap_alloc place the allocation in any bank */
+#define BANK_ANY            -1
+
+/** @brief Offset of the upper 4 MiB of RDRAM added by an Expansion Pak */
+#define HIGH_RAM_OFFSET     ( 4 * 1024 * 1024 )
+/** @brief First RDRAM bank of the Expansion Pak */
+#define HIGH_RAM_BANK       ( HIGH_RAM_OFFSET / RDRAM_BANK_SIZE )
+
+/**
+ * @brief Allocator statistics
+ */
+typedef struct
+{
+    /** @brief Bytes managed by the allocator */
+    uint32_t size;
+    /** @brief Bytes currently allocated, including per-allocation overhead */
+    uint32_t used;
+    /** @brief Largest value #used has reached */
+    uint32_t high_water;
+    /** @brief Number of successful allocations */
+    uint32_t allocs;
+    /** @brief Number of frees, or resets for an arena */
+    uint32_t frees;
+    /** @brief Number of allocations that could not be satisfied */
+    uint32_t failures;
+    /** @brief Number of separate free blocks */
+    uint32_t free_blocks;
+    /** @brief Size of the largest free block */
+    uint32_t largest_free;
+    /** @brief Percentage of free memory that is outside the largest free block */
+    int fragmentation;
+} alloc_stats_t;
+
+/**
+ * @brief Bump allocator
+ *
+ * Allocations are carved one after the other out of a fixed buffer and
+ * are all released at once with #arena_reset, typically once per frame.
+ */
+typedef struct
+{
+    /** @brief Start of the buffer */
+    uint8_t *base;
+    /** @brief Size of the buffer in bytes */
+    uint32_t size;
+    /** @brief Bytes handed out since the last reset */
+    uint32_t used;
+    /** @brief Nonzero if the buffer was allocated by #arena_init */
+    int owned;
+    /** @brief Statistics */
+    alloc_stats_t stats;
+} arena_t;
+
+/**
+ * @brief Pool of fixed size objects
+ */
+typedef struct
+{
+    /** @brief Start of the object storage */
+    uint8_t *base;
+    /** @brief Size of each object in bytes, rounded up to 8 */
+    uint32_t obj_size;
+    /** @brief Number of objects in the pool */
+    uint32_t count;
+    /** @brief First free object */
+    void *free_list;
+    /** @brief Nonzero if the storage was allocated by #pool_init */
+    int owned;
+    /** @brief Statistics */
+    alloc_stats_t stats;
+} pool_t;
+
+/**
+ * @brief Heap of cache line aligned blocks with RDRAM bank placement
+ *
+ * Every block starts and ends on a cache line boundary, so invalidating
+ * the cache around a DMA transfer never touches unrelated data.  Blocks
+ * can be placed in a specific RDRAM bank, so that buffers accessed at the
+ * same time, like a framebuffer being drawn by the RDP and data used by
+ * the CPU, don't compete for the same bank.
+ */
+typedef struct
+{
+    /** @brief Start of the managed memory */
+    uint8_t *base;
+    /** @brief Size of the managed memory in bytes */
+    uint32_t size;
+    /** @brief Free blocks, sorted by address */
+    struct bank_block *free_list;
+    /** @brief Nonzero if the memory was allocated by #bank_heap_init */
+    int owned;
+    /** @brief Statistics, the free block counts are only updated on request */
+    alloc_stats_t stats;
+} bank_heap_t;
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int arena_init( arena_t *arena, void *buffer, uint32_t size );
+void *arena_alloc( arena_t *arena, uint32_t size, uint32_t align );
+void arena_reset( arena_t *arena );
+void arena_close( arena_t *arena );
+void arena_get_stats( arena_t *arena, alloc_stats_t *stats );
+
+int pool_init( pool_t *pool, uint32_t obj_size, uint32_t count, void *buffer );
+void *pool_alloc( pool_t *pool );
+void pool_free( pool_t *pool, void *obj );
+void pool_close( pool_t *pool );
+void pool_get_stats( pool_t *pool, alloc_stats_t *stats );
+
+int bank_heap_init( bank_heap_t *heap, void *base, uint32_t size );
+void *bank_heap_alloc( bank_heap_t *heap, uint32_t size, int bank );
+void bank_heap_free( bank_heap_t *heap, void *ptr );
+void bank_heap_close( bank_heap_t *heap );
+void bank_heap_get_stats( bank_heap_t *heap, alloc_stats_t *stats );
+
+int dma_heap_init( uint32_t size );
+void *dma_alloc( uint32_t size, int bank );
+void dma_free( void *ptr );
+void dma_heap_get_stats( alloc_stats_t *stats );
+
+int high_heap_init( void );
+void *high_alloc( uint32_t size, int bank );
+void high_free( void *ptr );
+int high_heap_contains( const void *ptr );
+void high_heap_get_stats( alloc_stats_t *stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file crash.h
+ * @brief Crash Reporter
+ * @ingroup crash
+ */
+#ifndef __LIBDRAGON_CRASH_H
+#define __LIBDRAGON_CRASH_H
+
+#include <stdint.h>
+#include "exception.h"
+
+/**
+ * @addtogroup crash
+ * @{
+ */
+
+/** @brief Magic number at the start of a crash report, "N64C" */
+#define CRASH_MAGIC             0x4E363443
+/** @brief Version of the crash report layout */
+#define CRASH_VERSION           1
+
+/** @brief Most stack frames recorded in a report */
+#define CRASH_MAX_FRAMES        16
+/** @brief Instruction words recorded around the faulting instruction */
+#define CRASH_CODE_WORDS        8
+/** @brief Words recorded from the top of the stack */
+#define CRASH_STACK_WORDS       64
+
+/** @brief Print the report through stdio, to the console if it is open */
+#define CRASH_OUTPUT_CONSOLE    0x01
+/** @brief Send the report to the host over 64drive USB */
+#define CRASH_OUTPUT_USB        0x02
+/** @brief Save the report to EEPROM for reading after a reboot */
+#define CRASH_OUTPUT_EEPROM     0x04
+
+/** @brief Number of 8 byte EEPROM blocks a report takes */
+#define CRASH_EEPROM_BLOCKS     (sizeof(crash_report_t) / 8)
+
+/**
+ * @brief A crash report
+ *
+ * Reports are written in the N64's byte order, and all addresses and
+ * registers are stored as their low 32 bits.
+ */
+typedef struct
+{
+    /** @brief #CRASH_MAGIC */
+    uint32_t magic;
+    /** @brief #CRASH_VERSION */
+    uint16_t version;
+    /** @brief Number of valid entries in frames */
+    uint16_t num_frames;
+    /** @brief CP0 Cause register */
+    uint32_t cause;
+    /** @brief Address of the faulting instruction */
+    uint32_t epc;
+    /** @brief CP0 BadVAddr register */
+    uint32_t badvaddr;
+    /** @brief CP0 Status register */
+    uint32_t sr;
+    /** @brief General purpose registers, gpr[n] holding register $n */
+    uint32_t gpr[32];
+    /** @brief HI */
+    uint32_t hi;
+    /** @brief LO */
+    uint32_t lo;
+    /** @brief Backtrace, frames[0] is the faulting instruction and the rest
+               are the calls leading to it, innermost first */
+    uint32_t frames[CRASH_MAX_FRAMES];
+    /** @brief Code around the faulting instruction, which is code[CRASH_CODE_WORDS / 2] */
+    uint32_t code[CRASH_CODE_WORDS];
+    /** @brief Stack contents starting at the stack pointer */
+    uint32_t stack[CRASH_STACK_WORDS];
+} crash_report_t;
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void crash_init( int outputs, int eeprom_block );
+void crash_close( void );
+void crash_capture( const reg_block_t *regs, crash_report_t *report );
+int crash_unwind( uint32_t pc, uint32_t sp, uint32_t ra, uint32_t *frames, int max );
+void crash_print( const crash_report_t *report );
+int crash_send_usb( const crash_report_t *report );
+void crash_save_eeprom( const crash_report_t *report, int block );
+int crash_load_eeprom( crash_report_t *report, int block );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file ctors.h
+ * @brief C++ constructor handling
+ * @ingroup system
+ */
+#ifndef __LIBDRAGON_CTORS_H
+#define __LIBDRAGON_CTORS_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup system
+ * @{
+ */
+
+/** @brief Number of slowest constructors kept for #ctors_get_stats */
+#define CTORS_SLOWEST       8
+
+/**
+ * @brief Time one global constructor took
+ */
+typedef struct
+{
+    /** @brief The constructor, look it up with n64crash -a */
+    void (*func)( void );
+    /** @brief CP0 Count ticks it took, see #COUNTS_PER_SECOND */
+    uint32_t ticks;
+} ctor_time_t;
+
+/**
+ * @brief Timing of the global constructors run at startup
+ */
+typedef struct
+{
+    /** @brief Number of constructors */
+    uint32_t count;
+    /** @brief Ticks all of them took */
+    uint32_t total_ticks;
+    /** @brief The slowest ones, slowest first, unused entries have no func */
+    ctor_time_t slowest[CTORS_SLOWEST];
+} ctors_stats_t;
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ctors_get_stats( ctors_stats_t *stats );
+void ctors_print_report( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
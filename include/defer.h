@@ -0,0 +1,57 @@
+/**
+ * @file defer.h
+ * @brief Deferred Work
+ * @ingroup defer
+ */
+#ifndef __LIBDRAGON_DEFER_H
+#define __LIBDRAGON_DEFER_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup defer
+ * @{
+ */
+
+/** @brief Number of work items that can be waiting at once */
+#define DEFER_QUEUE_SIZE    64
+
+/**
+ * @brief Function run as deferred work
+ *
+ * @param[in] arg
+ *            Argument given to #defer_work
+ */
+typedef void (*defer_func_t)( void *arg );
+
+/**
+ * @brief Deferred work statistics
+ */
+typedef struct
+{
+    /** @brief Work items queued */
+    uint32_t queued;
+    /** @brief Work items run */
+    uint32_t run;
+    /** @brief Work items refused because the queue was full */
+    uint32_t dropped;
+    /** @brief Most work items waiting at once */
+    uint32_t high_water;
+} defer_stats_t;
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int defer_work( defer_func_t func, void *arg );
+int defer_pending( void );
+void defer_poll( void );
+void defer_get_stats( defer_stats_t *stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -64,6 +64,15 @@ typedef struct open_file
     uint32_t loc;
     /** @brief The sector number of the current sector */
     uint32_t sector_number;
+    /** @brief Pointer to the current sector */
+    file_entry_t *sector_loc;
+    /**
+     * @brief Nonzero if only the link of the cached sector is valid
+     *
+     * Set after sectors were read straight into the caller's buffer, so
+     * the data is only fetched if it is actually needed.
+     */
+    uint32_t sector_stale;
     /** 
      * @brief Padding
      * 
@@ -71,7 +80,7 @@ typedef struct open_file
      * not being on a 8 byte aligned boundary, so I just aligned it to 512
      * bytes. 
      */
-    uint8_t padding[236];
+    uint8_t padding[228];
 } open_file_t;
 
 /** @} */ /* dfs */
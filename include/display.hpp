@@ -0,0 +1,132 @@
+/**
+ * @file display.hpp
+ * @brief C++ Display Handles
+ * @ingroup cpp
+ */
+#ifndef __LIBDRAGON_DISPLAY_HPP
+#define __LIBDRAGON_DISPLAY_HPP
+
+#include "display.h"
+
+namespace dragon
+{
+
+/**
+ * @addtogroup cpp
+ * @{
+ */
+
+/**
+ * @brief The display subsystem, set up for as long as the object lives
+ */
+class display_system
+{
+public:
+    /** @brief Call #display_init with the same arguments */
+    display_system( resolution_t res, bitdepth_t bit, uint32_t num_buffers, gamma_t gamma, antialias_t aa )
+    {
+        display_init( res, bit, num_buffers, gamma, aa );
+    }
+
+    /** @brief Call #display_close */
+    ~display_system()
+    {
+        display_close();
+    }
+
+    display_system( const display_system & ) = delete;
+    display_system &operator=( const display_system & ) = delete;
+};
+
+/**
+ * @brief A display buffer locked for drawing
+ *
+ * The buffer is shown when the frame is destroyed, if #show was not called
+ * before, since showing it is the only way to hand it back.  Frames can be
+ * moved but not copied, so a buffer is never shown twice.
+ */
+class frame
+{
+public:
+    /** @brief Lock a buffer with #display_lock, check with operator bool */
+    frame() : disp( display_lock() ) {}
+
+    /** @brief Take over a display context locked with #display_lock */
+    explicit frame( display_context_t disp ) : disp( disp ) {}
+
+    /** @brief Take over the buffer of another frame */
+    frame( frame &&other ) : disp( other.release() ) {}
+
+    /** @brief Show the current buffer and take over that of another frame */
+    frame &operator=( frame &&other )
+    {
+        if( this != &other )
+        {
+            show();
+            disp = other.release();
+        }
+
+        return *this;
+    }
+
+    frame( const frame & ) = delete;
+    frame &operator=( const frame & ) = delete;
+
+    ~frame()
+    {
+        show();
+    }
+
+    /**
+     * @brief Wait until a buffer can be locked
+     */
+    static frame wait()
+    {
+        display_context_t disp;
+
+        while( !(disp = display_lock()) ) { ; }
+
+        return frame( disp );
+    }
+
+    /** @brief Return whether a buffer is locked */
+    explicit operator bool() const { return disp != 0; }
+
+    /** @brief Return the display context, for the C drawing functions */
+    display_context_t get() const { return disp; }
+
+    /**
+     * @brief Show the buffer on the next vblank with #display_show
+     */
+    void show()
+    {
+        if( disp )
+        {
+            display_show( disp );
+            disp = 0;
+        }
+    }
+
+    /**
+     * @brief Give up the buffer without showing it
+     *
+     * @return The display context, which the caller now has to show
+     */
+    display_context_t release()
+    {
+        display_context_t ret = disp;
+
+        disp = 0;
+        return ret;
+    }
+
+private:
+    /** @brief Locked display context, or 0 */
+    display_context_t disp;
+};
+
+/** @} */
+
+}
+
+#endif
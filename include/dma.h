@@ -12,6 +12,7 @@ extern "C" {
 
 void dma_write(void * ram_address, unsigned long pi_address, unsigned long len);
 void dma_read(void * ram_address, unsigned long pi_address, unsigned long len);
+int dma_write_start(void * ram_address, unsigned long pi_address, unsigned long len);
 volatile int dma_busy();
 
 /* 32 bit IO read from PI device */
@@ -6,6 +6,8 @@
 #ifndef __LIBDRAGON_DRAGONFS_H
 #define __LIBDRAGON_DRAGONFS_H
 
+#include <stdint.h>
+
 /** 
  * @addtogroup dfs
  * @{
@@ -75,6 +77,28 @@
 #define FLAGS_EOF           0x2
 /** @} */
 
+/** @brief Have #dfs_dir_read descend into subdirectories */
+#define DFS_DIR_RECURSIVE   0x1
+
+/**
+ * @brief Directory entry returned by #dfs_dir_read
+ */
+typedef struct
+{
+    /** @brief Name of the file or directory, without its path */
+    char name[MAX_FILENAME_LEN+1];
+    /** @brief Either #FLAGS_FILE or #FLAGS_DIR */
+    int type;
+    /** @brief Size of the file in bytes, or 0 for a directory */
+    uint32_t size;
+    /** @brief Offset of the first sector of a file, or first entry of a directory, from the filesystem start */
+    uint32_t offset;
+    /** @brief Depth below the directory that was read, 0 for its own entries */
+    int depth;
+    /** @brief Index of the entry of the containing directory, or -1 at depth 0 */
+    int parent;
+} dfs_dirent_t;
+
 /** @} */
 
 #ifdef __cplusplus
@@ -85,6 +109,7 @@ int dfs_init(uint32_t base_fs_loc);
 int dfs_chdir(const char * const path);
 int dfs_dir_findfirst(const char * const path, char *buf);
 int dfs_dir_findnext(char *buf);
+int dfs_dir_read(const char * const path, dfs_dirent_t *entries, int max_entries, int flags);
 
 int dfs_open(const char * const path);
 int dfs_read(void * const buf, int size, int count, uint32_t handle);
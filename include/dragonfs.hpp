@@ -0,0 +1,135 @@
+/**
+ * @file dragonfs.hpp
+ * @brief C++ DragonFS Handles
+ * @ingroup cpp
+ */
+#ifndef __LIBDRAGON_DRAGONFS_HPP
+#define __LIBDRAGON_DRAGONFS_HPP
+
+#include "dragonfs.h"
+
+namespace dragon
+{
+
+/**
+ * @addtogroup cpp
+ * @{
+ */
+
+/**
+ * @brief A file opened with #dfs_open
+ *
+ * The file is closed when the object is destroyed, so returning early does
+ * not leak the handle.  Files can be moved but not copied.
+ */
+class dfs_file
+{
+public:
+    /** @brief Create an object with no file open */
+    dfs_file() : handle( 0 ) {}
+
+    /**
+     * @brief Open a file, check with operator bool and #error
+     *
+     * @param[in] path
+     *            Path of the file, as passed to #dfs_open
+     */
+    explicit dfs_file( const char *path ) : handle( dfs_open( path ) ) {}
+
+    /** @brief Take over the file of another object */
+    dfs_file( dfs_file &&other ) : handle( other.release() ) {}
+
+    /** @brief Close the current file and take over that of another object */
+    dfs_file &operator=( dfs_file &&other )
+    {
+        if( this != &other )
+        {
+            close();
+            handle = other.release();
+        }
+
+        return *this;
+    }
+
+    dfs_file( const dfs_file & ) = delete;
+    dfs_file &operator=( const dfs_file & ) = delete;
+
+    ~dfs_file()
+    {
+        close();
+    }
+
+    /** @brief Return whether a file is open */
+    explicit operator bool() const { return handle > 0; }
+
+    /** @brief Return the error opening the file, or #DFS_ESUCCESS */
+    int error() const { return handle < 0 ? handle : DFS_ESUCCESS; }
+
+    /** @brief Return the handle, for the C functions */
+    int get() const { return handle; }
+
+    /**
+     * @brief Read bytes with #dfs_read
+     *
+     * @return The number of bytes read or a negative error
+     */
+    int read( void *buf, int len ) { return dfs_read( buf, 1, len, handle ); }
+
+    /**
+     * @brief Read an object of a fixed size
+     *
+     * @return The number of bytes read or a negative error
+     */
+    template <typename T>
+    int read( T &out ) { return dfs_read( &out, 1, sizeof(T), handle ); }
+
+    /** @brief Seek with #dfs_seek */
+    int seek( int offset, int origin ) { return dfs_seek( handle, offset, origin ); }
+
+    /** @brief Return the position with #dfs_tell */
+    int tell() const { return dfs_tell( handle ); }
+
+    /** @brief Return the size with #dfs_size */
+    int size() const { return dfs_size( handle ); }
+
+    /** @brief Return whether the end was reached with #dfs_eof */
+    bool eof() const { return dfs_eof( handle ) != 0; }
+
+    /**
+     * @brief Close the file now
+     *
+     * @return #DFS_ESUCCESS or the error from #dfs_close
+     */
+    int close()
+    {
+        int ret = DFS_ESUCCESS;
+
+        if( handle > 0 ) { ret = dfs_close( handle ); }
+
+        handle = 0;
+        return ret;
+    }
+
+    /**
+     * @brief Give up the file without closing it
+     *
+     * @return The handle, which the caller now has to close
+     */
+    int release()
+    {
+        int ret = handle;
+
+        handle = 0;
+        return ret;
+    }
+
+private:
+    /** @brief Handle from #dfs_open, 0 if none or a negative error */
+    int handle;
+};
+
+/** @} */
+
+}
+
+#endif
@@ -33,7 +33,7 @@ enum
  */
 typedef volatile struct
 {
-    /** @brief General purpose registers 1-32 */
+    /** @brief General purpose registers, gpr[n] holding register $n */
 	volatile uint64_t gpr[32];
     /** @brief SR */
 	volatile uint32_t sr;
@@ -45,7 +45,7 @@ typedef volatile struct
 	volatile uint64_t lo;
     /** @brief FC31 */
 	volatile uint64_t fc31;
-    /** @brief Floating point registers 1-32 */
+    /** @brief Floating point registers, not saved by integer only interrupts */
 	volatile uint64_t fpr[32];
 } reg_block_t;
 
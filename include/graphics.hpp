@@ -0,0 +1,59 @@
+/**
+ * @file graphics.hpp
+ * @brief C++ Color Packing
+ * @ingroup cpp
+ */
+#ifndef __LIBDRAGON_GRAPHICS_HPP
+#define __LIBDRAGON_GRAPHICS_HPP
+
+#include <stdint.h>
+#include "display.h"
+#include "graphics.h"
+
+namespace dragon
+{
+
+/**
+ * @addtogroup cpp
+ * @{
+ */
+
+/**
+ * @brief Pack a color for a 16 bit display, as #graphics_make_color does
+ *
+ * The 5-5-5-1 color is repeated in both halves, so it can also be used as
+ * an RDP fill color.
+ */
+constexpr uint32_t make_color16( int r, int g, int b, int a )
+{
+    return ((((r & 0xFF) >> 3) << 11) | (((g & 0xFF) >> 3) << 6) | (((b & 0xFF) >> 3) << 1) | ((a & 0xFF) >> 7)) * 0x10001u;
+}
+
+/**
+ * @brief Pack a color for a 32 bit display, as #graphics_make_color does
+ */
+constexpr uint32_t make_color32( int r, int g, int b, int a )
+{
+    return ((uint32_t)(r & 0xFF) << 24) | ((uint32_t)(g & 0xFF) << 16) | ((uint32_t)(b & 0xFF) << 8) | (uint32_t)(a & 0xFF);
+}
+
+/**
+ * @brief Pack a color for a display of a known bit depth
+ *
+ * Unlike #graphics_make_color, which looks up the bit depth the display was
+ * set up with, this folds to a constant when the components are constants.
+ *
+ * @tparam Depth
+ *         Bit depth passed to #display_init
+ */
+template <bitdepth_t Depth>
+constexpr uint32_t make_color( int r, int g, int b, int a )
+{
+    return Depth == DEPTH_16_BPP ? make_color16( r, g, b, a ) : make_color32( r, g, b, a );
+}
+
+/** @} */
+
+}
+
+#endif
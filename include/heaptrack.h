@@ -0,0 +1,119 @@
+/**
+ * @file heaptrack.h
+ * @brief Heap Tracking
+ * @ingroup heaptrack
+ */
+#ifndef __LIBDRAGON_HEAPTRACK_H
+#define __LIBDRAGON_HEAPTRACK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+/**
+ * @addtogroup heaptrack
+ * @{
+ */
+
+/** @brief Number of distinct allocation call sites that can be tracked */
+#define HEAP_TRACK_MAX_SITES    128
+/** @brief Number of live allocations that can be tracked */
+#define HEAP_TRACK_MAX_ALLOCS   1024
+/** @brief Number of frames kept for the per frame histogram */
+#define HEAP_TRACK_FRAMES       64
+/** @brief Number of power of two buckets in the histograms */
+#define HEAP_TRACK_BUCKETS      16
+
+/**
+ * @brief Statistics for one allocation call site
+ */
+typedef struct
+{
+    /** @brief Source file of the call, or null if unknown */
+    const char *file;
+    /** @brief Source line of the call */
+    int line;
+    /** @brief Number of allocations from this site still live */
+    uint32_t live_count;
+    /** @brief Bytes allocated from this site still live */
+    uint32_t live_bytes;
+    /** @brief Largest value #live_bytes has reached */
+    uint32_t peak_bytes;
+    /** @brief Number of allocations ever made from this site */
+    uint32_t total_count;
+} heap_track_site_t;
+
+/**
+ * @brief Overall heap tracking statistics
+ */
+typedef struct
+{
+    /** @brief Number of live allocations */
+    uint32_t live_count;
+    /** @brief Bytes in live allocations */
+    uint32_t live_bytes;
+    /** @brief Largest value #live_bytes has reached */
+    uint32_t peak_bytes;
+    /** @brief Number of allocations made */
+    uint32_t allocs;
+    /** @brief Number of tracked allocations freed */
+    uint32_t frees;
+    /** @brief Number of allocations that failed */
+    uint32_t failures;
+    /** @brief Allocations that could not be tracked because a table was full */
+    uint32_t dropped;
+    /** @brief Number of frames ended with #heap_track_frame */
+    uint32_t frame;
+    /** @brief Number of allocations made in the current frame */
+    uint32_t frame_allocs;
+    /** @brief Bytes allocated in the current frame */
+    uint32_t frame_bytes;
+} heap_track_stats_t;
+
+/**
+ * @brief Callback that receives one line of a report at a time
+ *
+ * Both puts style console output and #_64Drive_putstring fit.
+ */
+typedef void (*heap_track_output_t)( char *line );
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void heap_track_reset( void );
+void *heap_track_malloc( size_t size, const char *file, int line );
+void *heap_track_calloc( size_t count, size_t size, const char *file, int line );
+void *heap_track_realloc( void *ptr, size_t size, const char *file, int line );
+void *heap_track_memalign( size_t align, size_t size, const char *file, int line );
+char *heap_track_strdup( const char *str, const char *file, int line );
+void heap_track_free( void *ptr );
+void heap_track_frame( void );
+uint32_t heap_track_checkpoint( void );
+void heap_track_get_stats( heap_track_stats_t *stats );
+int heap_track_get_site( int index, heap_track_site_t *site );
+int heap_track_leaks( uint32_t checkpoint, heap_track_output_t output );
+void heap_track_report( heap_track_output_t output );
+
+#ifdef __cplusplus
+}
+#endif
+
+/*
+ * Building with HEAP_TRACK defined routes the allocation calls of every C
+ * file that includes this header through the tracker, recording the call
+ * site.  C++ code would break on std::malloc and friends, so it is left out.
+ */
+#if defined(HEAP_TRACK) && !defined(__HEAP_TRACK_INTERNAL) && !defined(__cplusplus)
+#define malloc(size)            heap_track_malloc( (size), __FILE__, __LINE__ )
+#define calloc(count, size)     heap_track_calloc( (count), (size), __FILE__, __LINE__ )
+#define realloc(ptr, size)      heap_track_realloc( (ptr), (size), __FILE__, __LINE__ )
+#define memalign(align, size)   heap_track_memalign( (align), (size), __FILE__, __LINE__ )
+#define strdup(str)             heap_track_strdup( (str), __FILE__, __LINE__ )
+#define free(ptr)               heap_track_free( (ptr) )
+#endif
+
+#endif
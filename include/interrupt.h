@@ -6,6 +6,8 @@
 #ifndef __LIBDRAGON_INTERRUPT_H
 #define __LIBDRAGON_INTERRUPT_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,6 +30,222 @@ typedef enum
     INTERRUPTS_ENABLED
 } interrupt_state_t;
 
+/**
+ * @brief Sources of interrupts that callbacks can be registered for
+ */
+typedef enum
+{
+    /** @brief SP interrupt */
+    INTERRUPT_SOURCE_SP,
+    /** @brief SI interrupt */
+    INTERRUPT_SOURCE_SI,
+    /** @brief AI interrupt */
+    INTERRUPT_SOURCE_AI,
+    /** @brief VI interrupt */
+    INTERRUPT_SOURCE_VI,
+    /** @brief PI interrupt */
+    INTERRUPT_SOURCE_PI,
+    /** @brief DP interrupt */
+    INTERRUPT_SOURCE_DP,
+    /** @brief Timer interrupt */
+    INTERRUPT_SOURCE_TI,
+    /** @brief Number of interrupt sources */
+    INTERRUPT_SOURCE_COUNT
+} interrupt_source_t;
+
+/**
+ * @brief Time spent handling one interrupt source
+ *
+ * All times are in timer ticks, see #TIMER_MICROS.
+ */
+typedef struct
+{
+    /** @brief Number of times the interrupt was handled */
+    uint32_t count;
+    /** @brief Longest time spent in the callbacks */
+    uint32_t max_ticks;
+    /** @brief Average time spent in the callbacks */
+    uint32_t avg_ticks;
+    /** @brief Total time spent in the callbacks */
+    uint64_t total_ticks;
+} interrupt_source_profile_t;
+
+/**
+ * @brief Interrupt profile
+ *
+ * Filled in by #interrupt_profile_get when libdragon is built with
+ * INTERRUPT_PROFILE defined.
+ */
+typedef struct
+{
+    /** @brief Time spent in the callbacks of each interrupt source */
+    interrupt_source_profile_t source[INTERRUPT_SOURCE_COUNT];
+    /** @brief Longest time interrupts were disabled with #disable_interrupts */
+    uint32_t max_disabled_ticks;
+    /** @brief Return address of the #disable_interrupts call starting that window */
+    void *max_disabled_caller;
+} interrupt_profile_t;
+
+/** @brief Number of interrupts being handled, see #in_interrupt */
+extern volatile int __interrupt_nest;
+
+/**
+ * @brief Return how many interrupts are being handled
+ *
+ * Callbacks of sources with a priority set by #set_interrupt_priority run
+ * without the status register showing an exception, so use this rather
+ * than the status register to tell interrupt context apart.
+ *
+ * @return 0 outside of interrupts, or the nesting depth of the interrupt
+ *         being handled
+ */
+static inline int in_interrupt( void )
+{
+    return __interrupt_nest;
+}
+
+/**
+ * @brief Disable interrupts and return the previous state
+ *
+ * A lightweight critical section for short, hot code paths.  Unlike
+ * #disable_interrupts, this does not touch the nesting counter and is
+ * inlined into the caller, costing a handful of instructions.  Sections
+ * nest naturally as long as each one is closed with #interrupt_restore
+ * using the value returned when it was opened.
+ *
+ * @note Code inside such a section must not block, for example by waiting
+ *       on a thread event.
+ *
+ * @return The status register before interrupts were disabled
+ */
+static inline uint32_t interrupt_disable_save( void )
+{
+    uint32_t sr, tmp;
+
+    asm volatile("mfc0 %0,$12\n\tori %1,%0,1\n\txori %1,%1,1\n\tmtc0 %1,$12\n\tnop"
+                 : "=&r"(sr), "=&r"(tmp) : : "memory");
+
+    return sr;
+}
+
+/**
+ * @brief Restore interrupts to the state returned by #interrupt_disable_save
+ *
+ * Only the interrupt enable bit is restored, so other status register
+ * changes made inside the critical section are kept.
+ *
+ * @param[in] state
+ *            Value returned by the matching #interrupt_disable_save
+ */
+static inline void interrupt_restore( uint32_t state )
+{
+    uint32_t sr;
+
+    asm volatile("mfc0 %0,$12\n\tor %0,%0,%1\n\tmtc0 %0,$12\n\tnop"
+                 : "=&r"(sr) : "r"(state & 1) : "memory");
+}
+
+/**
+ * @brief Atomically add to a counter
+ *
+ * @param[in,out] value
+ *                Counter to add to
+ * @param[in]     delta
+ *                Amount to add
+ *
+ * @return The new value of the counter
+ */
+static inline int atomic_add( volatile int *value, int delta )
+{
+    uint32_t state = interrupt_disable_save();
+    int ret = (*value += delta);
+    interrupt_restore( state );
+
+    return ret;
+}
+
+/**
+ * @brief Atomically set bits in a set of flags
+ *
+ * @param[in,out] flags
+ *                Flags to modify
+ * @param[in]     mask
+ *                Bits to set
+ *
+ * @return The flags before the bits were set
+ */
+static inline uint32_t atomic_set_bits( volatile uint32_t *flags, uint32_t mask )
+{
+    uint32_t state = interrupt_disable_save();
+    uint32_t old = *flags;
+    *flags = old | mask;
+    interrupt_restore( state );
+
+    return old;
+}
+
+/**
+ * @brief Atomically clear bits in a set of flags
+ *
+ * @param[in,out] flags
+ *                Flags to modify
+ * @param[in]     mask
+ *                Bits to clear
+ *
+ * @return The flags before the bits were cleared
+ */
+static inline uint32_t atomic_clear_bits( volatile uint32_t *flags, uint32_t mask )
+{
+    uint32_t state = interrupt_disable_save();
+    uint32_t old = *flags;
+    *flags = old & ~mask;
+    interrupt_restore( state );
+
+    return old;
+}
+
+/**
+ * @brief Atomically replace a value
+ *
+ * @param[in,out] value
+ *                Value to replace
+ * @param[in]     new_value
+ *                Value to store
+ *
+ * @return The value before it was replaced
+ */
+static inline int atomic_exchange( volatile int *value, int new_value )
+{
+    uint32_t state = interrupt_disable_save();
+    int old = *value;
+    *value = new_value;
+    interrupt_restore( state );
+
+    return old;
+}
+
+/**
+ * @brief Atomically replace a value if it holds an expected value
+ *
+ * @param[in,out] value
+ *                Value to replace
+ * @param[in]     expected
+ *                Value that must be stored for the replacement to happen
+ * @param[in]     new_value
+ *                Value to store
+ *
+ * @return Nonzero if the value was replaced
+ */
+static inline int atomic_compare_exchange( volatile int *value, int expected, int new_value )
+{
+    uint32_t state = interrupt_disable_save();
+    int ok = (*value == expected);
+    if( ok ) { *value = new_value; }
+    interrupt_restore( state );
+
+    return ok;
+}
+
 /** @} */
 
 void register_AI_handler( void (*callback)() );
@@ -52,6 +270,8 @@ void set_PI_interrupt( int active );
 void set_DP_interrupt( int active );
 void set_SI_interrupt( int active );
 void set_SP_interrupt( int active );
+void set_interrupt_fpu_save( int save );
+void set_interrupt_priority( interrupt_source_t source, int prio );
 
 void init_interrupts();
 
@@ -60,6 +280,9 @@ void disable_interrupts();
 
 interrupt_state_t get_interrupts_state(); 
 
+int interrupt_profile_get( interrupt_profile_t *out );
+void interrupt_profile_reset();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,132 @@
+/**
+ * @file lazy.hpp
+ * @brief C++ Constructed On First Use
+ * @ingroup cpp
+ */
+#ifndef __LIBDRAGON_LAZY_HPP
+#define __LIBDRAGON_LAZY_HPP
+
+#include <new>
+#include <utility>
+#include "n64sys.h"
+#include "interrupt.h"
+#include "thread.h"
+
+/* Only needed once there are threads, which links the scheduler in anyway */
+extern "C" void thread_mutex_lock( thread_mutex_t *mutex ) __attribute__((weak));
+extern "C" void thread_mutex_unlock( thread_mutex_t *mutex ) __attribute__((weak));
+
+namespace dragon
+{
+
+/**
+ * @addtogroup cpp
+ * @{
+ */
+
+/**
+ * @brief A global object constructed when it is first used
+ *
+ * Global objects are constructed by __do_global_ctors before main, which
+ * holds up the first frame.  Wrapping an object that is not needed right
+ * away takes its constructor out of that list, since lazy itself has a
+ * constexpr constructor:
+ *
+ * @code
+ * static dragon::lazy<level_cache> cache;
+ *
+ * cache->load( 3 );   // constructed here, on first use
+ * @endcode
+ *
+ * #ctors_print_report shows which constructors are worth moving.  The
+ * object is never destroyed, like other globals in a program that does not
+ * exit.
+ *
+ * The object is constructed once even if several threads use it first at
+ * the same time.  The others wait on a mutex until it is ready, so the
+ * constructor runs with interrupts enabled and a low priority thread
+ * constructing the object is not held up.  Interrupt callbacks can't wait,
+ * so an object they use must not be constructed by a thread at that time;
+ * call #construct before enabling the interrupt.
+ *
+ * @tparam T
+ *         Type of the object
+ */
+template <typename T>
+class lazy
+{
+public:
+    constexpr lazy() : storage(), mutex(), state( EMPTY ) {}
+
+    lazy( const lazy & ) = delete;
+    lazy &operator=( const lazy & ) = delete;
+
+    /**
+     * @brief Construct the object now with arguments, unless it already is
+     *
+     * @return The object
+     */
+    template <typename... Args>
+    T &construct( Args &&... args )
+    {
+        if( state == READY ) { return *ptr(); }
+
+        /* Returns right away if there are no threads or this can't block */
+        if( thread_mutex_lock ) { thread_mutex_lock( &mutex ); }
+
+        uint32_t irq = interrupt_disable_save();
+        bool mine = state == EMPTY;
+
+        if( mine ) { state = CONSTRUCTING; }
+
+        interrupt_restore( irq );
+
+        if( mine )
+        {
+            new (storage) T( std::forward<Args>( args )... );
+            MEMORY_BARRIER();
+            state = READY;
+        }
+
+        if( thread_mutex_unlock ) { thread_mutex_unlock( &mutex ); }
+
+        /* Only reached while constructing when interrupting the constructor */
+        while( state != READY ) {}
+
+        return *ptr();
+    }
+
+    /** @brief Return the object, default constructing it on first use */
+    T &get() { return state == READY ? *ptr() : construct(); }
+
+    /** @brief Return the object, default constructing it on first use */
+    T &operator*() { return get(); }
+
+    /** @brief Access the object, default constructing it on first use */
+    T *operator->() { return &get(); }
+
+    /** @brief Return whether the object was constructed yet */
+    bool ready() const { return state == READY; }
+
+private:
+    /** @brief Construction states */
+    enum : int { EMPTY, CONSTRUCTING, READY };
+
+    /** @brief Return the object, which must be constructed */
+    T *ptr() { return reinterpret_cast<T *>( storage ); }
+
+    /** @brief Room for the object */
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    /** @brief Held by the thread constructing the object */
+    thread_mutex_t mutex;
+
+    /** @brief Construction state */
+    volatile int state;
+};
+
+/** @} */
+
+}
+
+#endif
@@ -57,9 +57,20 @@
 #include "rdp.h"
 #include "rsp.h"
 #include "timer.h"
+#include "thread.h"
+#include "alloc.h"
+#include "heaptrack.h"
 #include "exception.h"
 #include "dir.h"
 #include "fixed.h"
 #include "64drive.h"
+#include "logring.h"
+#include "trace.h"
+#include "profile.h"
+#include "defer.h"
+#include "crash.h"
+#include "sd.h"
+#include "save.h"
+#include "ctors.h"
 
 #endif
@@ -0,0 +1,27 @@
+/**
+ * @file libdragon.hpp
+ * @brief C++ Wrappers
+ * @ingroup cpp
+ */
+#ifndef __LIBDRAGON_LIBDRAGON_HPP
+#define __LIBDRAGON_LIBDRAGON_HPP
+
+/**
+ * @defgroup cpp C++ Wrappers
+ * @brief Header only C++ interface to parts of libdragon.
+ *
+ * The classes in namespace dragon own the handles the C API hands out, such
+ * as a locked display buffer or an open DragonFS file, and give them back
+ * when they go out of scope.  They can be moved but not copied.  Everything
+ * is inline and forwards to the C functions, so it costs nothing over
+ * calling them directly.  Link with libdragonpp as for any C++ program.
+ */
+
+#include "libdragon.h"
+#include "display.hpp"
+#include "dragonfs.hpp"
+#include "graphics.hpp"
+#include "lazy.hpp"
+#include "rdp.hpp"
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * @file logring.h
+ * @brief Log Ring
+ * @ingroup logring
+ */
+#ifndef __LIBDRAGON_LOGRING_H
+#define __LIBDRAGON_LOGRING_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup logring
+ * @{
+ */
+
+/** @brief Smallest ring size accepted by #log_ring_init */
+#define LOG_RING_MIN_SIZE   4096
+/** @brief Largest number of bytes stored in one record, longer writes are split */
+#define LOG_RING_MAX_RECORD 1024
+/** @brief Largest number of bytes handed to the sink at once */
+#define LOG_RING_CHUNK      4096
+
+/**
+ * @brief Destination the log ring drains to
+ *
+ * Called with a buffer and a length to send, it must either take all of
+ * the data and return the length, or take none of it and return 0 if it is
+ * busy.  Called with a null buffer, it returns nonzero if it could take data
+ * right now.  It may be called from an interrupt handler.
+ */
+typedef int (*log_sink_t)( const void *data, int len );
+
+/**
+ * @brief Log ring statistics
+ */
+typedef struct
+{
+    /** @brief Bytes accepted into the ring */
+    uint32_t written;
+    /** @brief Bytes handed to the sink */
+    uint32_t drained;
+    /** @brief Number of writes dropped because the ring was full */
+    uint32_t dropped_writes;
+    /** @brief Bytes dropped because the ring was full */
+    uint32_t dropped_bytes;
+    /** @brief Most bytes the ring has held at once, including record headers */
+    uint32_t high_water;
+} log_ring_stats_t;
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int log_ring_init( uint32_t size );
+void log_ring_close( void );
+int log_ring_write( const char *data, int len );
+void log_ring_drain( void );
+void log_ring_flush( void );
+void log_ring_set_sink( log_sink_t sink );
+void log_ring_get_stats( log_ring_stats_t *stats );
+int log_ring_hook_stdio( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
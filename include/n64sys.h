@@ -80,12 +80,33 @@
  */
 #define MEMORY_BARRIER() asm volatile ("" : : : "memory")
 
+/**
+ * @brief Place a function with the other hot code
+ *
+ * The linker scripts put hot code at the start of the text section, so
+ * functions that run all the time sit next to each other and do not evict
+ * each other from the 16 KiB instruction cache.  Use it on the few functions
+ * a profile shows the program spends its time in.
+ */
+#define HOT_TEXT __attribute__((hot, section(".text.hot")))
+
+/**
+ * @brief Place a variable with the other hot data
+ *
+ * The linker scripts put hot data at the start of the data section.  Only
+ * for variables that are written, as a section cannot mix constant and
+ * writable data.
+ */
+#define HOT_DATA __attribute__((section(".data.hot")))
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int sys_get_boot_cic();
 void sys_set_boot_cic(int bc);
+int get_memory_size();
+int is_memory_expanded();
 volatile unsigned long get_ticks( void );
 volatile unsigned long get_ticks_ms( void );
 void wait_ticks( unsigned long wait );
@@ -0,0 +1,83 @@
+/**
+ * @file profile.h
+ * @brief Sampling Profiler
+ * @ingroup profile
+ */
+#ifndef __LIBDRAGON_PROFILE_H
+#define __LIBDRAGON_PROFILE_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup profile
+ * @{
+ */
+
+/** @brief Magic number at the start of a profile dump, "N64P" */
+#define PROFILE_MAGIC           0x4E363450
+/** @brief Version of the profile dump format */
+#define PROFILE_VERSION         1
+/** @brief Sampling rate used when none is given */
+#define PROFILE_DEFAULT_HZ      1000
+/** @brief Number of histogram slots used when none is given */
+#define PROFILE_DEFAULT_SLOTS   4096
+
+/**
+ * @brief A histogram slot
+ *
+ * Counts the samples taken at one program counter with one return address
+ * register value.  Dumps hold these in big endian byte order.
+ */
+typedef struct
+{
+    /** @brief Address of the interrupted instruction */
+    uint32_t pc;
+    /** @brief Return address register at the time of the sample */
+    uint32_t ra;
+    /** @brief Number of samples */
+    uint32_t count;
+} profile_slot_t;
+
+/**
+ * @brief Header at the start of a profile dump
+ *
+ * It is followed by #profile_header_t::num_slots used histogram slots.
+ */
+typedef struct
+{
+    /** @brief Always #PROFILE_MAGIC */
+    uint32_t magic;
+    /** @brief Always #PROFILE_VERSION */
+    uint16_t version;
+    /** @brief Size of a #profile_slot_t */
+    uint16_t slot_size;
+    /** @brief Samples taken per second */
+    uint32_t hz;
+    /** @brief Number of slots following the header */
+    uint32_t num_slots;
+    /** @brief Total number of samples taken */
+    uint32_t samples;
+    /** @brief Samples lost because the histogram was full */
+    uint32_t dropped;
+} profile_header_t;
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int profile_init( int hz, int slots );
+void profile_close( void );
+void profile_start( void );
+void profile_stop( void );
+void profile_reset( void );
+int profile_dump_size( void );
+int profile_dump( void *buf, int size );
+int profile_dump_usb( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -123,235 +123,235 @@ typedef enum
 // (A-B)*C+D
 
 // Cycle 0
-#define CC_C0_RGB_SUBA_COMBINED_COLOR   (0 << 52)
-#define CC_C0_RGB_SUBA_TEXEL0_COLOR     (1 << 52)
-#define CC_C0_RGB_SUBA_TEXEL1_COLOR     (2 << 52)
-#define CC_C0_RGB_SUBA_PRIM_COLOR       (3 << 52)
-#define CC_C0_RGB_SUBA_SHADE_COLOR      (4 << 52)
-#define CC_C0_RGB_SUBA_ENV_COLOR        (5 << 52)
-#define CC_C0_RGB_RGB_SUBA_ONE_COLOR    (6 << 52)
-#define CC_C0_RGB_SUBA_NOISE_COLOR      (7 << 52)
-#define CC_C0_RGB_SUBA_ZERO_COLOR       (8 << 52)
-
-#define CC_C0_RGB_SUBB_COMBINED_COLOR   (0 << 28)
-#define CC_C0_RGB_SUBB_TEXEL0_COLOR     (1 << 28)
-#define CC_C0_RGB_SUBB_TEXEL1_COLOR     (2 << 28)
-#define CC_C0_RGB_SUBB_PRIM_COLOR       (3 << 28)
-#define CC_C0_RGB_SUBB_SHADE_COLOR      (4 << 28)
-#define CC_C0_RGB_SUBB_ENV_COLOR        (5 << 28)
-#define CC_C0_RGB_SUBB_ILLEGAL_COLOR    (6 << 28)
-#define CC_C0_RGB_SUBB_K4_COLOR         (7 << 28)
-#define CC_C0_RGB_SUBB_ZERO_COLOR       (8 << 28)
-
-#define CC_C0_RGB_MUL_COMBINED_COLOR       (0 << 47)
-#define CC_C0_RGB_MUL_TEXEL0_COLOR         (1 << 47)
-#define CC_C0_RGB_MUL_TEXEL1_COLOR         (2 << 47)
-#define CC_C0_RGB_MUL_PRIM_COLOR           (3 << 47)
-#define CC_C0_RGB_MUL_SHADE_COLOR          (4 << 47)
-#define CC_C0_RGB_MUL_ENV_COLOR            (5 << 47)
-#define CC_C0_RGB_MUL_KEY_SCALE            (6 << 47)
-#define CC_C0_RGB_MUL_COMBINED_ALPHA       (7 << 47)
-#define CC_C0_RGB_MUL_TEXEL0_ALPHA         (8 << 47)
-#define CC_C0_RGB_MUL_TEXEL1_ALPHA         (9 << 47)
-#define CC_C0_RGB_MUL_PRIM_ALPHA           (10 << 47)
-#define CC_C0_RGB_MUL_SHADE_ALPHA          (11 << 47)
-#define CC_C0_RGB_MUL_ENV_ALPHA            (12 << 47)
-#define CC_C0_RGB_MUL_LOD_FRACTION         (13 << 47)
-#define CC_C0_RGB_MUL_PRIM_LOD_FRACTION    (14 << 47)
-#define CC_C0_RGB_MUL_K5_COLOR             (15 << 47)
-#define CC_C0_RGB_MUL_ZERO_COLOR           (16 << 47)
-
-#define CC_C0_RGB_ADD_COMBINED_COLOR       (0 << 15) 
-#define CC_C0_RGB_ADD_TEXEL0_COLOR         (1 << 15) 
-#define CC_C0_RGB_ADD_TEXEL1_COLOR         (2 << 15) 
-#define CC_C0_RGB_ADD_PRIM_COLOR           (3 << 15) 
-#define CC_C0_RGB_ADD_SHADE_COLOR          (4 << 15) 
-#define CC_C0_RGB_ADD_ENV_COLOR            (5 << 15) 
-#define CC_C0_RGB_ADD_ONE_COLOR            (6 << 15) 
-#define CC_C0_RGB_ADD_ZERO_COLOR           (7 << 15) 
+#define CC_C0_RGB_SUBA_COMBINED_COLOR   (0ULL << 52)
+#define CC_C0_RGB_SUBA_TEXEL0_COLOR     (1ULL << 52)
+#define CC_C0_RGB_SUBA_TEXEL1_COLOR     (2ULL << 52)
+#define CC_C0_RGB_SUBA_PRIM_COLOR       (3ULL << 52)
+#define CC_C0_RGB_SUBA_SHADE_COLOR      (4ULL << 52)
+#define CC_C0_RGB_SUBA_ENV_COLOR        (5ULL << 52)
+#define CC_C0_RGB_RGB_SUBA_ONE_COLOR    (6ULL << 52)
+#define CC_C0_RGB_SUBA_NOISE_COLOR      (7ULL << 52)
+#define CC_C0_RGB_SUBA_ZERO_COLOR       (8ULL << 52)
+
+#define CC_C0_RGB_SUBB_COMBINED_COLOR   (0ULL << 28)
+#define CC_C0_RGB_SUBB_TEXEL0_COLOR     (1ULL << 28)
+#define CC_C0_RGB_SUBB_TEXEL1_COLOR     (2ULL << 28)
+#define CC_C0_RGB_SUBB_PRIM_COLOR       (3ULL << 28)
+#define CC_C0_RGB_SUBB_SHADE_COLOR      (4ULL << 28)
+#define CC_C0_RGB_SUBB_ENV_COLOR        (5ULL << 28)
+#define CC_C0_RGB_SUBB_ILLEGAL_COLOR    (6ULL << 28)
+#define CC_C0_RGB_SUBB_K4_COLOR         (7ULL << 28)
+#define CC_C0_RGB_SUBB_ZERO_COLOR       (8ULL << 28)
+
+#define CC_C0_RGB_MUL_COMBINED_COLOR       (0ULL << 47)
+#define CC_C0_RGB_MUL_TEXEL0_COLOR         (1ULL << 47)
+#define CC_C0_RGB_MUL_TEXEL1_COLOR         (2ULL << 47)
+#define CC_C0_RGB_MUL_PRIM_COLOR           (3ULL << 47)
+#define CC_C0_RGB_MUL_SHADE_COLOR          (4ULL << 47)
+#define CC_C0_RGB_MUL_ENV_COLOR            (5ULL << 47)
+#define CC_C0_RGB_MUL_KEY_SCALE            (6ULL << 47)
+#define CC_C0_RGB_MUL_COMBINED_ALPHA       (7ULL << 47)
+#define CC_C0_RGB_MUL_TEXEL0_ALPHA         (8ULL << 47)
+#define CC_C0_RGB_MUL_TEXEL1_ALPHA         (9ULL << 47)
+#define CC_C0_RGB_MUL_PRIM_ALPHA           (10ULL << 47)
+#define CC_C0_RGB_MUL_SHADE_ALPHA          (11ULL << 47)
+#define CC_C0_RGB_MUL_ENV_ALPHA            (12ULL << 47)
+#define CC_C0_RGB_MUL_LOD_FRACTION         (13ULL << 47)
+#define CC_C0_RGB_MUL_PRIM_LOD_FRACTION    (14ULL << 47)
+#define CC_C0_RGB_MUL_K5_COLOR             (15ULL << 47)
+#define CC_C0_RGB_MUL_ZERO_COLOR           (16ULL << 47)
+
+#define CC_C0_RGB_ADD_COMBINED_COLOR       (0ULL << 15) 
+#define CC_C0_RGB_ADD_TEXEL0_COLOR         (1ULL << 15) 
+#define CC_C0_RGB_ADD_TEXEL1_COLOR         (2ULL << 15) 
+#define CC_C0_RGB_ADD_PRIM_COLOR           (3ULL << 15) 
+#define CC_C0_RGB_ADD_SHADE_COLOR          (4ULL << 15) 
+#define CC_C0_RGB_ADD_ENV_COLOR            (5ULL << 15) 
+#define CC_C0_RGB_ADD_ONE_COLOR            (6ULL << 15) 
+#define CC_C0_RGB_ADD_ZERO_COLOR           (7ULL << 15) 
 
 // Cycle 1
-#define CC_C1_RGB_SUBA_COMBINED_COLOR   (0 << 37)
-#define CC_C1_RGB_SUBA_TEXEL0_COLOR     (1 << 37)
-#define CC_C1_RGB_SUBA_TEXEL1_COLOR     (2 << 37)
-#define CC_C1_RGB_SUBA_PRIM_COLOR       (3 << 37)
-#define CC_C1_RGB_SUBA_SHADE_COLOR      (4 << 37)
-#define CC_C1_RGB_SUBA_ENV_COLOR        (5 << 37)
-#define CC_C1_RGB_SUBA_ONE_COLOR        (6 << 37)
-#define CC_C1_RGB_SUBA_NOISE_COLOR      (7 << 37)
-#define CC_C1_RGB_SUBA_ZERO_COLOR       (8 << 37)
-
-#define CC_C1_RGB_SUBB_COMBINED_COLOR   (0 << 24)
-#define CC_C1_RGB_SUBB_TEXEL0_COLOR     (1 << 24)
-#define CC_C1_RGB_SUBB_TEXEL1_COLOR     (2 << 24)
-#define CC_C1_RGB_SUBB_PRIM_COLOR       (3 << 24)
-#define CC_C1_RGB_SUBB_SHADE_COLOR      (4 << 24)
-#define CC_C1_RGB_SUBB_ENV_COLOR        (5 << 24)
-#define CC_C1_RGB_SUBB_ILLEGAL_COLOR    (6 << 24)
-#define CC_C1_RGB_SUBB_K4_COLOR         (7 << 24)
-#define CC_C1_RGB_SUBB_ZERO_COLOR       (8 << 24)
-
-#define CC_C1_RGB_MUL_COMBINED_COLOR        (0 << 32)
-#define CC_C1_RGB_MUL_TEXEL0_COLOR          (1 << 32)
-#define CC_C1_RGB_MUL_TEXEL1_COLOR          (2 << 32)
-#define CC_C1_RGB_MUL_PRIM_COLOR            (3 << 32)
-#define CC_C1_RGB_MUL_SHADE_COLOR           (4 << 32)
-#define CC_C1_RGB_MUL_ENV_COLOR             (5 << 32)
-#define CC_C1_RGB_MUL_KEY_SCALE             (6 << 32)
-#define CC_C1_RGB_MUL_COMBINED_ALPHA        (7 << 32)
-#define CC_C1_RGB_MUL_TEXEL0_ALPHA          (8 << 32)
-#define CC_C1_RGB_MUL_TEXEL1_ALPHA          (9 << 32)
-#define CC_C1_RGB_MUL_PRIM_ALPHA            (10 << 32)
-#define CC_C1_RGB_MUL_SHADE_ALPHA           (11 << 32)
-#define CC_C1_RGB_MUL_ENV_ALPHA             (12 << 32)
-#define CC_C1_RGB_MUL_LOD_FRACTION          (13 << 32)
-#define CC_C1_RGB_MUL_PRIM_LOD_FRACTION     (14 << 32)
-#define CC_C1_RGB_MUL_K5_COLOR              (15 << 32)
-#define CC_C1_RGB_MUL_ZERO_COLOR            (16 << 32)
-
-#define CC_C1_RGB_ADD_COMBINED_COLOR        (0 << 6) 
-#define CC_C1_RGB_ADD_TEXEL0_COLOR          (1 << 6) 
-#define CC_C1_RGB_ADD_TEXEL1_COLOR          (2 << 6) 
-#define CC_C1_RGB_ADD_PRIM_COLOR            (3 << 6) 
-#define CC_C1_RGB_ADD_SHADE_COLOR           (4 << 6) 
-#define CC_C1_RGB_ADD_ENV_COLOR             (5 << 6) 
-#define CC_C1_RGB_ADD_ONE_COLOR             (6 << 6) 
-#define CC_C1_RGB_ADD_ZERO_COLOR            (7 << 6) 
+#define CC_C1_RGB_SUBA_COMBINED_COLOR   (0ULL << 37)
+#define CC_C1_RGB_SUBA_TEXEL0_COLOR     (1ULL << 37)
+#define CC_C1_RGB_SUBA_TEXEL1_COLOR     (2ULL << 37)
+#define CC_C1_RGB_SUBA_PRIM_COLOR       (3ULL << 37)
+#define CC_C1_RGB_SUBA_SHADE_COLOR      (4ULL << 37)
+#define CC_C1_RGB_SUBA_ENV_COLOR        (5ULL << 37)
+#define CC_C1_RGB_SUBA_ONE_COLOR        (6ULL << 37)
+#define CC_C1_RGB_SUBA_NOISE_COLOR      (7ULL << 37)
+#define CC_C1_RGB_SUBA_ZERO_COLOR       (8ULL << 37)
+
+#define CC_C1_RGB_SUBB_COMBINED_COLOR   (0ULL << 24)
+#define CC_C1_RGB_SUBB_TEXEL0_COLOR     (1ULL << 24)
+#define CC_C1_RGB_SUBB_TEXEL1_COLOR     (2ULL << 24)
+#define CC_C1_RGB_SUBB_PRIM_COLOR       (3ULL << 24)
+#define CC_C1_RGB_SUBB_SHADE_COLOR      (4ULL << 24)
+#define CC_C1_RGB_SUBB_ENV_COLOR        (5ULL << 24)
+#define CC_C1_RGB_SUBB_ILLEGAL_COLOR    (6ULL << 24)
+#define CC_C1_RGB_SUBB_K4_COLOR         (7ULL << 24)
+#define CC_C1_RGB_SUBB_ZERO_COLOR       (8ULL << 24)
+
+#define CC_C1_RGB_MUL_COMBINED_COLOR        (0ULL << 32)
+#define CC_C1_RGB_MUL_TEXEL0_COLOR          (1ULL << 32)
+#define CC_C1_RGB_MUL_TEXEL1_COLOR          (2ULL << 32)
+#define CC_C1_RGB_MUL_PRIM_COLOR            (3ULL << 32)
+#define CC_C1_RGB_MUL_SHADE_COLOR           (4ULL << 32)
+#define CC_C1_RGB_MUL_ENV_COLOR             (5ULL << 32)
+#define CC_C1_RGB_MUL_KEY_SCALE             (6ULL << 32)
+#define CC_C1_RGB_MUL_COMBINED_ALPHA        (7ULL << 32)
+#define CC_C1_RGB_MUL_TEXEL0_ALPHA          (8ULL << 32)
+#define CC_C1_RGB_MUL_TEXEL1_ALPHA          (9ULL << 32)
+#define CC_C1_RGB_MUL_PRIM_ALPHA            (10ULL << 32)
+#define CC_C1_RGB_MUL_SHADE_ALPHA           (11ULL << 32)
+#define CC_C1_RGB_MUL_ENV_ALPHA             (12ULL << 32)
+#define CC_C1_RGB_MUL_LOD_FRACTION          (13ULL << 32)
+#define CC_C1_RGB_MUL_PRIM_LOD_FRACTION     (14ULL << 32)
+#define CC_C1_RGB_MUL_K5_COLOR              (15ULL << 32)
+#define CC_C1_RGB_MUL_ZERO_COLOR            (16ULL << 32)
+
+#define CC_C1_RGB_ADD_COMBINED_COLOR        (0ULL << 6) 
+#define CC_C1_RGB_ADD_TEXEL0_COLOR          (1ULL << 6) 
+#define CC_C1_RGB_ADD_TEXEL1_COLOR          (2ULL << 6) 
+#define CC_C1_RGB_ADD_PRIM_COLOR            (3ULL << 6) 
+#define CC_C1_RGB_ADD_SHADE_COLOR           (4ULL << 6) 
+#define CC_C1_RGB_ADD_ENV_COLOR             (5ULL << 6) 
+#define CC_C1_RGB_ADD_ONE_COLOR             (6ULL << 6) 
+#define CC_C1_RGB_ADD_ZERO_COLOR            (7ULL << 6) 
 
 // Alpha Combine
 // Cycle 0
-#define CC_C0_ALPHA_MUL_LODFRAC         (0 << 41)
-#define CC_C0_ALPHA_MUL_TEXEL0          (1 << 41)
-#define CC_C0_ALPHA_MUL_TEXEL1          (2 << 41)
-#define CC_C0_ALPHA_MUL_PRIM            (3 << 41)
-#define CC_C0_ALPHA_MUL_SHADE           (4 << 41)
-#define CC_C0_ALPHA_MUL_ENV             (5 << 41)
-#define CC_C0_ALPHA_MUL_PRIMLODFRAC     (6 << 41)
-#define CC_C0_ALPHA_MUL_ZERO            (7 << 41)
-
-#define CC_C0_ALPHA_ADD_COMBINED        (0 << 9)
-#define CC_C0_ALPHA_ADD_TEXEL0          (1 << 9)
-#define CC_C0_ALPHA_ADD_TEXEL1          (2 << 9)
-#define CC_C0_ALPHA_ADD_PRIM            (3 << 9)
-#define CC_C0_ALPHA_ADD_SHADE           (4 << 9)
-#define CC_C0_ALPHA_ADD_ENV             (5 << 9)
-#define CC_C0_ALPHA_ADD_ONE             (6 << 9)
-#define CC_C0_ALPHA_ADD_ZERO            (7 << 9)
+#define CC_C0_ALPHA_MUL_LODFRAC         (0ULL << 41)
+#define CC_C0_ALPHA_MUL_TEXEL0          (1ULL << 41)
+#define CC_C0_ALPHA_MUL_TEXEL1          (2ULL << 41)
+#define CC_C0_ALPHA_MUL_PRIM            (3ULL << 41)
+#define CC_C0_ALPHA_MUL_SHADE           (4ULL << 41)
+#define CC_C0_ALPHA_MUL_ENV             (5ULL << 41)
+#define CC_C0_ALPHA_MUL_PRIMLODFRAC     (6ULL << 41)
+#define CC_C0_ALPHA_MUL_ZERO            (7ULL << 41)
+
+#define CC_C0_ALPHA_ADD_COMBINED        (0ULL << 9)
+#define CC_C0_ALPHA_ADD_TEXEL0          (1ULL << 9)
+#define CC_C0_ALPHA_ADD_TEXEL1          (2ULL << 9)
+#define CC_C0_ALPHA_ADD_PRIM            (3ULL << 9)
+#define CC_C0_ALPHA_ADD_SHADE           (4ULL << 9)
+#define CC_C0_ALPHA_ADD_ENV             (5ULL << 9)
+#define CC_C0_ALPHA_ADD_ONE             (6ULL << 9)
+#define CC_C0_ALPHA_ADD_ZERO            (7ULL << 9)
 
 //Cycle 1
-#define CC_C1_ALPHA_MUL_LODFRAC         (0 << 18)
-#define CC_C1_ALPHA_MUL_TEXEL0          (1 << 18)
-#define CC_C1_ALPHA_MUL_TEXEL1          (2 << 18)
-#define CC_C1_ALPHA_MUL_PRIM            (3 << 18)
-#define CC_C1_ALPHA_MUL_SHADE           (4 << 18)
-#define CC_C1_ALPHA_MUL_ENV             (5 << 18)
-#define CC_C1_ALPHA_MUL_PRIMLODFRAC     (6 << 18)
-#define CC_C1_ALPHA_MUL_ZERO            (7 << 18)
-
-#define CC_C1_ALPHA_ADD_COMBINED        (0 << 0)
-#define CC_C1_ALPHA_ADD_TEXEL0          (1 << 0)
-#define CC_C1_ALPHA_ADD_TEXEL1          (2 << 0)
-#define CC_C1_ALPHA_ADD_PRIM            (3 << 0)
-#define CC_C1_ALPHA_ADD_SHADE           (4 << 0)
-#define CC_C1_ALPHA_ADD_ENV             (5 << 0)
-#define CC_C1_ALPHA_ADD_ONE             (6 << 0)
-#define CC_C1_ALPHA_ADD_ZERO            (7 << 0)
+#define CC_C1_ALPHA_MUL_LODFRAC         (0ULL << 18)
+#define CC_C1_ALPHA_MUL_TEXEL0          (1ULL << 18)
+#define CC_C1_ALPHA_MUL_TEXEL1          (2ULL << 18)
+#define CC_C1_ALPHA_MUL_PRIM            (3ULL << 18)
+#define CC_C1_ALPHA_MUL_SHADE           (4ULL << 18)
+#define CC_C1_ALPHA_MUL_ENV             (5ULL << 18)
+#define CC_C1_ALPHA_MUL_PRIMLODFRAC     (6ULL << 18)
+#define CC_C1_ALPHA_MUL_ZERO            (7ULL << 18)
+
+#define CC_C1_ALPHA_ADD_COMBINED        (0ULL << 0)
+#define CC_C1_ALPHA_ADD_TEXEL0          (1ULL << 0)
+#define CC_C1_ALPHA_ADD_TEXEL1          (2ULL << 0)
+#define CC_C1_ALPHA_ADD_PRIM            (3ULL << 0)
+#define CC_C1_ALPHA_ADD_SHADE           (4ULL << 0)
+#define CC_C1_ALPHA_ADD_ENV             (5ULL << 0)
+#define CC_C1_ALPHA_ADD_ONE             (6ULL << 0)
+#define CC_C1_ALPHA_ADD_ZERO            (7ULL << 0)
 
 
 // Set Other Modes
-#define MODE_ATOMIC_PRIM                (1 << 55)   // Atomic primitives - finish drawing one primitive before drawing another.
-
-#define MODE_CYCLE_TYPE_1CYCLE          (0 << 52)   // 1-cycle rendering mode.
-#define MODE_CYCLE_TYPE_2CYCLE          (1 << 52)   // 2-cycle rendering mode.
-#define MODE_CYCLE_TYPE_COPY            (2 << 52)   // Straight copy.
-#define MODE_CYCLE_TYPE_FILL            (3 << 52)   // Fast fill mode, doesn't work for right-major polys (or was it left-major?)
-
-#define MODE_PERSP_TEX_EN               (1 << 51)   // Perspective-correct textures
-#define MODE_DETAIL_TEX_EN              (1 << 50)   // Detail filtering for textures
-#define MODE_SHARPEN_TEX_EN             (1 << 49)   // Sharpen filtering for textures
-#define MODE_TEX_LOD_EN                 (1 << 48)
-#define MODE_EN_TLUT                    (1 << 47)   // Enable TLUT if drawing a CI texture
-#define MODE_TLUT_TYPE                  (1 << 46)
-#define MODE_SAMPLE_TYPE                (1 << 45)
-#define MODE_MID_TEXEL                  (1 << 44)
-#define MODE_BI_LERP_0                  (1 << 43)
-#define MODE_BI_LERP_1                  (1 << 42)
-#define MODE_CONVERT_ONE                (1 << 41)
-#define MODE_KEY_EN                     (1 << 40)
-
-#define MODE_RGB_DITHER_SEL_MAGIC       (0 << 38)
-#define MODE_RGB_DITHER_SEL_BAYER       (1 << 38)
-#define MODE_RGB_DITHER_SEL_NOISE       (2 << 38)
-#define MODE_RGB_DITHER_SEL_NONE        (3 << 38)
-
-#define MODE_ALPHA_DITHER_SEL_PATTERN   (0 << 36)
-#define MODE_ALPHA_DITHER_SEL_NOTPATTERN (1 << 36)
-#define MODE_ALPHA_DITHER_SEL_NOISE     (2 << 36)
-#define MODE_ALPHA_DITHER_SEL_NONE      (3 << 36)
+#define MODE_ATOMIC_PRIM                (1ULL << 55)   // Atomic primitives - finish drawing one primitive before drawing another.
+
+#define MODE_CYCLE_TYPE_1CYCLE          (0ULL << 52)   // 1-cycle rendering mode.
+#define MODE_CYCLE_TYPE_2CYCLE          (1ULL << 52)   // 2-cycle rendering mode.
+#define MODE_CYCLE_TYPE_COPY            (2ULL << 52)   // Straight copy.
+#define MODE_CYCLE_TYPE_FILL            (3ULL << 52)   // Fast fill mode, doesn't work for right-major polys (or was it left-major?)
+
+#define MODE_PERSP_TEX_EN               (1ULL << 51)   // Perspective-correct textures
+#define MODE_DETAIL_TEX_EN              (1ULL << 50)   // Detail filtering for textures
+#define MODE_SHARPEN_TEX_EN             (1ULL << 49)   // Sharpen filtering for textures
+#define MODE_TEX_LOD_EN                 (1ULL << 48)
+#define MODE_EN_TLUT                    (1ULL << 47)   // Enable TLUT if drawing a CI texture
+#define MODE_TLUT_TYPE                  (1ULL << 46)
+#define MODE_SAMPLE_TYPE                (1ULL << 45)
+#define MODE_MID_TEXEL                  (1ULL << 44)
+#define MODE_BI_LERP_0                  (1ULL << 43)
+#define MODE_BI_LERP_1                  (1ULL << 42)
+#define MODE_CONVERT_ONE                (1ULL << 41)
+#define MODE_KEY_EN                     (1ULL << 40)
+
+#define MODE_RGB_DITHER_SEL_MAGIC       (0ULL << 38)
+#define MODE_RGB_DITHER_SEL_BAYER       (1ULL << 38)
+#define MODE_RGB_DITHER_SEL_NOISE       (2ULL << 38)
+#define MODE_RGB_DITHER_SEL_NONE        (3ULL << 38)
+
+#define MODE_ALPHA_DITHER_SEL_PATTERN   (0ULL << 36)
+#define MODE_ALPHA_DITHER_SEL_NOTPATTERN (1ULL << 36)
+#define MODE_ALPHA_DITHER_SEL_NOISE     (2ULL << 36)
+#define MODE_ALPHA_DITHER_SEL_NONE      (3ULL << 36)
 
 // double-check the blend functions
-#define MODE_BLEND_M1A_C0_PIXEL         (0 << 30)
-#define MODE_BLEND_M1A_C0_MEMORY        (1 << 30)
-#define MODE_BLEND_M1A_C0_BLEND         (2 << 30)
-#define MODE_BLEND_M1A_C0_FOG           (3 << 30)
-
-#define MODE_BLEND_M1A_C1_PIXEL         (0 << 28)
-#define MODE_BLEND_M1A_C1_MEMORY        (1 << 28)
-#define MODE_BLEND_M1A_C1_BLEND         (2 << 28)
-#define MODE_BLEND_M1A_C1_FOG           (3 << 28)
-
-#define MODE_BLEND_M1B_C0_PIXEL         (0 << 26)
-#define MODE_BLEND_M1B_C0_FOG           (1 << 26)
-#define MODE_BLEND_M1B_C0_SHADE         (2 << 26)
-#define MODE_BLEND_M1B_C0_ZERO          (3 << 26)
-
-#define MODE_BLEND_M1B_C1_PIXEL         (0 << 24)
-#define MODE_BLEND_M1B_C1_FOG           (1 << 24)
-#define MODE_BLEND_M1B_C1_SHADE         (2 << 24)
-#define MODE_BLEND_M1B_C1_ZERO          (3 << 24)
-
-#define MODE_BLEND_M2A_C0_PIXEL         (0 << 22)
-#define MODE_BLEND_M2A_C0_MEMORY        (1 << 22)
-#define MODE_BLEND_M2A_C0_BLEND         (2 << 22)
-#define MODE_BLEND_M2A_C0_FOG           (3 << 22)
-
-#define MODE_BLEND_M2A_C1_PIXEL         (0 << 20)
-#define MODE_BLEND_M2A_C1_MEMORY        (1 << 20)
-#define MODE_BLEND_M2A_C1_BLEND         (2 << 20)
-#define MODE_BLEND_M2A_C1_FOG           (3 << 20)
-
-#define MODE_BLEND_M2B_C0_INVPIXEL      (0 << 18)
-#define MODE_BLEND_M2B_C0_MEMORY        (1 << 18)
-#define MODE_BLEND_M2B_C0_ONE           (2 << 18)
-#define MODE_BLEND_M2B_C0_ZERO          (3 << 18)
-
-#define MODE_BLEND_M2B_C1_INVPIXEL      (0 << 16)
-#define MODE_BLEND_M2B_C1_MEMORY        (1 << 16)
-#define MODE_BLEND_M2B_C1_ONE           (2 << 16)
-#define MODE_BLEND_M2B_C1_ZERO          (3 << 16)
-
-#define MODE_FORCE_BLEND                (1 << 14)
-#define MODE_ALPHA_CVG_SELECT           (1 << 13)
-#define MODE_CVG_TIMES_ALPHA            (1 << 12)
-
-#define MODE_Z_MODE_OPAQUE              (0 << 10)   // The Z buffer calculation modes.
-#define MODE_Z_MODE_INTERPENETRATING    (1 << 10)
-#define MODE_Z_MODE_TRANSPARENT         (2 << 10)
-#define MODE_Z_MODE_DECAL               (3 << 10)
-
-#define MODE_CVG_DEST_CLAMP             (0 << 8)
-#define MODE_CVG_DEST_WRAP              (1 << 8)
-#define MODE_CVG_DEST_ZAP               (2 << 8)
-#define MODE_CVG_DEST_SAVE              (3 << 8)
-
-#define MODE_COLOR_ON_CVG               (1 << 7)
-#define MODE_IMAGE_READ_EN              (1 << 6)
-#define MODE_Z_UPDATE_EN                (1 << 5)    // 1 = Write new Z value to Z buffer when drawing a pixel.
-#define MODE_Z_COMPARE_EN               (1 << 4)    // Enable Z comparison, don't write pixel if Z compare fails.
-#define MODE_ANTIALIAS_EN               (1 << 3)    // 0 = no AA, 1 = yes AA
-#define MODE_Z_SOURCE_SEL               (1 << 2)    // 0 = primitive Z, 1 = pixel Z
-#define MODE_DITHER_ALPHA_EN            (1 << 1)    //
-#define MODE_ALPHA_COMPARE_EN           (1 << 0)    // Enable alpha channel - used for transparency and translucency.
+#define MODE_BLEND_M1A_C0_PIXEL         (0ULL << 30)
+#define MODE_BLEND_M1A_C0_MEMORY        (1ULL << 30)
+#define MODE_BLEND_M1A_C0_BLEND         (2ULL << 30)
+#define MODE_BLEND_M1A_C0_FOG           (3ULL << 30)
+
+#define MODE_BLEND_M1A_C1_PIXEL         (0ULL << 28)
+#define MODE_BLEND_M1A_C1_MEMORY        (1ULL << 28)
+#define MODE_BLEND_M1A_C1_BLEND         (2ULL << 28)
+#define MODE_BLEND_M1A_C1_FOG           (3ULL << 28)
+
+#define MODE_BLEND_M1B_C0_PIXEL         (0ULL << 26)
+#define MODE_BLEND_M1B_C0_FOG           (1ULL << 26)
+#define MODE_BLEND_M1B_C0_SHADE         (2ULL << 26)
+#define MODE_BLEND_M1B_C0_ZERO          (3ULL << 26)
+
+#define MODE_BLEND_M1B_C1_PIXEL         (0ULL << 24)
+#define MODE_BLEND_M1B_C1_FOG           (1ULL << 24)
+#define MODE_BLEND_M1B_C1_SHADE         (2ULL << 24)
+#define MODE_BLEND_M1B_C1_ZERO          (3ULL << 24)
+
+#define MODE_BLEND_M2A_C0_PIXEL         (0ULL << 22)
+#define MODE_BLEND_M2A_C0_MEMORY        (1ULL << 22)
+#define MODE_BLEND_M2A_C0_BLEND         (2ULL << 22)
+#define MODE_BLEND_M2A_C0_FOG           (3ULL << 22)
+
+#define MODE_BLEND_M2A_C1_PIXEL         (0ULL << 20)
+#define MODE_BLEND_M2A_C1_MEMORY        (1ULL << 20)
+#define MODE_BLEND_M2A_C1_BLEND         (2ULL << 20)
+#define MODE_BLEND_M2A_C1_FOG           (3ULL << 20)
+
+#define MODE_BLEND_M2B_C0_INVPIXEL      (0ULL << 18)
+#define MODE_BLEND_M2B_C0_MEMORY        (1ULL << 18)
+#define MODE_BLEND_M2B_C0_ONE           (2ULL << 18)
+#define MODE_BLEND_M2B_C0_ZERO          (3ULL << 18)
+
+#define MODE_BLEND_M2B_C1_INVPIXEL      (0ULL << 16)
+#define MODE_BLEND_M2B_C1_MEMORY        (1ULL << 16)
+#define MODE_BLEND_M2B_C1_ONE           (2ULL << 16)
+#define MODE_BLEND_M2B_C1_ZERO          (3ULL << 16)
+
+#define MODE_FORCE_BLEND                (1ULL << 14)
+#define MODE_ALPHA_CVG_SELECT           (1ULL << 13)
+#define MODE_CVG_TIMES_ALPHA            (1ULL << 12)
+
+#define MODE_Z_MODE_OPAQUE              (0ULL << 10)   // The Z buffer calculation modes.
+#define MODE_Z_MODE_INTERPENETRATING    (1ULL << 10)
+#define MODE_Z_MODE_TRANSPARENT         (2ULL << 10)
+#define MODE_Z_MODE_DECAL               (3ULL << 10)
+
+#define MODE_CVG_DEST_CLAMP             (0ULL << 8)
+#define MODE_CVG_DEST_WRAP              (1ULL << 8)
+#define MODE_CVG_DEST_ZAP               (2ULL << 8)
+#define MODE_CVG_DEST_SAVE              (3ULL << 8)
+
+#define MODE_COLOR_ON_CVG               (1ULL << 7)
+#define MODE_IMAGE_READ_EN              (1ULL << 6)
+#define MODE_Z_UPDATE_EN                (1ULL << 5)    // 1 = Write new Z value to Z buffer when drawing a pixel.
+#define MODE_Z_COMPARE_EN               (1ULL << 4)    // Enable Z comparison, don't write pixel if Z compare fails.
+#define MODE_ANTIALIAS_EN               (1ULL << 3)    // 0 = no AA, 1 = yes AA
+#define MODE_Z_SOURCE_SEL               (1ULL << 2)    // 0 = primitive Z, 1 = pixel Z
+#define MODE_DITHER_ALPHA_EN            (1ULL << 1)    //
+#define MODE_ALPHA_COMPARE_EN           (1ULL << 0)    // Enable alpha channel - used for transparency and translucency.
 
 /* compatibility with N64 libs */
 #define	G_BL_CLR_IN	    0
@@ -374,6 +374,24 @@ typedef enum
 #define	RM_AA_ZB_OPA_SURF(clk)					        \
 	GBL_c##clk(G_BL_CLR_IN, G_BL_A_IN, G_BL_CLR_MEM, G_BL_A_MEM)
 
+/**
+ * @brief Whole SetOtherModes command for a set of MODE_* flags
+ *
+ * With constant flags this is a constant, so #rdp_command stores it with no
+ * packing at run time.  Unlike #rdp_set_other_modes, dithering is left as
+ * given.  See dragon::other_modes in rdp.hpp for a C++ version that rejects
+ * flags that do not go together.
+ */
+#define RDP_SET_OTHER_MODES(modes)      ((0xAFULL << 56) | (uint64_t)(modes))
+
+/**
+ * @brief Whole SetCombine command for a set of CC_* fields
+ *
+ * See dragon::combine in rdp.hpp for a C++ version that checks each input
+ * is one the combiner has.
+ */
+#define RDP_SET_COMBINE(mode)           ((0xBCULL << 56) | (uint64_t)(mode))
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -417,4 +435,18 @@ void rdp_execute_display_list( display_list_t *list, int display_list_length, di
 }
 #endif
 
+/**
+ * @brief Add a command that is already packed to a display list
+ *
+ * @param[in,out] list
+ *                A display list pointer
+ * @param[in]     command
+ *                The 64 bit command, such as from #RDP_SET_OTHER_MODES
+ */
+static inline void rdp_command( display_list_t **list, uint64_t command )
+{
+    (*list)->command = command;
+    (*list)++;
+}
+
 #endif
@@ -0,0 +1,337 @@
+/**
+ * @file rdp.hpp
+ * @brief C++ Display List Builder
+ * @ingroup cpp
+ */
+#ifndef __LIBDRAGON_RDP_HPP
+#define __LIBDRAGON_RDP_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rdp.h"
+
+namespace dragon
+{
+
+/**
+ * @addtogroup cpp
+ * @{
+ */
+
+/**
+ * @brief Inputs of the color combiner
+ *
+ * The combiner computes (A - B) * C + D for color and for alpha, and each of
+ * the eight inputs only takes some of these.  In alpha inputs the sources
+ * stand for their alpha, so TEXEL0 is the alpha of texel 0.
+ */
+namespace cc
+{
+
+/** @brief A combiner input */
+enum source
+{
+    COMBINED, TEXEL0, TEXEL1, PRIM, SHADE, ENV, ONE, NOISE, ZERO,
+    KEY_CENTER, KEY_SCALE, K4, K5, LOD_FRACTION, PRIM_LOD_FRACTION,
+    COMBINED_ALPHA, TEXEL0_ALPHA, TEXEL1_ALPHA, PRIM_ALPHA, SHADE_ALPHA, ENV_ALPHA,
+};
+
+/** @brief Encode the color A input, or -1 if it cannot be used there */
+constexpr int rgb_sub_a( source s )
+{
+    return s <= ENV ? s : s == ONE ? 6 : s == NOISE ? 7 : s == ZERO ? 15 : -1;
+}
+
+/** @brief Encode the color B input, or -1 if it cannot be used there */
+constexpr int rgb_sub_b( source s )
+{
+    return s <= ENV ? s : s == KEY_CENTER ? 6 : s == K4 ? 7 : s == ZERO ? 15 : -1;
+}
+
+/** @brief Encode the color C input, or -1 if it cannot be used there */
+constexpr int rgb_mul( source s )
+{
+    return s <= ENV ? s : s == KEY_SCALE ? 6 : s == COMBINED_ALPHA ? 7 : s == TEXEL0_ALPHA ? 8 :
+           s == TEXEL1_ALPHA ? 9 : s == PRIM_ALPHA ? 10 : s == SHADE_ALPHA ? 11 : s == ENV_ALPHA ? 12 :
+           s == LOD_FRACTION ? 13 : s == PRIM_LOD_FRACTION ? 14 : s == K5 ? 15 : s == ZERO ? 31 : -1;
+}
+
+/** @brief Encode the color D input, or -1 if it cannot be used there */
+constexpr int rgb_add( source s )
+{
+    return s <= ENV ? s : s == ONE ? 6 : s == ZERO ? 7 : -1;
+}
+
+/** @brief Encode the alpha A, B or D input, or -1 if it cannot be used there */
+constexpr int alpha_add( source s )
+{
+    return s <= ENV ? s : s == ONE ? 6 : s == ZERO ? 7 : -1;
+}
+
+/** @brief Encode the alpha C input, or -1 if it cannot be used there */
+constexpr int alpha_mul( source s )
+{
+    return s == LOD_FRACTION ? 0 : (s >= TEXEL0 && s <= ENV) ? s : s == PRIM_LOD_FRACTION ? 6 : s == ZERO ? 7 : -1;
+}
+
+}
+
+/**
+ * @brief One combiner cycle, (A - B) * C + D for color and alpha
+ *
+ * An input that the combiner does not have in that place fails to compile.
+ */
+template <cc::source A, cc::source B, cc::source C, cc::source D,
+          cc::source AA, cc::source AB, cc::source AC, cc::source AD>
+struct combine_cycle
+{
+    static_assert( cc::rgb_sub_a( A ) >= 0, "color A input cannot be this source" );
+    static_assert( cc::rgb_sub_b( B ) >= 0, "color B input cannot be this source" );
+    static_assert( cc::rgb_mul( C ) >= 0, "color C input cannot be this source" );
+    static_assert( cc::rgb_add( D ) >= 0, "color D input cannot be this source" );
+    static_assert( cc::alpha_add( AA ) >= 0, "alpha A input cannot be this source" );
+    static_assert( cc::alpha_add( AB ) >= 0, "alpha B input cannot be this source" );
+    static_assert( cc::alpha_mul( AC ) >= 0, "alpha C input cannot be this source" );
+    static_assert( cc::alpha_add( AD ) >= 0, "alpha D input cannot be this source" );
+
+    /** @brief The fields for the first cycle */
+    static constexpr uint64_t cycle0 =
+        ((uint64_t)cc::rgb_sub_a( A ) << 52) | ((uint64_t)cc::rgb_mul( C ) << 47) |
+        ((uint64_t)cc::alpha_add( AA ) << 44) | ((uint64_t)cc::alpha_mul( AC ) << 41) |
+        ((uint64_t)cc::rgb_sub_b( B ) << 28) | ((uint64_t)cc::rgb_add( D ) << 15) |
+        ((uint64_t)cc::alpha_add( AB ) << 12) | ((uint64_t)cc::alpha_add( AD ) << 9);
+
+    /** @brief The fields for the second cycle */
+    static constexpr uint64_t cycle1 =
+        ((uint64_t)cc::rgb_sub_a( A ) << 37) | ((uint64_t)cc::rgb_mul( C ) << 32) |
+        ((uint64_t)cc::rgb_sub_b( B ) << 24) | ((uint64_t)cc::alpha_add( AA ) << 21) |
+        ((uint64_t)cc::alpha_mul( AC ) << 18) | ((uint64_t)cc::rgb_add( D ) << 6) |
+        ((uint64_t)cc::alpha_add( AB ) << 3) | (uint64_t)cc::alpha_add( AD );
+};
+
+/**
+ * @brief A whole combiner setup
+ *
+ * @code
+ * // Texture tinted by the primitive color, in 1 cycle mode
+ * typedef dragon::combine_cycle<cc::TEXEL0, cc::ZERO, cc::PRIM, cc::ZERO,
+ *                               cc::TEXEL0, cc::ZERO, cc::PRIM, cc::ZERO> tint;
+ * rdp_command( &list, dragon::combine<tint>::command );
+ * @endcode
+ *
+ * @tparam Cycle0
+ *         #combine_cycle for the first cycle
+ * @tparam Cycle1
+ *         #combine_cycle for the second cycle, which is the one used in
+ *         1 cycle mode, so by default the same
+ */
+template <typename Cycle0, typename Cycle1 = Cycle0>
+struct combine
+{
+    /** @brief Fields, as passed to #rdp_set_combine_mode */
+    static constexpr uint64_t mode = Cycle0::cycle0 | Cycle1::cycle1;
+    /** @brief Whole SetCombine command, for #rdp_command */
+    static constexpr uint64_t command = RDP_SET_COMBINE( mode );
+};
+
+/**
+ * @brief A whole render mode setup
+ *
+ * Rejects MODE_* flags that do not go together, such as Z buffering in
+ * fill mode, where the RDP does not do it.
+ *
+ * @tparam Modes
+ *         MODE_* flags, as passed to #rdp_set_other_modes
+ */
+template <uint64_t Modes>
+struct other_modes
+{
+    /** @brief One of the MODE_CYCLE_TYPE_* values */
+    static constexpr uint64_t cycle_type = Modes & MODE_CYCLE_TYPE_FILL;
+
+    static_assert( (Modes >> 56) == 0, "flags outside of the render mode" );
+    static_assert( cycle_type != MODE_CYCLE_TYPE_FILL ||
+                   !(Modes & (MODE_Z_COMPARE_EN | MODE_Z_UPDATE_EN | MODE_IMAGE_READ_EN | MODE_ANTIALIAS_EN | MODE_FORCE_BLEND)),
+                   "fill mode does no Z buffering, blending or antialiasing" );
+    static_assert( cycle_type != MODE_CYCLE_TYPE_COPY ||
+                   !(Modes & (MODE_Z_COMPARE_EN | MODE_Z_UPDATE_EN | MODE_IMAGE_READ_EN | MODE_ANTIALIAS_EN | MODE_FORCE_BLEND)),
+                   "copy mode does no Z buffering, blending or antialiasing" );
+    static_assert( (Modes & MODE_EN_TLUT) || !(Modes & MODE_TLUT_TYPE), "TLUT type set without the TLUT enabled" );
+    static_assert( (Modes & MODE_Z_COMPARE_EN) || !(Modes & MODE_Z_SOURCE_SEL), "Z source set without Z compare" );
+
+    /** @brief Whole SetOtherModes command, for #rdp_command */
+    static constexpr uint64_t command = RDP_SET_OTHER_MODES( Modes );
+};
+
+/**
+ * @brief A display list with room for a fixed number of commands
+ *
+ * Commands are added through a cursor whose type counts how many commands
+ * were added so far.  Each call returns a new cursor, so a chain of calls
+ * that does not fit the list fails to compile:
+ *
+ * @code
+ * static dragon::display_list<8> dl;
+ *
+ * dl.begin()
+ *   .attach_display( disp )
+ *   .sync( SYNC_PIPE )
+ *   .set_fill_mode()
+ *   .set_primitive_color( dragon::make_color<DEPTH_16_BPP>( 255, 0, 0, 255 ) )
+ *   .draw_filled_rectangle( 10, 10, 100, 100 )
+ *   .detach_display()
+ *   .end();
+ * dl.execute();
+ * @endcode
+ *
+ * The cursor is a single pointer, and each call is the matching rdp_*
+ * function, so this compiles to the same code as using them directly.
+ * Commands added in a loop cannot be counted this way; use #data with the
+ * C functions for those, and make the list large enough.
+ *
+ * @tparam N
+ *         Number of 64 bit commands the list holds, including the end
+ */
+template <size_t N>
+class display_list
+{
+public:
+    /**
+     * @brief Position in the list after Used commands
+     */
+    template <size_t Used>
+    class cursor
+    {
+    public:
+        /** @brief Start at a position in the list */
+        explicit cursor( display_list_t *ptr ) : ptr( ptr ) {}
+
+        /** @brief Add #rdp_attach_display */
+        cursor<Used + 1> attach_display( display_context_t disp ) { rdp_attach_display( &ptr, disp ); return next<1>(); }
+        /** @brief Add #rdp_detach_display */
+        cursor<Used + 1> detach_display() { rdp_detach_display( &ptr ); return next<1>(); }
+        /** @brief Add #rdp_sync */
+        cursor<Used + 1> sync( sync_t sync ) { rdp_sync( &ptr, sync ); return next<1>(); }
+        /** @brief Add #rdp_set_clipping */
+        cursor<Used + 1> set_clipping( uint32_t tx, uint32_t ty, uint32_t bx, uint32_t by ) { rdp_set_clipping( &ptr, tx, ty, bx, by ); return next<1>(); }
+        /** @brief Add #rdp_set_default_clipping */
+        cursor<Used + 1> set_default_clipping() { rdp_set_default_clipping( &ptr ); return next<1>(); }
+        /** @brief Add #rdp_set_fill_mode */
+        cursor<Used + 1> set_fill_mode() { rdp_set_fill_mode( &ptr ); return next<1>(); }
+        /** @brief Add #rdp_enable_blend_fill */
+        cursor<Used + 1> enable_blend_fill() { rdp_enable_blend_fill( &ptr ); return next<1>(); }
+        /** @brief Add #rdp_enable_texture_copy */
+        cursor<Used + 1> enable_texture_copy() { rdp_enable_texture_copy( &ptr ); return next<1>(); }
+        /** @brief Add #rdp_set_other_modes */
+        cursor<Used + 1> set_other_modes( uint64_t mode_bits ) { rdp_set_other_modes( &ptr, mode_bits ); return next<1>(); }
+        /** @brief Add #rdp_set_combine_mode */
+        cursor<Used + 1> set_combine_mode( uint64_t combine_mode ) { rdp_set_combine_mode( &ptr, combine_mode ); return next<1>(); }
+        /** @brief Add #rdp_set_color_image */
+        cursor<Used + 1> set_color_image( RDP_IMAGE_DATA_FORMAT format, RDP_PIXEL_WIDTH pixelwidth, uint16_t imagewidth, uint16_t *buffer ) { rdp_set_color_image( &ptr, format, pixelwidth, imagewidth, buffer ); return next<1>(); }
+        /** @brief Add #rdp_set_z_image */
+        cursor<Used + 1> set_z_image( uint16_t *buffer ) { rdp_set_z_image( &ptr, buffer ); return next<1>(); }
+        /** @brief Add a packed command with #rdp_command */
+        cursor<Used + 1> command( uint64_t command ) { rdp_command( &ptr, command ); return next<1>(); }
+        /** @brief Add #rdp_set_primitive_color */
+        cursor<Used + 1> set_primitive_color( uint32_t color ) { rdp_set_primitive_color( &ptr, color ); return next<1>(); }
+        /** @brief Add #rdp_set_blend_color */
+        cursor<Used + 1> set_blend_color( uint32_t color ) { rdp_set_blend_color( &ptr, color ); return next<1>(); }
+        /** @brief Add #rdp_set_env_color */
+        cursor<Used + 1> set_env_color( uint32_t color ) { rdp_set_env_color( &ptr, color ); return next<1>(); }
+
+        /**
+         * @brief Add #rdp_load_texture
+         *
+         * @param[out] used
+         *             If not NULL, set to the bytes of TMEM the texture takes
+         */
+        cursor<Used + 7> load_texture( texslot_t texslot, uint32_t texloc, mirror_t mirror, sprite_t *sprite, uint32_t *used = NULL )
+        {
+            uint32_t ret = rdp_load_texture( &ptr, texslot, texloc, mirror, sprite );
+
+            if( used ) { *used = ret; }
+
+            return next<7>();
+        }
+
+        /**
+         * @brief Add #rdp_load_texture_stride
+         *
+         * @param[out] used
+         *             If not NULL, set to the bytes of TMEM the texture takes
+         */
+        cursor<Used + 7> load_texture_stride( texslot_t texslot, uint32_t texloc, mirror_t mirror, sprite_t *sprite, int offset, uint32_t *used = NULL )
+        {
+            uint32_t ret = rdp_load_texture_stride( &ptr, texslot, texloc, mirror, sprite, offset );
+
+            if( used ) { *used = ret; }
+
+            return next<7>();
+        }
+
+        /** @brief Add #rdp_draw_textured_rectangle */
+        cursor<Used + 2> draw_textured_rectangle( texslot_t texslot, int tx, int ty, int bx, int by ) { rdp_draw_textured_rectangle( &ptr, texslot, tx, ty, bx, by ); return next<2>(); }
+        /** @brief Add #rdp_draw_textured_rectangle_scaled */
+        cursor<Used + 2> draw_textured_rectangle_scaled( texslot_t texslot, int tx, int ty, int bx, int by, double x_scale, double y_scale, int s_ul, int t_ul ) { rdp_draw_textured_rectangle_scaled( &ptr, texslot, tx, ty, bx, by, x_scale, y_scale, s_ul, t_ul ); return next<2>(); }
+        /** @brief Add #rdp_draw_sprite */
+        cursor<Used + 2> draw_sprite( texslot_t texslot, int x, int y ) { rdp_draw_sprite( &ptr, texslot, x, y ); return next<2>(); }
+        /** @brief Add #rdp_draw_sprite_scaled */
+        cursor<Used + 2> draw_sprite_scaled( texslot_t texslot, int x, int y, double x_scale, double y_scale ) { rdp_draw_sprite_scaled( &ptr, texslot, x, y, x_scale, y_scale ); return next<2>(); }
+        /** @brief Add #rdp_draw_filled_rectangle */
+        cursor<Used + 1> draw_filled_rectangle( int tx, int ty, int bx, int by ) { rdp_draw_filled_rectangle( &ptr, tx, ty, bx, by ); return next<1>(); }
+        /** @brief Add #rdp_draw_filled_triangle */
+        cursor<Used + 4> draw_filled_triangle( float x1, float y1, float x2, float y2, float x3, float y3 ) { rdp_draw_filled_triangle( &ptr, x1, y1, x2, y2, x3, y3 ); return next<4>(); }
+        /** @brief Add #rdp_draw_filled_triangle_fixed */
+        cursor<Used + 4> draw_filled_triangle_fixed( Fixed x1, Fixed y1, Fixed x2, Fixed y2, Fixed x3, Fixed y3 ) { rdp_draw_filled_triangle_fixed( &ptr, x1, y1, x2, y2, x3, y3 ); return next<4>(); }
+
+        /**
+         * @brief Add the end of the list with #rdp_end_display_list
+         */
+        void end()
+        {
+            static_assert( Used + 1 <= N, "display list too small for these commands" );
+
+            rdp_end_display_list( &ptr );
+        }
+
+        /** @brief Return the position, for the C functions */
+        display_list_t *get() const { return ptr; }
+
+    private:
+        /** @brief Return the cursor More commands on */
+        template <size_t More>
+        cursor<Used + More> next() const
+        {
+            static_assert( Used + More < N, "display list too small for these commands" );
+
+            return cursor<Used + More>( ptr );
+        }
+
+        /** @brief Next command to write */
+        display_list_t *ptr;
+    };
+
+    /** @brief Start adding commands from the beginning of the list */
+    cursor<0> begin() { return cursor<0>( commands ); }
+
+    /** @brief Return the commands, for the C functions */
+    display_list_t *data() { return commands; }
+
+    /** @brief Return the number of commands the list holds */
+    static constexpr size_t capacity() { return N; }
+
+    /**
+     * @brief Send the list to the RDP with #rdp_execute_display_list
+     */
+    void execute() { rdp_execute_display_list( commands, N, DISPLAY_LIST_RDRAM ); }
+
+private:
+    /** @brief The commands */
+    display_list_t commands[N] __attribute__((aligned(8)));
+};
+
+/** @} */
+
+}
+
+#endif
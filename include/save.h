@@ -0,0 +1,123 @@
+/**
+ * @file save.h
+ * @brief Save Store
+ * @ingroup save
+ */
+#ifndef __LIBDRAGON_SAVE_H
+#define __LIBDRAGON_SAVE_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup save
+ * @{
+ */
+
+/** @brief Most keys a store can hold */
+#define SAVE_MAX_KEYS       64
+/** @brief Largest write unit a medium may have */
+#define SAVE_MAX_UNIT       128
+/** @brief Key that cannot be used, as it reads back from erased media */
+#define SAVE_KEY_INVALID    0xFFFF
+
+/** @brief Power is never cut on a RAM medium, see #save_media_ram_cut */
+#define SAVE_NO_CUT         0xFFFFFFFF
+
+/**
+ * @name Save store return values
+ * @{
+ */
+/** @brief Success */
+#define SAVE_ESUCCESS       0
+/** @brief Input parameters invalid */
+#define SAVE_EBADINPUT      -1
+/** @brief Key not found */
+#define SAVE_ENOKEY         -2
+/** @brief Not enough free space, or too many keys */
+#define SAVE_ENOSPC         -3
+/** @brief The medium reported an error */
+#define SAVE_EIO            -4
+/** @brief No store found on the medium, see #save_format */
+#define SAVE_ENOFS          -5
+/** @} */
+
+/**
+ * @brief A save medium
+ *
+ * The medium is split into segments, the unit the store rotates through
+ * and, on media that need it, the unit of erasing.  Writes are always whole
+ * write units at offsets that are a multiple of the write unit.
+ */
+typedef struct save_media_s
+{
+    /** @brief Size in bytes */
+    uint32_t size;
+    /** @brief Size of a segment in bytes, 3 to 32 must fit */
+    uint32_t segment_size;
+    /** @brief Size of a write in bytes, a power of two of at least 8 */
+    uint32_t write_unit;
+    /**
+     * @brief Read bytes at any offset
+     *
+     * @return 0 on success or a negative value on error
+     */
+    int (*read)( struct save_media_s *media, uint32_t offset, void *buf, uint32_t len );
+    /**
+     * @brief Write whole write units
+     *
+     * @return 0 on success or a negative value on error
+     */
+    int (*write)( struct save_media_s *media, uint32_t offset, const void *buf, uint32_t len );
+    /**
+     * @brief Erase the segment at an offset to all ones, NULL if the medium
+     *        can be overwritten in place
+     *
+     * @return 0 on success or a negative value on error
+     */
+    int (*erase)( struct save_media_s *media, uint32_t offset );
+    /** @brief Data for the medium's functions */
+    void *ctx;
+} save_media_t;
+
+/**
+ * @brief Save store statistics
+ */
+typedef struct
+{
+    /** @brief Bytes written to the medium since mounting, including relocations */
+    uint32_t bytes_written;
+    /** @brief Segments erased or reused */
+    uint32_t segments_used;
+    /** @brief Records copied forward to free a segment */
+    uint32_t relocations;
+    /** @brief Bytes of live data, including record headers */
+    uint32_t live_bytes;
+    /** @brief Most live data the store can hold */
+    uint32_t capacity;
+} save_stats_t;
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void save_media_eeprom( save_media_t *media, int blocks );
+void save_media_sram( save_media_t *media, uint32_t size );
+void save_media_flashram( save_media_t *media );
+void save_media_ram( save_media_t *media, void *buf, uint32_t size, uint32_t segment_size, uint32_t write_unit, int erasable );
+void save_media_ram_cut( uint32_t bytes );
+
+int save_format( save_media_t *media );
+int save_mount( save_media_t *media );
+void save_unmount( void );
+int save_read( uint16_t key, void *buf, int size );
+int save_write( uint16_t key, const void *data, int len );
+int save_delete( uint16_t key );
+void save_get_stats( save_stats_t *stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file sd.h
+ * @brief SD Card
+ * @ingroup sd
+ */
+#ifndef __LIBDRAGON_SD_H
+#define __LIBDRAGON_SD_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup sd
+ * @{
+ */
+
+/** @brief Size of an SD card sector in bytes */
+#define SD_SECTOR_SIZE      512
+/** @brief Sectors read from the card per command */
+#define SD_CHUNK_SECTORS    16
+/** @brief Size in bytes of each half of the staging area */
+#define SD_CHUNK_SIZE       (SD_CHUNK_SECTORS * SD_SECTOR_SIZE)
+/**
+ * @brief Offset of the staging area in cartridge SDRAM
+ *
+ * Two chunks right below the 64drive debug area at 63 MiB, so the ROM must
+ * end before this.
+ */
+#define SD_SDRAM_AREA       (0x3F00000 - 2 * SD_CHUNK_SIZE)
+/** @brief Files that can be open on the SD filesystem at once */
+#define SD_MAX_OPEN_FILES   4
+
+/**
+ * @name SD return values
+ * @{
+ */
+/** @brief Success */
+#define SD_ESUCCESS         0
+/** @brief No 64drive found or #sd_init not called */
+#define SD_ENODEV           -1
+/** @brief Input parameters invalid */
+#define SD_EBADINPUT        -2
+/** @brief The cartridge did not finish a command in time */
+#define SD_ETIMEOUT         -3
+/** @} */
+
+/**
+ * @brief Access to the cartridge interface used by the SD driver
+ *
+ * The default backend talks to a 64drive.  #sd_sim_backend returns one that
+ * emulates it over a disk image in memory.
+ */
+typedef struct
+{
+    /**
+     * @brief Read a cartridge interface register
+     *
+     * @param[in] reg
+     *            Register offset, such as CI_REG_STATUS
+     *
+     * @return The value of the register
+     */
+    uint32_t (*reg_read)( uint32_t reg );
+    /**
+     * @brief Write a cartridge interface register
+     *
+     * @param[in] reg
+     *            Register offset, such as CI_REG_COMMAND
+     * @param[in] value
+     *            Value to write
+     */
+    void (*reg_write)( uint32_t reg, uint32_t value );
+    /**
+     * @brief Copy from cartridge SDRAM to RDRAM
+     *
+     * The driver only passes whole cache lines that belong to it, so the
+     * rest of the last line may be overwritten.
+     *
+     * @param[out] ram
+     *             16 byte aligned destination
+     * @param[in]  sdram
+     *             Offset in cartridge SDRAM, a multiple of 8
+     * @param[in]  len
+     *             Number of bytes
+     */
+    void (*sdram_read)( void *ram, uint32_t sdram, uint32_t len );
+} sd_backend_t;
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int sd_init( const sd_backend_t *backend );
+void sd_close( void );
+int sd_read_sectors( uint32_t lba, uint32_t count, void *buf );
+const sd_backend_t *sd_sim_backend( const void *image, uint32_t num_sectors );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -47,6 +47,13 @@ typedef struct
     /** 
      * @brief Function to call when performing a fstat command
      *
+     * Filesystems should set st_blksize to their preferred transfer size in
+     * bytes.  newlib's stdio uses it as the size of the buffer of a stream,
+     * so it should be a multiple of any alignment reads benefit from.  The
+     * buffers stdio allocates are 8 byte aligned, as required for DMA.  Any
+     * field left untouched reads as zero, in which case stdio picks its own
+     * default buffer size.
+     *
      * @param[in]  file
      *             Arbitrary file handle returned by #filesystem_t::open
      * @param[out] st
@@ -184,6 +191,8 @@ typedef struct
 int attach_filesystem( const char * const prefix, filesystem_t *filesystem );
 int detach_filesystem( const char * const prefix );
 
+int sys_set_heap_limit( void *limit );
+
 int hook_stdio_calls( stdio_t *stdio_calls );
 int unhook_stdio_calls();
 
@@ -0,0 +1,197 @@
+/**
+ * @file thread.h
+ * @brief Threads
+ * @ingroup thread
+ */
+#ifndef __LIBDRAGON_THREAD_H
+#define __LIBDRAGON_THREAD_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup thread
+ * @{
+ */
+
+/** @brief Default stack size in bytes for a new thread */
+#define THREAD_DEFAULT_STACK_SIZE   ( 8 * 1024 )
+/** @brief Smallest stack size in bytes that a thread may be created with */
+#define THREAD_MIN_STACK_SIZE       ( 1 * 1024 )
+
+/** @brief Lowest thread priority */
+#define THREAD_PRIORITY_MIN         0
+/** @brief Priority given to new threads and the main thread */
+#define THREAD_PRIORITY_DEFAULT     16
+/** @brief Highest thread priority */
+#define THREAD_PRIORITY_MAX         31
+
+/**
+ * @brief State of a thread
+ */
+typedef enum
+{
+    /** @brief Thread is able to run */
+    THREAD_STATE_READY,
+    /** @brief Thread is currently running */
+    THREAD_STATE_RUNNING,
+    /** @brief Thread is sleeping until a tick count is reached */
+    THREAD_STATE_SLEEPING,
+    /** @brief Thread is waiting for an event to be signaled */
+    THREAD_STATE_WAITING,
+    /** @brief Thread is waiting for a mutex to be unlocked */
+    THREAD_STATE_LOCKING,
+    /** @brief Thread has returned from its entry point */
+    THREAD_STATE_FINISHED
+} thread_state_t;
+
+/**
+ * @brief Saved register context of a suspended thread
+ *
+ * Only registers preserved across function calls are stored, as a switch
+ * only ever happens inside a call into the scheduler.
+ *
+ * DO NOT modify the order unless editing thread_switch.S
+ */
+typedef struct
+{
+    /** @brief Saved registers s0-s7 */
+    uint64_t s[8];
+    /** @brief Global pointer */
+    uint64_t gp;
+    /** @brief Stack pointer */
+    uint64_t sp;
+    /** @brief Frame pointer */
+    uint64_t fp;
+    /** @brief Return address, which is where the thread resumes */
+    uint64_t ra;
+    /** @brief Floating point registers 20-31 */
+    uint64_t fpr[12];
+} thread_context_t;
+
+/**
+ * @brief Event that threads can wait on
+ *
+ * An event is a flag that can be signaled from anywhere, including
+ * interrupt handlers.  A thread waiting on the event will be woken
+ * and the event cleared again once it runs.
+ */
+typedef struct
+{
+    /** @brief Nonzero if the event has been signaled */
+    volatile int signaled;
+} thread_event_t;
+
+struct thread;
+struct _reent;
+
+/**
+ * @brief Mutex with priority inheritance
+ *
+ * While a thread holds a mutex, it runs at the highest priority of the
+ * threads waiting for it, so that a low priority thread holding a lock
+ * can't hold up a high priority thread indefinitely.
+ */
+typedef struct
+{
+    /** @brief Thread currently holding the mutex or null if unlocked */
+    struct thread * volatile owner;
+} thread_mutex_t;
+
+/**
+ * @brief Thread structure
+ */
+typedef struct thread
+{
+    /** @brief Saved context while the thread is not running */
+    thread_context_t ctx;
+    /** @brief Current state of the thread */
+    volatile thread_state_t state;
+    /** @brief Priority the thread runs at, including inherited priority */
+    int priority;
+    /** @brief Priority set with #thread_set_priority */
+    int base_priority;
+    /** @brief Tick count to wake up at when sleeping */
+    long long wake_tick;
+    /** @brief Event being waited on when waiting */
+    thread_event_t *event;
+    /** @brief Mutex being waited on when locking */
+    thread_mutex_t *mutex;
+    /** @brief Ticks spent running, not counting the current time slice */
+    long long cpu_ticks;
+    /** @brief Nonzero while the thread is being preempted */
+    volatile int preempted;
+    /** @brief Address the thread was interrupted at when preempted */
+    uint32_t preempt_epc;
+    /** @brief Nesting depth of sections the thread must not be preempted in */
+    int preempt_disable;
+    /** @brief Nonzero if a preemption was put off until the section ends */
+    volatile int preempt_deferred;
+    /** @brief Newlib state of the thread, holding errno and the standard streams */
+    struct _reent *reent;
+    /** @brief Entry point of the thread */
+    void (*entry)(void *arg);
+    /** @brief Argument passed to the entry point */
+    void *arg;
+    /** @brief Stack allocated for this thread, or null for the main thread */
+    void *stack;
+    /** @brief Size in bytes of the stack */
+    int stack_size;
+    /** @brief Link to next thread */
+    struct thread *next;
+} thread_t;
+
+/** @brief Static initializer for a #thread_event_t */
+#define THREAD_EVENT_INIT { 0 }
+/** @brief Static initializer for a #thread_mutex_t */
+#define THREAD_MUTEX_INIT { 0 }
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* initialize the thread subsystem, turning the caller into the main thread */
+void thread_init(void);
+/* create a new thread that is ready to run */
+thread_t *thread_create(void (*entry)(void *arg), void *arg, int stack_size);
+/* return the currently running thread */
+thread_t *thread_self(void);
+/* let other ready threads run */
+void thread_yield(void);
+/* sleep until the timer reaches the given tick count */
+void thread_sleep_until(long long tick);
+/* sleep for the given number of ticks */
+void thread_sleep(long long ticks);
+/* end the current thread */
+void thread_exit(void);
+/* wait for a thread to finish and free it */
+void thread_join(thread_t *thread);
+/* return nonzero if the calling code may block */
+int thread_can_block(void);
+/* change the priority of a thread */
+void thread_set_priority(thread_t *thread, int priority);
+/* return the priority set for a thread */
+int thread_get_priority(thread_t *thread);
+/* round robin between threads of equal priority every given number of ticks */
+void thread_set_timeslice(int ticks);
+/* return the ticks a thread has spent running */
+long long thread_get_cpu_ticks(thread_t *thread);
+/* return the ticks spent with no thread able to run */
+long long thread_get_idle_ticks(void);
+
+void thread_event_init(thread_event_t *event);
+void thread_event_signal(thread_event_t *event);
+void thread_event_clear(thread_event_t *event);
+int thread_event_wait(thread_event_t *event);
+
+void thread_mutex_init(thread_mutex_t *mutex);
+void thread_mutex_lock(thread_mutex_t *mutex);
+int thread_mutex_trylock(thread_mutex_t *mutex);
+void thread_mutex_unlock(thread_mutex_t *mutex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
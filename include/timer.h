@@ -93,6 +93,8 @@ void delete_timer(timer_link_t *timer);
 void timer_close(void);
 /* return total ticks since timer was initialized */
 long long timer_ticks(void);
+/* return total ticks since timer was initialized without processing timers */
+long long timer_ticks_fast(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,190 @@
+/**
+ * @file trace.h
+ * @brief Event Tracing
+ * @ingroup trace
+ */
+#ifndef __LIBDRAGON_TRACE_H
+#define __LIBDRAGON_TRACE_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup trace
+ * @{
+ */
+
+/** @brief Magic number at the start of a trace dump, "N64T" */
+#define TRACE_MAGIC             0x4E363454
+/** @brief Version of the trace dump format */
+#define TRACE_VERSION           1
+/** @brief Number of event names that can be registered */
+#define TRACE_MAX_NAMES         128
+/** @brief Longest event name stored in a dump, including the terminator */
+#define TRACE_NAME_LEN          32
+/** @brief Number of events recorded by default */
+#define TRACE_DEFAULT_EVENTS    8192
+
+/**
+ * @brief Kinds of trace events
+ */
+typedef enum
+{
+    /** @brief Start of a section */
+    TRACE_EVENT_BEGIN,
+    /** @brief End of a section */
+    TRACE_EVENT_END,
+    /** @brief New value of a counter */
+    TRACE_EVENT_COUNTER,
+    /** @brief Something happening at a single point in time */
+    TRACE_EVENT_INSTANT
+} trace_event_type_t;
+
+/**
+ * @brief Event names recorded by libdragon itself
+ */
+enum
+{
+    /** @brief Vertical blank interrupt */
+    TRACE_ID_VBLANK,
+    /** @brief A frame was handed to #display_show */
+    TRACE_ID_DISPLAY_SHOW,
+    /** @brief A display list was sent to the RDP, the value is its length */
+    TRACE_ID_RDP_SUBMIT,
+    /** @brief The RDP finished a full sync */
+    TRACE_ID_RDP_SYNC,
+    /** @brief Audio interrupt refilling the audio buffers */
+    TRACE_ID_AUDIO,
+    /** @brief DMA from cartridge space, the value is its length */
+    TRACE_ID_DMA_READ,
+    /** @brief DMA to cartridge space, the value is its length */
+    TRACE_ID_DMA_WRITE,
+    /** @brief Timer interrupt processing */
+    TRACE_ID_TIMER,
+    /** @brief First ID handed out by #trace_register */
+    TRACE_ID_FIRST_USER
+};
+
+/**
+ * @brief A recorded event
+ *
+ * Dumps hold these in big endian byte order, oldest first.
+ */
+typedef struct
+{
+    /** @brief Low 32 bits of the timer tick count, see #timer_ticks_fast */
+    uint32_t time;
+    /** @brief Name ID of the event */
+    uint16_t id;
+    /** @brief A #trace_event_type_t */
+    uint8_t type;
+    /** @brief 0 for normal code, otherwise the interrupt nesting depth */
+    uint8_t track;
+    /** @brief Counter value, or an argument of the event */
+    int32_t value;
+} trace_event_t;
+
+/**
+ * @brief Header at the start of a trace dump
+ *
+ * It is followed by #trace_header_t::num_names names of #TRACE_NAME_LEN
+ * bytes, indexed by event ID, then by #trace_header_t::num_events events.
+ */
+typedef struct
+{
+    /** @brief Always #TRACE_MAGIC */
+    uint32_t magic;
+    /** @brief Always #TRACE_VERSION */
+    uint16_t version;
+    /** @brief Size of a #trace_event_t */
+    uint16_t event_size;
+    /** @brief Timer ticks per second */
+    uint32_t ticks_per_second;
+    /** @brief Number of names following the header */
+    uint32_t num_names;
+    /** @brief Number of events following the names */
+    uint32_t num_events;
+    /** @brief Number of older events that were overwritten */
+    uint32_t overwritten;
+} trace_header_t;
+
+/** @brief Nonzero while events are being recorded */
+extern volatile int __trace_active;
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int trace_init( int num_events );
+void trace_close( void );
+void trace_start( void );
+void trace_stop( void );
+void trace_reset( void );
+int trace_register( const char *name );
+void __trace_record( int type, int id, int value );
+int trace_dump_size( void );
+int trace_dump( void *buf, int size );
+int trace_dump_usb( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @brief Return the ID of an event name, registering it on first use
+ *
+ * @param[in] name
+ *            Constant string naming the event
+ */
+#define TRACE_ID(name) ({ static int __id = -1; if( __id < 0 ) { __id = trace_register( name ); } __id; })
+
+/**
+ * @brief Record the start of a section
+ *
+ * @param[in] id
+ *            Event ID
+ */
+static inline void trace_begin( int id )
+{
+    if( __trace_active ) { __trace_record( TRACE_EVENT_BEGIN, id, 0 ); }
+}
+
+/**
+ * @brief Record the end of a section started with #trace_begin
+ *
+ * @param[in] id
+ *            Event ID
+ */
+static inline void trace_end( int id )
+{
+    if( __trace_active ) { __trace_record( TRACE_EVENT_END, id, 0 ); }
+}
+
+/**
+ * @brief Record a new value of a counter
+ *
+ * @param[in] id
+ *            Event ID
+ * @param[in] value
+ *            Value of the counter
+ */
+static inline void trace_counter( int id, int value )
+{
+    if( __trace_active ) { __trace_record( TRACE_EVENT_COUNTER, id, value ); }
+}
+
+/**
+ * @brief Record an event at a single point in time
+ *
+ * @param[in] id
+ *            Event ID
+ * @param[in] value
+ *            Argument shown with the event
+ */
+static inline void trace_instant( int id, int value )
+{
+    if( __trace_active ) { __trace_record( TRACE_EVENT_INSTANT, id, value ); }
+}
+
+#endif
@@ -40,7 +40,11 @@ SECTIONS {
       *(.boot)
 	  . = ALIGN(16);
       __text_start = . ;
+      /* Hot code first, then functions in the order given by n64order */
+      *(.text.hot .text.hot.*)
+      INCLUDE n64order.ld
       *(.text)
+      *(.text.*)
       *(.ctors)
       *(.dtors)
       *(.rodata)
@@ -68,6 +72,7 @@ SECTIONS {
 
 	  . = ALIGN(16);
       __data_start = . ;
+         *(.data.hot .data.hot.*)
          *(.data)
          *(.lit8)
          *(.lit4) ;
@@ -34,6 +34,9 @@ SECTIONS {
       *(.boot)
 	  . = ALIGN(16);
       __text_start = . ;
+      /* Hot code first, then functions in the order given by n64order */
+      *(.text.hot .text.hot.*)
+      INCLUDE n64order.ld
 	  *(.text)
       *(.text.*)
       *(.init)
@@ -75,6 +78,7 @@ SECTIONS {
    .data : {
 	  . = ALIGN(8);
 	  __data_start = . ;
+         *(.data.hot .data.hot.*)
          *(.data)
 		 *(.data.*)
 		 *(.gnu.linkonce.d.*)
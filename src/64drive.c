@@ -9,6 +9,33 @@ uint32_t ci_base = CART_BASE_UNCACHED + CI_REG_BASE;
 
 char local_buffer[512];
 
+// parameters of a USB write whose data is still being sent over the PI,
+// or zero if there is none
+static volatile uint32_t usb_pending_param1 = 0;
+static int usb_handler_registered = 0;
+
+//
+// _64Drive_usb_finish
+//
+// Issues the USB command of a pending write once its data is in SDRAM.
+// Called from the PI interrupt, and polled as well so that writes also
+// complete with interrupts disabled.
+//
+static void _64Drive_usb_finish()
+{
+	uint32_t state = interrupt_disable_save();
+
+	if(usb_pending_param1 && !dma_busy())
+	{
+		io_write(ci_base + CI_REG_USB_PARAM0, (ci_dbg_area) >> 1);
+		io_write(ci_base + CI_REG_USB_PARAM1, usb_pending_param1);
+		io_write(ci_base + CI_REG_USB_CMDSTAT, CI_CMD_USB_WR);
+		usb_pending_param1 = 0;
+	}
+
+	interrupt_restore(state);
+}
+
 void _64Drive_putstring(char *str)
 {
 #ifndef WITH_64DRIVE
@@ -39,6 +66,11 @@ void _64Drive_putstring(char *str)
 uint32_t _64Drive_usb_status_write()
 {
 	uint32_t a;
+
+	// a write whose data is still on its way counts as busy
+	_64Drive_usb_finish();
+	if(usb_pending_param1) return CI_STAT_USB_WR_BUSY;
+
 	a = io_read(ci_base + CI_REG_USB_CMDSTAT);
 	return (a >> 4) & 0xf;
 }
@@ -48,6 +80,56 @@ void _64Drive_usb_spin_write()
 	while(_64Drive_usb_status_write() != CI_STAT_USB_WR_IDLE);
 }
 
+//
+// _64Drive_usb_write_data
+//
+// Starts a USB write without waiting for anything, so it can be called
+// from an interrupt handler. The data is sent to SDRAM with a PI DMA that
+// runs in the background, and the USB command is issued once the PI
+// interrupt reports it done, or by the next status poll. The buffer must
+// stay untouched until _64Drive_usb_status_write reports idle again.
+// The ROM must already be writable.
+// Arguments:
+//  data     : 8 byte aligned buffer, readable up to a multiple of 4 bytes
+//  len      : bytes to send, at most ci_dbg_area_size
+//  datatype : USB_DATATYPE_TEXT or USB_DATATYPE_BINARY
+//
+// Return value:
+//   0 : USB or PI busy, nothing was sent
+//  len: the write was started
+//
+int _64Drive_usb_write_data(const void *data, int len, int datatype)
+{
+#ifndef WITH_64DRIVE
+	return 0;
+#endif
+
+	if(_64Drive_usb_status_write() != CI_STAT_USB_WR_IDLE) return 0;
+
+	int len_new = (len + 3) & ~3;
+	int started;
+
+	data_cache_hit_writeback((void *)data, len_new);
+
+	// the PI interrupt may only see the write as pending once it started
+	uint32_t state = interrupt_disable_save();
+	started = dma_write_start((void *)data, CART_BASE_UNCACHED + ci_dbg_area, len_new);
+	if(started) usb_pending_param1 = (len_new & 0xffffff) | (datatype << 24);
+	interrupt_restore(state);
+
+	return started ? len : 0;
+}
+
+//
+// _64Drive_usb_write_async
+//
+// Same as _64Drive_usb_write_data, sending text.
+//
+int _64Drive_usb_write_async(const void *data, int len)
+{
+	return _64Drive_usb_write_data(data, len, USB_DATATYPE_TEXT);
+}
+
 //
 // ci_wait
 //
@@ -74,6 +156,14 @@ uint32_t _64Drive_wait()
 
 void _64Drive_rom_writable(uint32_t enable)
 {
+	// USB writes are finished from the PI interrupt once their data is sent
+	if(enable && !usb_handler_registered)
+	{
+		register_PI_handler(_64Drive_usb_finish);
+		set_PI_interrupt(1);
+		usb_handler_registered = 1;
+	}
+
 	_64Drive_wait();
 	io_write(ci_base + CI_REG_COMMAND, enable ? CI_CMD_ENABLE_ROMWR : CI_CMD_DISABLE_ROMWR);
 	_64Drive_wait();
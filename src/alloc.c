@@ -0,0 +1,736 @@
+/**
+ * @file alloc.c
+ * @brief Memory Allocators
+ * @ingroup alloc
+ */
+#include <malloc.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "libdragon.h"
+#include "system.h"
+
+/**
+ * @defgroup alloc Memory Allocators
+ * @ingroup libdragon
+ * @brief Special purpose allocators on top of the heap.
+ *
+ * Allocating everything through malloc works, but a long running game that
+ * allocates and frees objects of all sizes every frame will slowly fragment
+ * the heap, and every malloc call has to search it.  This module provides
+ * allocators for the common patterns that avoid both problems.
+ *
+ * An arena, set up with #arena_init, hands out memory from a fixed buffer by
+ * bumping a pointer, and forgets every allocation at once with #arena_reset.
+ * It suits data that only lives for one frame.
+ *
+ * A pool, set up with #pool_init, holds a fixed number of objects of the
+ * same size.  #pool_alloc and #pool_free take constant time and never
+ * fragment, which suits game objects, particles and similar.
+ *
+ * A bank heap, set up with #bank_heap_init, hands out blocks that are
+ * aligned to and padded to whole data cache lines, which makes them safe to
+ * use as DMA buffers.  Blocks can be placed in a specific 1 MiB RDRAM bank,
+ * so that memory accessed by the RDP and memory accessed by the CPU at the
+ * same time don't compete for the same bank.  A default bank heap for DMA
+ * buffers is available through #dma_heap_init, #dma_alloc and #dma_free.
+ *
+ * With an Expansion Pak, #high_heap_init sets aside the upper 4 MiB of RDRAM
+ * as a separate bank heap for large buffers such as asset caches and
+ * framebuffers, allocated with #high_alloc.  malloc is then limited to the
+ * lower 4 MiB, so that RDP framebuffer traffic and CPU heap traffic go to
+ * different RDRAM chips.  #get_memory_size reports how much RDRAM there is.
+ *
+ * Every allocator keeps statistics, including the high water mark and, for
+ * bank heaps, how fragmented the free memory is.  They can be read with the
+ * matching get_stats function.  All allocators may be used from interrupt
+ * handlers.
+ * @{
+ */
+
+/** @brief Round a size up to a multiple of a power of two */
+#define ROUND_UP(x, align) (((x) + (align) - 1) & ~((align) - 1))
+
+/** @brief Marks a block of a bank heap as allocated */
+#define BLOCK_USED      0xB10CB10C
+/** @brief Marks a block of a bank heap as free */
+#define BLOCK_FREE      0xF4EEF4EE
+
+/**
+ * @brief Header in front of each block of a bank heap
+ *
+ * The header takes a whole cache line so that the data after it starts on
+ * a cache line boundary.
+ */
+typedef struct bank_block
+{
+    /** @brief Size of the block including this header */
+    uint32_t size;
+    /** @brief Either #BLOCK_USED or #BLOCK_FREE */
+    uint32_t magic;
+    /** @brief Next free block when free */
+    struct bank_block *next;
+} __attribute__((aligned(ALLOC_CACHE_LINE))) bank_block_t;
+
+/**
+ * @brief Memory kept free below the top of RDRAM for the stack
+ *
+ * The stack starts at the top of RDRAM, which is inside the Expansion Pak.
+ * This matches the room that sbrk leaves for it.
+ */
+#define STACK_RESERVE   0x10000
+
+/** @brief Default heap for DMA buffers */
+static bank_heap_t dma_heap = { 0 };
+/** @brief Heap over the upper 4 MiB of RDRAM */
+static bank_heap_t high_heap = { 0 };
+
+/**
+ * @brief Account an allocation in a set of statistics
+ *
+ * @param[in,out] stats
+ *                Statistics to update
+ * @param[in]     size
+ *                Size of the allocation in bytes
+ */
+static inline void __stats_alloc( alloc_stats_t *stats, uint32_t size )
+{
+    stats->used += size;
+    stats->allocs++;
+
+    if( stats->used > stats->high_water ) { stats->high_water = stats->used; }
+}
+
+/**
+ * @brief Initialize an arena
+ *
+ * @param[out] arena
+ *             Arena to initialize
+ * @param[in]  buffer
+ *             Memory to allocate from, or null to allocate it from the heap
+ * @param[in]  size
+ *             Size of the memory in bytes
+ *
+ * @retval 0 on success
+ * @retval -1 if the memory could not be allocated
+ */
+int arena_init( arena_t *arena, void *buffer, uint32_t size )
+{
+    memset( arena, 0, sizeof(arena_t) );
+
+    if( !buffer )
+    {
+        buffer = memalign( ALLOC_CACHE_LINE, size );
+        if( !buffer ) { return -1; }
+
+        arena->owned = 1;
+    }
+
+    arena->base = buffer;
+    arena->size = size;
+    arena->stats.size = size;
+
+    return 0;
+}
+
+/**
+ * @brief Allocate memory from an arena
+ *
+ * @param[in] arena
+ *            Arena to allocate from
+ * @param[in] size
+ *            Size of the allocation in bytes
+ * @param[in] align
+ *            Required alignment, a power of two, or 0 for 8 bytes
+ *
+ * @return Pointer to the memory or null if the arena is full
+ */
+void *arena_alloc( arena_t *arena, uint32_t size, uint32_t align )
+{
+    void *ptr = 0;
+
+    if( !align ) { align = 8; }
+
+    uint32_t state = interrupt_disable_save();
+
+    uint32_t start = ROUND_UP( (uint32_t)arena->base + arena->used, align ) - (uint32_t)arena->base;
+
+    if( start + size <= arena->size && start + size >= start )
+    {
+        ptr = arena->base + start;
+
+        /* Padding for alignment counts as used */
+        __stats_alloc( &arena->stats, start + size - arena->used );
+        arena->used = start + size;
+    }
+    else
+    {
+        arena->stats.failures++;
+    }
+
+    interrupt_restore( state );
+
+    return ptr;
+}
+
+/**
+ * @brief Release every allocation made from an arena
+ *
+ * @param[in] arena
+ *            Arena to reset
+ */
+void arena_reset( arena_t *arena )
+{
+    uint32_t state = interrupt_disable_save();
+
+    arena->used = 0;
+    arena->stats.used = 0;
+    arena->stats.frees++;
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Close an arena, freeing its memory if it was allocated by #arena_init
+ *
+ * @param[in] arena
+ *            Arena to close
+ */
+void arena_close( arena_t *arena )
+{
+    if( arena->owned ) { free( arena->base ); }
+
+    memset( arena, 0, sizeof(arena_t) );
+}
+
+/**
+ * @brief Read the statistics of an arena
+ *
+ * @param[in]  arena
+ *             Arena to query
+ * @param[out] stats
+ *             Structure to fill with statistics
+ */
+void arena_get_stats( arena_t *arena, alloc_stats_t *stats )
+{
+    uint32_t state = interrupt_disable_save();
+
+    *stats = arena->stats;
+
+    interrupt_restore( state );
+
+    stats->free_blocks = arena->used < arena->size ? 1 : 0;
+    stats->largest_free = arena->size - arena->used;
+    stats->fragmentation = 0;
+}
+
+/**
+ * @brief Initialize a pool of fixed size objects
+ *
+ * @param[out] pool
+ *             Pool to initialize
+ * @param[in]  obj_size
+ *             Size of each object in bytes
+ * @param[in]  count
+ *             Number of objects in the pool
+ * @param[in]  buffer
+ *             Memory for the objects, at least @p count times @p obj_size
+ *             rounded up to 8 bytes, or null to allocate it from the heap
+ *
+ * @retval 0 on success
+ * @retval -1 if the memory could not be allocated
+ */
+int pool_init( pool_t *pool, uint32_t obj_size, uint32_t count, void *buffer )
+{
+    memset( pool, 0, sizeof(pool_t) );
+
+    /* Free objects hold the free list link */
+    if( obj_size < sizeof(void *) ) { obj_size = sizeof(void *); }
+    obj_size = ROUND_UP( obj_size, 8 );
+
+    if( !buffer )
+    {
+        buffer = memalign( ALLOC_CACHE_LINE, obj_size * count );
+        if( !buffer ) { return -1; }
+
+        pool->owned = 1;
+    }
+
+    pool->base = buffer;
+    pool->obj_size = obj_size;
+    pool->count = count;
+    pool->stats.size = obj_size * count;
+
+    /* Chain every object into the free list, first object first */
+    for( int i = count - 1; i >= 0; i-- )
+    {
+        void **obj = (void **)(pool->base + i * obj_size);
+
+        *obj = pool->free_list;
+        pool->free_list = obj;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Allocate an object from a pool
+ *
+ * @param[in] pool
+ *            Pool to allocate from
+ *
+ * @return Pointer to the object or null if every object is in use
+ */
+void *pool_alloc( pool_t *pool )
+{
+    uint32_t state = interrupt_disable_save();
+
+    void **obj = pool->free_list;
+
+    if( obj )
+    {
+        pool->free_list = *obj;
+        __stats_alloc( &pool->stats, pool->obj_size );
+    }
+    else
+    {
+        pool->stats.failures++;
+    }
+
+    interrupt_restore( state );
+
+    return obj;
+}
+
+/**
+ * @brief Return an object to a pool
+ *
+ * @param[in] pool
+ *            Pool the object was allocated from
+ * @param[in] obj
+ *            Object to free.  Objects not belonging to the pool are ignored.
+ */
+void pool_free( pool_t *pool, void *obj )
+{
+    uint32_t offset = (uint8_t *)obj - pool->base;
+
+    if( !obj || offset >= pool->stats.size || offset % pool->obj_size ) { return; }
+
+    uint32_t state = interrupt_disable_save();
+
+    *(void **)obj = pool->free_list;
+    pool->free_list = obj;
+    pool->stats.used -= pool->obj_size;
+    pool->stats.frees++;
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Close a pool, freeing its memory if it was allocated by #pool_init
+ *
+ * @param[in] pool
+ *            Pool to close
+ */
+void pool_close( pool_t *pool )
+{
+    if( pool->owned ) { free( pool->base ); }
+
+    memset( pool, 0, sizeof(pool_t) );
+}
+
+/**
+ * @brief Read the statistics of a pool
+ *
+ * @param[in]  pool
+ *             Pool to query
+ * @param[out] stats
+ *             Structure to fill with statistics
+ */
+void pool_get_stats( pool_t *pool, alloc_stats_t *stats )
+{
+    uint32_t state = interrupt_disable_save();
+
+    *stats = pool->stats;
+
+    interrupt_restore( state );
+
+    /* Any free object is as good as any other */
+    stats->free_blocks = (stats->size - stats->used) / pool->obj_size;
+    stats->largest_free = stats->free_blocks ? pool->obj_size : 0;
+    stats->fragmentation = 0;
+}
+
+/**
+ * @brief Initialize a bank heap
+ *
+ * @param[out] heap
+ *             Heap to initialize
+ * @param[in]  base
+ *             Memory to manage, or null to allocate it from the heap
+ * @param[in]  size
+ *             Size of the memory in bytes
+ *
+ * @retval 0 on success
+ * @retval -1 if the memory could not be allocated or is too small
+ */
+int bank_heap_init( bank_heap_t *heap, void *base, uint32_t size )
+{
+    memset( heap, 0, sizeof(bank_heap_t) );
+
+    if( !base )
+    {
+        size = ROUND_UP( size, ALLOC_CACHE_LINE );
+        base = memalign( ALLOC_CACHE_LINE, size );
+        if( !base ) { return -1; }
+
+        heap->owned = 1;
+    }
+    else
+    {
+        /* Only manage whole cache lines */
+        uint32_t start = ROUND_UP( (uint32_t)base, ALLOC_CACHE_LINE );
+        uint32_t end = ((uint32_t)base + size) & ~(ALLOC_CACHE_LINE - 1);
+
+        if( end <= start ) { return -1; }
+
+        base = (void *)start;
+        size = end - start;
+    }
+
+    if( size < 2 * sizeof(bank_block_t) ) { return -1; }
+
+    heap->base = base;
+    heap->size = size;
+    heap->stats.size = size;
+
+    /* Everything starts out as a single free block */
+    heap->free_list = (bank_block_t *)base;
+    heap->free_list->size = size;
+    heap->free_list->magic = BLOCK_FREE;
+    heap->free_list->next = 0;
+
+    return 0;
+}
+
+/**
+ * @brief Allocate a cache line aligned block from a bank heap
+ *
+ * @param[in] heap
+ *            Heap to allocate from
+ * @param[in] size
+ *            Size of the block in bytes
+ * @param[in] bank
+ *            RDRAM bank the block must be entirely placed in, counting 1 MiB
+ *            banks from the start of RDRAM, or #BANK_ANY
+ *
+ * @return Pointer to the block or null if no free memory fits
+ */
+void *bank_heap_alloc( bank_heap_t *heap, uint32_t size, int bank )
+{
+    uint32_t need = sizeof(bank_block_t) + ROUND_UP( size, ALLOC_CACHE_LINE );
+    bank_block_t *block = 0;
+
+    if( !heap->base || !size ) { return 0; }
+
+    uint32_t state = interrupt_disable_save();
+
+    /* First fit, walking free blocks in address order */
+    for( bank_block_t **link = &heap->free_list; *link; link = &(*link)->next )
+    {
+        bank_block_t *free_block = *link;
+        uint32_t start = (uint32_t)free_block;
+        uint32_t end = start + free_block->size;
+
+        if( bank != BANK_ANY )
+        {
+            /* Clip the free block to the bank, in the same memory segment */
+            uint32_t bank_start = (start & 0xE0000000) | (bank * RDRAM_BANK_SIZE);
+            uint32_t bank_end = bank_start + RDRAM_BANK_SIZE;
+
+            if( start < bank_start ) { start = bank_start; }
+            if( end > bank_end ) { end = bank_end; }
+        }
+
+        if( end <= start || end - start < need ) { continue; }
+
+        bank_block_t *rest = 0;
+        uint32_t front = start - (uint32_t)free_block;
+        uint32_t back = (uint32_t)free_block + free_block->size - (start + need);
+
+        if( back )
+        {
+            /* Keep what is left after the block free */
+            rest = (bank_block_t *)(start + need);
+            rest->size = back;
+            rest->magic = BLOCK_FREE;
+            rest->next = free_block->next;
+        }
+
+        if( front )
+        {
+            /* Keep what is left before the block free, in the same place in the list */
+            free_block->size = front;
+            if( rest ) { free_block->next = rest; }
+        }
+        else
+        {
+            *link = rest ? rest : free_block->next;
+        }
+
+        block = (bank_block_t *)start;
+        block->size = need;
+        block->magic = BLOCK_USED;
+        block->next = 0;
+
+        __stats_alloc( &heap->stats, need );
+        break;
+    }
+
+    if( !block ) { heap->stats.failures++; }
+
+    interrupt_restore( state );
+
+    return block ? block + 1 : 0;
+}
+
+/**
+ * @brief Return a block to a bank heap
+ *
+ * Neighboring free blocks are merged, so freeing everything restores a
+ * single free block.
+ *
+ * @param[in] heap
+ *            Heap the block was allocated from
+ * @param[in] ptr
+ *            Block to free.  Pointers not allocated from the heap are ignored.
+ */
+void bank_heap_free( bank_heap_t *heap, void *ptr )
+{
+    bank_block_t *block = (bank_block_t *)ptr - 1;
+
+    if( !ptr || (uint8_t *)block < heap->base || (uint8_t *)block >= heap->base + heap->size ) { return; }
+    if( block->magic != BLOCK_USED ) { return; }
+
+    uint32_t state = interrupt_disable_save();
+
+    bank_block_t *prev = 0;
+    bank_block_t *next = heap->free_list;
+
+    while( next && next < block )
+    {
+        prev = next;
+        next = next->next;
+    }
+
+    heap->stats.used -= block->size;
+    heap->stats.frees++;
+
+    block->magic = BLOCK_FREE;
+    block->next = next;
+
+    if( next && (uint8_t *)block + block->size == (uint8_t *)next )
+    {
+        /* Merge with the following free block */
+        block->size += next->size;
+        block->next = next->next;
+        next->magic = 0;
+    }
+
+    if( prev && (uint8_t *)prev + prev->size == (uint8_t *)block )
+    {
+        /* Merge into the preceding free block */
+        prev->size += block->size;
+        prev->next = block->next;
+        block->magic = 0;
+    }
+    else if( prev )
+    {
+        prev->next = block;
+    }
+    else
+    {
+        heap->free_list = block;
+    }
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Close a bank heap, freeing its memory if it was allocated by #bank_heap_init
+ *
+ * @param[in] heap
+ *            Heap to close
+ */
+void bank_heap_close( bank_heap_t *heap )
+{
+    if( heap->owned ) { free( heap->base ); }
+
+    memset( heap, 0, sizeof(bank_heap_t) );
+}
+
+/**
+ * @brief Read the statistics of a bank heap
+ *
+ * @param[in]  heap
+ *             Heap to query
+ * @param[out] stats
+ *             Structure to fill with statistics
+ */
+void bank_heap_get_stats( bank_heap_t *heap, alloc_stats_t *stats )
+{
+    uint32_t state = interrupt_disable_save();
+
+    *stats = heap->stats;
+    stats->free_blocks = 0;
+    stats->largest_free = 0;
+
+    for( bank_block_t *block = heap->free_list; block; block = block->next )
+    {
+        stats->free_blocks++;
+        if( block->size > stats->largest_free ) { stats->largest_free = block->size; }
+    }
+
+    interrupt_restore( state );
+
+    uint32_t free_bytes = stats->size - stats->used;
+
+    stats->fragmentation = free_bytes ? 100 - (int)((uint64_t)stats->largest_free * 100 / free_bytes) : 0;
+}
+
+/**
+ * @brief Set up the default heap for DMA buffers
+ *
+ * @param[in] size
+ *            Size in bytes to set aside from the main heap
+ *
+ * @retval 0 on success
+ * @retval -1 if the memory could not be allocated
+ */
+int dma_heap_init( uint32_t size )
+{
+    if( dma_heap.base ) { bank_heap_close( &dma_heap ); }
+
+    return bank_heap_init( &dma_heap, 0, size );
+}
+
+/**
+ * @brief Allocate a DMA buffer from the default heap
+ *
+ * @note #dma_heap_init must have been called first.
+ *
+ * @param[in] size
+ *            Size of the buffer in bytes
+ * @param[in] bank
+ *            RDRAM bank to place the buffer in, or #BANK_ANY
+ *
+ * @return Cache line aligned pointer to the buffer or null on failure
+ */
+void *dma_alloc( uint32_t size, int bank )
+{
+    return bank_heap_alloc( &dma_heap, size, bank );
+}
+
+/**
+ * @brief Free a DMA buffer allocated with #dma_alloc
+ *
+ * @param[in] ptr
+ *            Buffer to free
+ */
+void dma_free( void *ptr )
+{
+    bank_heap_free( &dma_heap, ptr );
+}
+
+/**
+ * @brief Read the statistics of the default DMA heap
+ *
+ * @param[out] stats
+ *             Structure to fill with statistics
+ */
+void dma_heap_get_stats( alloc_stats_t *stats )
+{
+    bank_heap_get_stats( &dma_heap, stats );
+}
+
+/**
+ * @brief Set aside the Expansion Pak memory as a separate heap
+ *
+ * The upper 4 MiB of RDRAM, apart from the stack at its top, is managed as
+ * a bank heap and malloc is kept out of it from then on.  This has to be
+ * called early, before malloc has grown into that memory.
+ *
+ * @retval 0 on success or if already initialized
+ * @retval -1 if there is no Expansion Pak or the heap already uses the memory
+ */
+int high_heap_init( void )
+{
+    int size = get_memory_size();
+
+    if( high_heap.base ) { return 0; }
+    if( size <= HIGH_RAM_OFFSET ) { return -1; }
+
+    /* Keep malloc below the Expansion Pak */
+    if( sys_set_heap_limit( (void *)(0x80000000 + HIGH_RAM_OFFSET) ) ) { return -1; }
+
+    return bank_heap_init( &high_heap, (void *)(0x80000000 + HIGH_RAM_OFFSET),
+                           size - HIGH_RAM_OFFSET - STACK_RESERVE );
+}
+
+/**
+ * @brief Allocate a cache line aligned block from Expansion Pak memory
+ *
+ * @note #high_heap_init must have been called first, otherwise this
+ *       always fails.
+ *
+ * @param[in] size
+ *            Size of the block in bytes
+ * @param[in] bank
+ *            RDRAM bank to place the block in, from #HIGH_RAM_BANK to
+ *            #HIGH_RAM_BANK + 3, or #BANK_ANY
+ *
+ * @return Cache line aligned pointer to the block or null on failure
+ */
+void *high_alloc( uint32_t size, int bank )
+{
+    return bank_heap_alloc( &high_heap, size, bank );
+}
+
+/**
+ * @brief Free a block allocated with #high_alloc
+ *
+ * @param[in] ptr
+ *            Block to free
+ */
+void high_free( void *ptr )
+{
+    bank_heap_free( &high_heap, ptr );
+}
+
+/**
+ * @brief Return whether memory belongs to the Expansion Pak heap
+ *
+ * @param[in] ptr
+ *            Pointer to check, cached or uncached
+ *
+ * @return Nonzero if the pointer lies in memory managed by #high_alloc
+ */
+int high_heap_contains( const void *ptr )
+{
+    uint32_t addr = (uint32_t)ptr & ~0x20000000;
+    uint32_t base = (uint32_t)high_heap.base;
+
+    return high_heap.base && addr >= base && addr < base + high_heap.size;
+}
+
+/**
+ * @brief Read the statistics of the Expansion Pak heap
+ *
+ * @param[out] stats
+ *             Structure to fill with statistics
+ */
+void high_heap_get_stats( alloc_stats_t *stats )
+{
+    bank_heap_get_stats( &high_heap, stats );
+}
+
+/** @} */
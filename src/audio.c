@@ -106,6 +106,15 @@ static volatile int now_playing = 0;
 static volatile int now_writing = 0;
 /** @brief Bitmask of buffers indicating which buffers are full */
 static volatile int buf_full = 0;
+/** @brief Event signaled whenever a buffer has been handed to the AI */
+static thread_event_t buf_free = THREAD_EVENT_INIT;
+/**
+ * @brief Nonzero while a buffer fill with the fill callback is queued or running
+ *
+ * Only one such fill may run at a time, or two could pick the same buffer
+ * and advance the ring twice.
+ */
+static volatile int fill_pending = 0;
 
 /** @brief Structure used to interact with the AI registers */
 static volatile struct AI_regs_s * const AI_regs = (struct AI_regs_s *)0xa4500000;
@@ -133,19 +142,23 @@ static volatile inline int __full()
 /**
  * @brief Send next available chunks of audio data to the AI
  *
- * This function is called whenever internal buffers are running low.  It will
- * send as many buffers as possible to the AI until the AI is full.
+ * Sends as many buffers as possible to the AI until the AI is full.  When a
+ * fill callback is set, it is called with interrupts enabled, since mixing
+ * a buffer can take a good part of a frame.  Clears #fill_pending once done.
  */
-static void audio_callback()
+static void __audio_fill()
 {
     /* Do not copy more data if we've freed the audio system */
     if(!buffers)
     {
+        fill_pending = 0;
         return;
     }
 
+    trace_begin( TRACE_ID_AUDIO );
+
     /* Disable interrupts so we don't get a race condition with writes */
-    disable_interrupts();
+    uint32_t state = interrupt_disable_save();
 
     /* Copy in as many buffers as can fit (up to 2) */
     while(!__full())
@@ -159,14 +172,19 @@ static void audio_callback()
 
         /* clear buffer full flag */
         buf_full &= ~(1<<next);
-
-        /* Set up DMA */
-        now_playing = next;
+        thread_event_signal(&buf_free);
 
         if (_fill_buffer_callback) {
-            _fill_buffer_callback(UncachedAddr( buffers[now_playing] ), _buf_size);
+            /* The AI is not reading the next buffer, so it is safe to fill
+               it while other interrupts are handled */
+            interrupt_restore(state);
+            _fill_buffer_callback(UncachedAddr( buffers[next] ), _buf_size);
+            state = interrupt_disable_save();
         }
 
+        /* Set up DMA */
+        now_playing = next;
+
         AI_regs->address = UncachedAddr( buffers[now_playing] );
         MEMORY_BARRIER();
         AI_regs->length = (_buf_size * 2 * 2 ) & ( ~7 );
@@ -177,8 +195,56 @@ static void audio_callback()
         MEMORY_BARRIER();
     }
 
+    /* Interrupts found the fill pending and left their buffers to the loop
+       above, so only let them start another once the AI is full */
+    fill_pending = 0;
+
     /* Safe to enable interrupts here */
-    enable_interrupts();
+    interrupt_restore(state);
+
+    trace_end( TRACE_ID_AUDIO );
+}
+
+/**
+ * @brief Fill buffers as deferred work
+ *
+ * @param[in] arg
+ *            Unused
+ */
+static void __audio_deferred_fill( void *arg )
+{
+    __audio_fill();
+}
+
+/**
+ * @brief Audio interrupt callback
+ *
+ * This function is called whenever internal buffers are running low.  With
+ * a fill callback set, the mixing is handed to #defer_work so it does not
+ * hold off other interrupts.  If the queue is full, it is done right away.
+ * Either way, no other fill starts until it is done.
+ */
+HOT_TEXT static void audio_callback()
+{
+    if(_fill_buffer_callback)
+    {
+        /* A pass queued or running will fill everything there is room for */
+        if(fill_pending)
+        {
+            return;
+        }
+
+        fill_pending = 1;
+
+        if(defer_work(__audio_deferred_fill, NULL) == 0)
+        {
+            return;
+        }
+
+        /* The queue is full, fill right away while still marked pending */
+    }
+
+    __audio_fill();
 }
 
 /**
@@ -336,7 +402,8 @@ void audio_pause(bool pause) {
  *
  * @note This function will block until there is room to write an audio sample.
  *       If you do not want to block, check to see if there is room by calling
- *       #audio_can_write.
+ *       #audio_can_write.  When called from a thread, other threads run
+ *       while waiting.
  *
  * @param[in] buffer
  *            Buffer containing stereo samples to be played
@@ -348,16 +415,17 @@ void audio_write(const short * const buffer)
         return;
     }
 
-    disable_interrupts();
+    uint32_t state = interrupt_disable_save();
 
     /* check for empty buffer */
     int next = (now_writing + 1) % _num_buf;
     while (buf_full & (1<<next))
     {
-        // buffers full
+        // buffers full, block until the AI frees one
         audio_callback();
-        enable_interrupts();
-        disable_interrupts();
+        interrupt_restore(state);
+        thread_event_wait(&buf_free);
+        state = interrupt_disable_save();
     }
 
     /* Copy buffer into local buffers */
@@ -365,7 +433,7 @@ void audio_write(const short * const buffer)
     now_writing = next;
     memcpy(UncachedShortAddr(buffers[now_writing]), buffer, _buf_size * 2 * sizeof(short));
     audio_callback();
-    enable_interrupts();
+    interrupt_restore(state);
 }
 
 /**
@@ -376,7 +444,8 @@ void audio_write(const short * const buffer)
  *
  * @note This function will block until there is room to write an audio sample.
  *       If you do not want to block, check to see if there is room by calling
- *       #audio_can_write.
+ *       #audio_can_write.  When called from a thread, other threads run
+ *       while waiting.
  */
 void audio_write_silence()
 {
@@ -385,16 +454,17 @@ void audio_write_silence()
         return;
     }
 
-    disable_interrupts();
+    uint32_t state = interrupt_disable_save();
 
     /* check for empty buffer */
     int next = (now_writing + 1) % _num_buf;
     while (buf_full & (1<<next))
     {
-        // buffers full
+        // buffers full, block until the AI frees one
         audio_callback();
-        enable_interrupts();
-        disable_interrupts();
+        interrupt_restore(state);
+        thread_event_wait(&buf_free);
+        state = interrupt_disable_save();
     }
 
     /* Copy silence into local buffers */
@@ -402,7 +472,7 @@ void audio_write_silence()
     now_writing = next;
     memset(UncachedShortAddr(buffers[now_writing]), 0, _buf_size * 2 * sizeof(short));
     audio_callback();
-    enable_interrupts();
+    interrupt_restore(state);
 }
 
 /**
@@ -105,6 +105,9 @@ static void __controller_exec_PIF( void *inblock, void *outblock )
     data_cache_hit_writeback_invalidate(inblock_temp, 64);
     memcpy(UncachedAddr(inblock_temp), inblock, 64);
 
+    /* Let other threads run if a previous transfer is still going */
+    while (SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY)) { thread_yield(); }
+
     /* Be sure another thread doesn't get into a resource fight */
     disable_interrupts();
 
@@ -0,0 +1,411 @@
+/**
+ * @file crash.c
+ * @brief Crash Reporter
+ * @ingroup crash
+ */
+#include <stdio.h>
+#include <string.h>
+#include "libdragon.h"
+
+/**
+ * @defgroup crash Crash Reporter
+ * @ingroup lowlevel
+ * @brief Backtraces and register dumps for crashes in the field.
+ *
+ * The crash reporter is an exception handler that turns a critical
+ * exception into a compact, fixed size report.  Call #crash_init once at
+ * startup with the places reports should go: printed to the console, sent
+ * to the host over 64drive USB, or saved to EEPROM so that a build on a
+ * retail cartridge can send it back after the next boot with
+ * #crash_load_eeprom.  After reporting, the handler stops the program, since
+ * returning would only run the faulting instruction again.
+ *
+ * A report holds the exception registers, the general purpose registers,
+ * a backtrace, the code around the faulting instruction and the top of the
+ * stack.  The n64crash tool reads a report together with the ELF file of the
+ * program and prints it with function names, and can also look up the
+ * addresses printed on the console.
+ *
+ * Code is built without frame pointers, so the backtrace is found the way a
+ * debugger without debug info would: starting at the faulting instruction,
+ * look backwards for the instruction that allocates the function's stack
+ * frame and the one that saves the return address into it, then continue
+ * from the return address in the caller's frame.  This works for code
+ * compiled by GCC, but stops early at hand written assembly, at functions
+ * with very large frames and at corrupted stacks.  Every memory access is
+ * checked against RDRAM first, so unwinding a bad stack cannot fault again.
+ *
+ * Register values are stored as their low 32 bits, as are all addresses.
+ * #crash_capture and #crash_unwind can be used from a custom exception
+ * handler to build reports without installing this one.
+ * @{
+ */
+
+/** @brief Instructions looked at for a function prologue */
+#define MAX_SCAN        1024
+
+/** @brief addiu sp,sp,imm and daddiu sp,sp,imm */
+#define INSN_ADDIU_SP   0x27BD0000
+/** @copydoc INSN_ADDIU_SP */
+#define INSN_DADDIU_SP  0x67BD0000
+/** @brief sw ra,imm(sp) */
+#define INSN_SW_RA      0xAFBF0000
+/** @brief sd ra,imm(sp) */
+#define INSN_SD_RA      0xFFBF0000
+/** @brief Mask of the opcode and registers, leaving the immediate */
+#define INSN_MASK       0xFFFF0000
+
+/** @brief Where reports go when the handler runs */
+static int crash_outputs = 0;
+/** @brief First EEPROM block of the saved report */
+static int crash_block = 0;
+/** @brief Report filled in by the handler, aligned for USB DMA */
+static crash_report_t crash_report __attribute__((aligned(8)));
+
+/**
+ * @brief Names of the exception codes found in the cause register
+ */
+static const char * const exception_names[32] =
+{
+    "Interrupt", "TLB modification", "TLB miss on load", "TLB miss on store",
+    "Address error on load", "Address error on store", "Bus error on fetch", "Bus error on data",
+    "Syscall", "Breakpoint", "Reserved instruction", "Coprocessor unusable",
+    "Arithmetic overflow", "Trap", NULL, "Floating point",
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, "Watch",
+};
+
+/**
+ * @brief Names of the general purpose registers
+ */
+static const char * const register_names[32] =
+{
+    "zr", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra",
+};
+
+/**
+ * @brief Return whether an address is a word of RDRAM that can be read
+ *
+ * @param[in] addr
+ *            Cached or uncached address
+ *
+ * @return Nonzero if reading the address cannot fault
+ */
+static int __valid_address( uint32_t addr )
+{
+    /* Fold the uncached segment onto the cached one */
+    uint32_t phys = addr & 0xDFFFFFFF;
+
+    return !(addr & 3) && phys >= 0x80000000 && phys < 0x80000000 + (uint32_t)get_memory_size();
+}
+
+/**
+ * @brief Read a word of RDRAM, or zero if the address is not valid
+ *
+ * @param[in] addr
+ *            Address to read
+ *
+ * @return The word at the address
+ */
+static uint32_t __read_word( uint32_t addr )
+{
+    return __valid_address( addr ) ? *(volatile uint32_t *)addr : 0;
+}
+
+/**
+ * @brief Walk the stack from a point in the program
+ *
+ * @param[in]  pc
+ *             Address of the instruction being run
+ * @param[in]  sp
+ *             Stack pointer at that instruction
+ * @param[in]  ra
+ *             Return address register at that instruction, used when the
+ *             innermost function has not saved it on the stack
+ * @param[out] frames
+ *             Filled with pc, then the address of each call leading to it
+ * @param[in]  max
+ *             Most entries to write to frames
+ *
+ * @return The number of entries written to frames
+ */
+int crash_unwind( uint32_t pc, uint32_t sp, uint32_t ra, uint32_t *frames, int max )
+{
+    int count = 0;
+
+    while( count < max && __valid_address( pc ) && __valid_address( sp ) )
+    {
+        int frame_size = 0;
+        int ra_offset = -1;
+
+        frames[count++] = pc;
+
+        /* Find the start of the function, remembering where it saved ra.
+           Scanning backwards, the last save seen is the prologue's. */
+        for( uint32_t addr = pc; addr > pc - MAX_SCAN * 4 && __valid_address( addr ); addr -= 4 )
+        {
+            uint32_t insn = *(volatile uint32_t *)addr;
+            int16_t imm = insn & 0xFFFF;
+
+            /* Saves after pc have not happened yet */
+            if( addr != pc && ((insn & INSN_MASK) == INSN_SW_RA || (insn & INSN_MASK) == INSN_SD_RA) )
+            {
+                /* The low word of a doubleword is the second one */
+                ra_offset = imm + ((insn & INSN_MASK) == INSN_SD_RA ? 4 : 0);
+            }
+
+            /* Freeing the frame before an early return does not count */
+            if( ((insn & INSN_MASK) == INSN_ADDIU_SP || (insn & INSN_MASK) == INSN_DADDIU_SP) && imm < 0 )
+            {
+                /* Faulting at the allocation itself means it did not run */
+                if( addr != pc || count > 1 ) { frame_size = -imm; }
+                break;
+            }
+        }
+
+        uint32_t next_ra;
+
+        if( ra_offset >= 0 && frame_size )
+        {
+            next_ra = __read_word( sp + ra_offset );
+        }
+        else if( count == 1 )
+        {
+            /* Only the innermost function can still have it in ra */
+            next_ra = ra;
+        }
+        else
+        {
+            break;
+        }
+
+        sp += frame_size;
+
+        /* Continue from the jump and link, two instructions before the
+           return address */
+        if( !next_ra ) { break; }
+        pc = next_ra - 8;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Fill in a report from the registers saved by an exception
+ *
+ * @param[in]  regs
+ *             Registers saved at the exception
+ * @param[out] report
+ *             Report to fill in
+ */
+void crash_capture( const reg_block_t *regs, crash_report_t *report )
+{
+    uint32_t cause, badvaddr;
+
+    asm volatile("mfc0 %0,$13" : "=r"(cause));
+    asm volatile("mfc0 %0,$8" : "=r"(badvaddr));
+
+    memset( report, 0, sizeof(crash_report_t) );
+
+    report->magic = CRASH_MAGIC;
+    report->version = CRASH_VERSION;
+    report->cause = cause;
+    report->epc = regs->epc;
+    report->badvaddr = badvaddr;
+    report->sr = regs->sr;
+    report->hi = regs->hi;
+    report->lo = regs->lo;
+
+    for( int i = 0; i < 32; i++ )
+    {
+        report->gpr[i] = regs->gpr[i];
+    }
+
+    uint32_t sp = report->gpr[29];
+
+    report->num_frames = crash_unwind( report->epc, sp, report->gpr[31], report->frames, CRASH_MAX_FRAMES );
+
+    for( int i = 0; i < CRASH_CODE_WORDS; i++ )
+    {
+        report->code[i] = __read_word( report->epc + (i - CRASH_CODE_WORDS / 2) * 4 );
+    }
+
+    for( int i = 0; i < CRASH_STACK_WORDS; i++ )
+    {
+        report->stack[i] = __read_word( sp + i * 4 );
+    }
+}
+
+/**
+ * @brief Print a report through stdio
+ *
+ * Addresses are printed raw, for looking up with n64crash -a or addr2line.
+ *
+ * @param[in] report
+ *            Report to print
+ */
+void crash_print( const crash_report_t *report )
+{
+    int code = (report->cause >> 2) & 0x1F;
+    const char *name = exception_names[code] ? exception_names[code] : "Unknown";
+
+    printf( "CRASH: %s (%d)\n", name, code );
+    printf( "epc %08lx cause %08lx\n", (unsigned long)report->epc, (unsigned long)report->cause );
+    printf( "bad %08lx sr %08lx\n", (unsigned long)report->badvaddr, (unsigned long)report->sr );
+
+    for( int i = 0; i < 32; i += 2 )
+    {
+        printf( "%s %08lx %s %08lx\n", register_names[i], (unsigned long)report->gpr[i],
+                register_names[i + 1], (unsigned long)report->gpr[i + 1] );
+    }
+
+    printf( "backtrace:\n" );
+
+    for( int i = 0; i < report->num_frames; i++ )
+    {
+        printf( "%s%08lx", (i % 4) ? " " : "", (unsigned long)report->frames[i] );
+        if( i % 4 == 3 || i == report->num_frames - 1 ) { printf( "\n" ); }
+    }
+}
+
+/**
+ * @brief Send a report to the host over 64drive USB
+ *
+ * @param[in] report
+ *            Report to send
+ *
+ * @retval 0 if the report was sent
+ * @retval -1 if the USB interface stayed busy for a second
+ */
+int crash_send_usb( const crash_report_t *report )
+{
+    static crash_report_t buf __attribute__((aligned(8)));
+    unsigned long start = get_ticks_ms();
+
+    if( report != &buf ) { memcpy( &buf, report, sizeof(crash_report_t) ); }
+
+    _64Drive_rom_writable( 1 );
+
+    /* Nonzero once the transfer could be started */
+    while( !_64Drive_usb_write_data( &buf, sizeof(crash_report_t), USB_DATATYPE_BINARY ) )
+    {
+        if( get_ticks_ms() - start > 1000 ) { return -1; }
+    }
+
+    _64Drive_usb_spin_write();
+
+    return 0;
+}
+
+/**
+ * @brief Save a report to EEPROM
+ *
+ * The report takes #CRASH_EEPROM_BLOCKS blocks, which is all of a 4 kbit
+ * EEPROM, so choose blocks the game does not use or keep its saves
+ * elsewhere.
+ *
+ * @param[in] report
+ *            Report to save
+ * @param[in] block
+ *            First EEPROM block to write
+ */
+void crash_save_eeprom( const crash_report_t *report, int block )
+{
+    const uint8_t *data = (const uint8_t *)report;
+
+    for( int i = 0; i < CRASH_EEPROM_BLOCKS; i++ )
+    {
+        eeprom_write( block + i, data + i * 8 );
+
+        /* Give the EEPROM time to finish writing the block */
+        wait_ms( 15 );
+    }
+}
+
+/**
+ * @brief Load a report saved to EEPROM
+ *
+ * @param[out] report
+ *             Report to fill in
+ * @param[in]  block
+ *             First EEPROM block of the report
+ *
+ * @retval 0 if a report was found
+ * @retval -1 if there is no EEPROM or no report in it
+ */
+int crash_load_eeprom( crash_report_t *report, int block )
+{
+    uint8_t *data = (uint8_t *)report;
+
+    if( !eeprom_present() ) { return -1; }
+
+    for( int i = 0; i < CRASH_EEPROM_BLOCKS; i++ )
+    {
+        eeprom_read( block + i, data + i * 8 );
+    }
+
+    if( report->magic != CRASH_MAGIC || report->version != CRASH_VERSION ||
+        report->num_frames > CRASH_MAX_FRAMES )
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Exception handler installed by #crash_init
+ *
+ * @param[in] ex
+ *            Exception being handled
+ */
+static void __crash_handler( exception_t *ex )
+{
+    if( ex->type != EXCEPTION_TYPE_CRITICAL ) { return; }
+
+    crash_capture( ex->regs, &crash_report );
+
+    /* The console goes last, since drawing depends on the most state */
+    if( crash_outputs & CRASH_OUTPUT_USB ) { crash_send_usb( &crash_report ); }
+    if( crash_outputs & CRASH_OUTPUT_EEPROM ) { crash_save_eeprom( &crash_report, crash_block ); }
+
+    if( crash_outputs & CRASH_OUTPUT_CONSOLE )
+    {
+        console_set_render_mode( RENDER_MANUAL );
+        crash_print( &crash_report );
+        console_render();
+    }
+
+    /* Returning would run the faulting instruction again */
+    while( 1 ) { }
+}
+
+/**
+ * @brief Install the crash reporter as the exception handler
+ *
+ * @param[in] outputs
+ *            Where to write reports, a combination of #CRASH_OUTPUT_CONSOLE,
+ *            #CRASH_OUTPUT_USB and #CRASH_OUTPUT_EEPROM
+ * @param[in] eeprom_block
+ *            First EEPROM block to save reports to, if saving to EEPROM
+ */
+void crash_init( int outputs, int eeprom_block )
+{
+    crash_outputs = outputs;
+    crash_block = eeprom_block;
+
+    register_exception_handler( __crash_handler );
+}
+
+/**
+ * @brief Remove the crash reporter
+ */
+void crash_close( void )
+{
+    register_exception_handler( NULL );
+    crash_outputs = 0;
+}
+
+/** @} */
@@ -0,0 +1,173 @@
+/**
+ * @file defer.c
+ * @brief Deferred Work
+ * @ingroup defer
+ */
+#include "libdragon.h"
+
+/**
+ * @defgroup defer Deferred Work
+ * @ingroup lowlevel
+ * @brief Running the slow part of interrupt handling with interrupts enabled.
+ *
+ * Interrupt callbacks run with interrupts disabled, so every cycle spent in
+ * one delays all other interrupts.  Callbacks can instead do only what has
+ * to happen right away, such as acknowledging hardware and taking note of
+ * what happened, and hand the rest to #defer_work.  Deferred work runs when
+ * the outermost interrupt is about to return, with interrupts enabled, so
+ * other interrupts can be handled in the meantime.  It can also be run from
+ * the main loop with #defer_poll, which is useful when interrupts are not
+ * expected for a while.
+ *
+ * Work items are run one at a time, in the order they were queued.  Queuing
+ * never blocks and may be done from interrupt callbacks, from deferred work
+ * itself and from any thread.  A writer reserves a slot by atomically
+ * moving the head of the queue and then publishes the function, so the
+ * runner stops at a slot that is still being filled in and picks it up the
+ * next time.
+ *
+ * Deferred work runs in interrupt context, so it must not block.
+ * @{
+ */
+
+/**
+ * @brief A queued work item
+ */
+typedef struct
+{
+    /** @brief Function to run, null until the item is published */
+    volatile defer_func_t func;
+    /** @brief Argument for the function */
+    void *arg;
+} defer_item_t;
+
+/** @brief Queue of work items */
+static defer_item_t queue[DEFER_QUEUE_SIZE];
+/** @brief Number of items reserved since startup */
+static volatile int head = 0;
+/** @brief Number of items run since startup */
+static volatile int tail = 0;
+/** @brief Nonzero while work is being run */
+static volatile int running = 0;
+/** @brief Statistics */
+static defer_stats_t stats;
+
+/* From the scheduler, if it is linked in */
+extern void __thread_preempt_disable( void ) __attribute__((weak));
+extern void __thread_preempt_enable( void ) __attribute__((weak));
+
+/**
+ * @brief Queue a function to run once interrupts are enabled
+ *
+ * @param[in] func
+ *            Function to run
+ * @param[in] arg
+ *            Argument passed to the function
+ *
+ * @retval 0 if the work was queued
+ * @retval -1 if the queue is full, in which case the caller should do the
+ *         work itself
+ */
+int defer_work( defer_func_t func, void *arg )
+{
+    uint32_t pos;
+
+    if( !func ) { return -1; }
+
+    do
+    {
+        pos = head;
+
+        if( pos - (uint32_t)tail >= DEFER_QUEUE_SIZE )
+        {
+            stats.dropped++;
+            return -1;
+        }
+    } while( !atomic_compare_exchange( &head, pos, pos + 1 ) );
+
+    defer_item_t *item = &queue[pos & (DEFER_QUEUE_SIZE - 1)];
+
+    item->arg = arg;
+
+    /* The argument must be in place before the item is published */
+    MEMORY_BARRIER();
+    item->func = func;
+
+    stats.queued++;
+    if( pos + 1 - (uint32_t)tail > stats.high_water ) { stats.high_water = pos + 1 - (uint32_t)tail; }
+
+    return 0;
+}
+
+/**
+ * @brief Return whether any work is waiting to run
+ */
+int defer_pending( void )
+{
+    return head != tail;
+}
+
+/**
+ * @brief Run waiting work items
+ *
+ * Runs items until the queue is empty, including items queued while
+ * running.  Called by the interrupt handler on its way out and may also be
+ * called from the main loop.  If work is already being run further up the
+ * stack, this returns right away and the outer call picks up any new items.
+ *
+ * A thread running the work is not preempted until it is done.  Otherwise
+ * the interrupts returning in the meantime would find the queue busy and
+ * leave their work waiting for the thread to be scheduled again.
+ */
+void defer_poll( void )
+{
+    int thread = !in_interrupt() && __thread_preempt_disable;
+
+    if( thread ) { __thread_preempt_disable(); }
+
+    while( !atomic_exchange( &running, 1 ) )
+    {
+        int stalled = 0;
+
+        while( tail != head )
+        {
+            defer_item_t *item = &queue[tail & (DEFER_QUEUE_SIZE - 1)];
+            defer_func_t func = item->func;
+            void *arg = item->arg;
+
+            /* Stop at an item that is still being queued */
+            if( !func ) { stalled = 1; break; }
+
+            /* Free the slot before running, the function may queue more work */
+            item->func = 0;
+            MEMORY_BARRIER();
+            tail++;
+            stats.run++;
+
+            func( arg );
+        }
+
+        running = 0;
+
+        /* An interrupt may have queued work after the last check and
+           returned without running it, as the queue was still busy */
+        if( stalled || tail == head ) { break; }
+    }
+
+    if( thread ) { __thread_preempt_enable(); }
+}
+
+/**
+ * @brief Read the deferred work statistics
+ *
+ * @param[out] out
+ *             Structure to copy the statistics into
+ */
+void defer_get_stats( defer_stats_t *out )
+{
+    uint32_t state = interrupt_disable_save();
+    *out = stats;
+    interrupt_restore( state );
+}
+
+/** @} */
@@ -203,6 +203,8 @@ static void __write_dram_register( void const * const dram_val )
  */
 static void __display_callback()
 {
+    trace_instant( TRACE_ID_VBLANK, now_showing );
+
     /* Only swap frames if we have a new frame to swap, otherwise just
        leave up the current frame */
     if(show_next >= 0 && show_next != now_drawing)
@@ -352,7 +354,9 @@ void display_init( resolution_t res, bitdepth_t bit, uint32_t num_buffers, gamma
     {
         /* Set parameters necessary for drawing */
         /* Grab a location to render to */
-        buffer[i] = malloc( __width * __height * __bitdepth + 15 );
+        /* Keep framebuffers in the Expansion Pak heap when it is set up */
+        buffer[i] = high_alloc( __width * __height * __bitdepth, BANK_ANY );
+        if( !buffer[i] ) { buffer[i] = malloc( __width * __height * __bitdepth + 15 ); }
         __safe_buffer[i] = ALIGN_16BYTE( UNCACHED_ADDR( buffer[i] ) );
 
         /* Baseline is blank */
@@ -398,7 +402,11 @@ void display_close()
     for( int i = 0; i < __buffers; i++ )
     {
         /* Free framebuffer memory */
-        if( buffer[i] )
+        if( high_heap_contains( buffer[i] ) )
+        {
+            high_free( buffer[i] );
+        }
+        else if( buffer[i] )
         {
             free( buffer[i]);
         }
@@ -458,6 +466,8 @@ void display_show( display_context_t disp )
     /* They tried drawing on a bad context */
     if( disp == 0 ) { return; }
 
+    trace_instant( TRACE_ID_DISPLAY_SHOW, disp );
+
     /* Can't have the video interrupt screwing this up */
     disable_interrupts();
 
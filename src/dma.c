@@ -24,6 +24,9 @@
  * manipulating registers on a cartridge such as a gameshark.  Code should never
  * make raw 32-bit reads or writes in the cartridge domain as it could collide with
  * an in-progress DMA transfer or run into caching issues.
+ *
+ * When called from a thread, #dma_read and #dma_write let other threads run
+ * while waiting for the transfer to complete instead of spinning.
  * @{
  */
 
@@ -52,6 +55,30 @@ volatile int dma_busy()
     return PI_regs->status & (PI_STATUS_DMA_BUSY | PI_STATUS_IO_BUSY);
 }
 
+/**
+ * @brief Wait until the DMA controller is idle
+ *
+ * If the caller is allowed to block, other threads run while waiting.
+ */
+static void __dma_wait(void)
+{
+    while (dma_busy()) { thread_yield(); }
+}
+
+/**
+ * @brief Turn a peripheral address into a PI bus address
+ *
+ * Addresses below the cartridge domain 2 space are offsets into the
+ * cartridge ROM.  Domain 2 addresses, where SRAM and FlashRAM live, are
+ * used as they are.
+ */
+static inline unsigned long __pi_bus_address(unsigned long pi_address)
+{
+    pi_address &= 0x1FFFFFFF;
+
+    return pi_address >= 0x05000000 ? pi_address : (pi_address | 0x10000000);
+}
+
 /**
  * @brief Read from a peripheral
  *
@@ -64,21 +91,29 @@ volatile int dma_busy()
  * @param[in]  len
  *             Length in bytes to read into ram_address
  */
-void dma_read(void * ram_address, unsigned long pi_address, unsigned long len) 
+HOT_TEXT void dma_read(void * ram_address, unsigned long pi_address, unsigned long len) 
 {
+    trace_begin( TRACE_ID_DMA_READ );
+
+    __dma_wait();
+
     disable_interrupts();
 
+    /* An interrupt handler may have started a transfer in the meantime */
     while (dma_busy()) ;
     MEMORY_BARRIER();
     PI_regs->ram_address = ram_address;
     MEMORY_BARRIER();
-    PI_regs->pi_address = (pi_address | 0x10000000) & 0x1FFFFFFF;
+    PI_regs->pi_address = __pi_bus_address(pi_address);
     MEMORY_BARRIER();
     PI_regs->write_length = len-1;
     MEMORY_BARRIER();
-    while (dma_busy()) ;
 
     enable_interrupts();
+
+    __dma_wait();
+
+    trace_end( TRACE_ID_DMA_READ );
 }
 
 /**
@@ -95,19 +130,68 @@ void dma_read(void * ram_address, unsigned long pi_address, unsigned long len)
  */
 void dma_write(void * ram_address, unsigned long pi_address, unsigned long len) 
 {
+    trace_begin( TRACE_ID_DMA_WRITE );
+
+    __dma_wait();
+
     disable_interrupts();
 
+    /* An interrupt handler may have started a transfer in the meantime */
     while (dma_busy()) ;
     MEMORY_BARRIER();
     PI_regs->ram_address = ram_address;
     MEMORY_BARRIER();
-    PI_regs->pi_address = (pi_address | 0x10000000) & 0x1FFFFFFF;
+    PI_regs->pi_address = __pi_bus_address(pi_address);
     MEMORY_BARRIER();
     PI_regs->read_length = len-1;
     MEMORY_BARRIER();
-    while (dma_busy()) ;
 
     enable_interrupts();
+
+    __dma_wait();
+
+    trace_end( TRACE_ID_DMA_WRITE );
+}
+
+/**
+ * @brief Start writing to a peripheral without waiting
+ *
+ * Unlike #dma_write, this never waits for the PI, so it may be called from
+ * interrupt handlers.  The PI interrupt is raised when the transfer is done,
+ * and the buffer must not be changed until then.  The buffer must already
+ * be written back from the data cache.
+ *
+ * @param[in] ram_address
+ *            Pointer to a buffer to read data from
+ * @param[in] pi_address
+ *            Memory address of the peripheral to write to
+ * @param[in] len
+ *            Length in bytes to write to peripheral
+ *
+ * @return Nonzero if the transfer was started or 0 if the PI was busy
+ */
+int dma_write_start(void * ram_address, unsigned long pi_address, unsigned long len)
+{
+    int started = 0;
+
+    uint32_t state = interrupt_disable_save();
+
+    if (!dma_busy())
+    {
+        MEMORY_BARRIER();
+        PI_regs->ram_address = ram_address;
+        MEMORY_BARRIER();
+        PI_regs->pi_address = __pi_bus_address(pi_address);
+        MEMORY_BARRIER();
+        PI_regs->read_length = len-1;
+        MEMORY_BARRIER();
+
+        started = 1;
+    }
+
+    interrupt_restore(state);
+
+    return started;
 }
 
 /**
@@ -123,7 +207,7 @@ uint32_t io_read(uint32_t pi_address)
     volatile uint32_t *uncached_address = (uint32_t *)(pi_address | 0xa0000000);
     uint32_t retval = 0;
 
-    disable_interrupts();
+    uint32_t state = interrupt_disable_save();
 
     /* Wait until there isn't a DMA transfer and grab a word */
     while (dma_busy()) ;
@@ -131,7 +215,7 @@ uint32_t io_read(uint32_t pi_address)
     retval = *uncached_address;
     MEMORY_BARRIER();
 
-    enable_interrupts();
+    interrupt_restore(state);
 
     return retval;
 }
@@ -148,14 +232,14 @@ void io_write(uint32_t pi_address, uint32_t data)
 {
     volatile uint32_t *uncached_address = (uint32_t *)(pi_address | 0xa0000000);
 
-    disable_interrupts();
+    uint32_t state = interrupt_disable_save();
 
     while (dma_busy()) ;
     MEMORY_BARRIER();
     *uncached_address = data;
     MEMORY_BARRIER();
 
-    enable_interrupts();
+    interrupt_restore(state);
 }
 
 /** @} */ /* dma */
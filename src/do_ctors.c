@@ -3,7 +3,10 @@
  * @brief C++ constructor handling
  * @ingroup system
  */
+#include <stdio.h>
 #include <stdint.h>
+#include "ctors.h"
+#include "n64sys.h"
 
 /**
  * @addtogroup system
@@ -20,14 +23,95 @@ extern func_ptr __CTOR_LIST__[];
 /** @brief Pointer to the end of the constructor list */
 extern func_ptr __CTOR_END__[];
 
+/** @brief Timing of the constructors, filled in by #__do_global_ctors */
+static ctors_stats_t stats;
+
+/**
+ * @brief Read the CP0 Count register
+ *
+ * Inline rather than #get_ticks, so timing a constructor costs only a few
+ * instructions.
+ */
+static inline uint32_t __read_count( void )
+{
+	uint32_t count;
+	asm volatile("mfc0 %0,$9\n\tnop" : "=r"(count));
+	return count;
+}
+
+/**
+ * @brief Keep a constructor if it is among the slowest so far
+ */
+static void __record_ctor( func_ptr func, uint32_t ticks )
+{
+	int i = CTORS_SLOWEST;
+
+	/* Shift faster entries down to make room, the list stays sorted */
+	while (i > 0 && (!stats.slowest[i - 1].func || stats.slowest[i - 1].ticks < ticks))
+	{
+		if (i < CTORS_SLOWEST)
+			stats.slowest[i] = stats.slowest[i - 1];
+		i--;
+	}
+
+	if (i < CTORS_SLOWEST)
+	{
+		stats.slowest[i].func = func;
+		stats.slowest[i].ticks = ticks;
+	}
+}
+
 /** 
  * @brief Execute global constructors
+ *
+ * Each constructor is timed with the CP0 Count register, see
+ * #ctors_print_report.  Objects whose constructor is slow and not needed
+ * before the first frame can be wrapped in dragon::lazy from lazy.hpp, which
+ * constructs them on first use instead.
  */
 void __do_global_ctors() 
 {
 	unsigned int tot_constructors = __CTOR_LIST_SIZE__;
+	uint32_t begin = __read_count();
+
 	for (void (**f)(void) = (void (**)(void))(__CTOR_LIST__); tot_constructors > 0; tot_constructors--, f++)
+	{
+		uint32_t start = __read_count();
 		(**f)();
+		__record_ctor(*f, __read_count() - start);
+		stats.count++;
+	}
+
+	stats.total_ticks = __read_count() - begin;
+}
+
+/**
+ * @brief Get the timing of the global constructors
+ *
+ * @param[out] out
+ *             Structure to copy the timing into
+ */
+void ctors_get_stats( ctors_stats_t *out )
+{
+	*out = stats;
+}
+
+/**
+ * @brief Print the slowest global constructors
+ *
+ * Prints with printf, so set up the console or a debug output first.  Turn
+ * the addresses into names with n64crash -a.
+ */
+void ctors_print_report( void )
+{
+	printf("%lu constructors took %lu us\n", (unsigned long)stats.count,
+	       (unsigned long)((uint64_t)stats.total_ticks * 1000000 / COUNTS_PER_SECOND));
+
+	for (int i = 0; i < CTORS_SLOWEST && stats.slowest[i].func; i++)
+	{
+		printf("  %08lx %8lu us\n", (unsigned long)(uint32_t)stats.slowest[i].func,
+		       (unsigned long)((uint64_t)stats.slowest[i].ticks * 1000000 / COUNTS_PER_SECOND));
+	}
 }
 
 /** @} */
@@ -40,9 +40,28 @@
  * Files can be accessed either with standard POSIX functions and the 'rom:/' prefix or
  * with DFS API calls and no prefix.  Files can be opened using both sets of API calls
  * simultaneously as long as no more than four files are open at any one time.
+ *
+ * Reads covering whole sectors are transferred by DMA straight into the destination
+ * buffer when it is at least 4 byte aligned, so large reads avoid a copy through the
+ * sector cache.  Through newlib, fstat reports a block size of #DFS_BLOCK_SIZE bytes,
+ * which stdio uses as its buffer size, so buffered reads also arrive in large chunks.
+ * For large reads with fread, either use an unbuffered stream (see setvbuf) so that
+ * reads go straight to the user's buffer, or call read directly.
+ *
+ * To index many assets at once, #dfs_dir_read lists a directory, optionally
+ * with all of its subdirectories, along with file sizes, in a single pass
+ * and without opening each file.
  * @{
  */
 
+/**
+ * @brief Preferred block size reported through fstat
+ *
+ * A whole number of sector payloads, so that sequential buffered reads stay
+ * aligned to sectors and can be transferred without going through the cache.
+ */
+#define DFS_BLOCK_SIZE  (SECTOR_PAYLOAD * 16)
+
 /**
  * @brief Directory walking flags 
  */
@@ -69,8 +88,8 @@ enum
 
 /** @brief Base filesystem pointer */
 static uint32_t base_ptr = 0;
-/** @brief Open file tracking */
-static open_file_t open_files[MAX_OPEN_FILES];
+/** @brief Open file tracking, line aligned as sectors are DMA'd into it */
+static open_file_t open_files[MAX_OPEN_FILES] __attribute__((aligned(16)));
 /** @brief Directory pointer stack */
 static uint32_t directories[MAX_DIRECTORY_DEPTH];
 /** @brief Depth into directory pointer stack */
@@ -298,11 +317,86 @@ static void walk_sectors(open_file_t *file, uint32_t num_sectors)
     {
         file_entry_t *next_sector = get_next_sector(&file->cur_sector);
         grab_sector(next_sector, &file->cur_sector);
+        file->sector_loc = next_sector;
+        file->sector_stale = 0;
 
         num_sectors--;
     }
 }
 
+/**
+ * @brief Read the payload of a sector straight into a buffer
+ *
+ * The PI can only DMA to 8 byte aligned addresses.  If the buffer is only 4
+ * byte aligned, the whole sector is transferred to the word before it instead,
+ * and that word is put back afterwards, so it must belong to the caller.
+ *
+ * The cache lines the transfer touches are invalidated afterwards, so they
+ * must lie entirely within the caller's buffer, see #dma_span_inside.
+ *
+ * @param[in]  cart_loc
+ *             Pointer to cartridge location of the sector
+ * @param[out] buf
+ *             Buffer to place the sector payload in.  Must be 4 byte aligned.
+ *
+ * @return The link to the next sector, as stored in #file_entry::next_sector
+ */
+static uint32_t read_sector_direct(file_entry_t *cart_loc, uint8_t *buf)
+{
+    uint32_t next;
+
+    if(((uint32_t)buf & 7) == 0)
+    {
+        next = io_read((uint32_t)cart_loc);
+
+        data_cache_hit_writeback_invalidate(buf, SECTOR_PAYLOAD);
+        dma_read((void *)(((uint32_t)buf) & 0x1FFFFFFF), (uint32_t)cart_loc + sizeof(uint32_t), SECTOR_PAYLOAD);
+        data_cache_hit_invalidate(buf, SECTOR_PAYLOAD);
+    }
+    else
+    {
+        uint8_t *start = buf - sizeof(uint32_t);
+        uint32_t saved;
+
+        memcpy(&saved, start, sizeof(saved));
+
+        data_cache_hit_writeback_invalidate(start, SECTOR_SIZE);
+        dma_read((void *)(((uint32_t)start) & 0x1FFFFFFF), (uint32_t)cart_loc, SECTOR_SIZE);
+        data_cache_hit_invalidate(start, SECTOR_SIZE);
+
+        /* The link landed in the word before the payload */
+        memcpy(&next, start, sizeof(next));
+        memcpy(start, &saved, sizeof(saved));
+    }
+
+    return next;
+}
+
+/**
+ * @brief Check that a DMA only touches cache lines inside a buffer
+ *
+ * The data cache is invalidated after a DMA in whole 16 byte lines.  Since
+ * #dma_read lets other threads and interrupts run during the transfer,
+ * anything they write next to the transfer in a line it shares would be
+ * thrown away, so only the caller's own buffer may share those lines.
+ *
+ * @param[in] start
+ *            Start of the DMA in RAM
+ * @param[in] len
+ *            Length of the DMA in bytes
+ * @param[in] buf
+ *            Start of the caller's buffer
+ * @param[in] end
+ *            End of the caller's buffer
+ *
+ * @return Nonzero if the cache lines of the DMA are all inside the buffer
+ */
+static inline int dma_span_inside(const uint8_t *start, int len, const uint8_t *buf, const uint8_t *end)
+{
+    return ((uint32_t)start & ~15) >= (uint32_t)buf &&
+           (((uint32_t)start + len + 15) & ~15) <= (uint32_t)end;
+}
+
 /**
  * @brief Reset the directory stack to the root
  */
@@ -778,6 +872,94 @@ int dfs_dir_findnext(char *buf)
     return get_flags(&t_node);
 }
 
+/**
+ * @brief Read the entries of a directory in a single pass
+ *
+ * Each directory entry already holds the size of its file, so this fills
+ * in names, types and sizes reading every directory sector once, without
+ * opening any files.  With #DFS_DIR_RECURSIVE, subdirectories are listed
+ * right after their own entry, and #dfs_dirent_t::parent links each entry
+ * to its directory so full paths can be rebuilt.
+ *
+ * @param[in]  path
+ *             The directory to read
+ * @param[out] entries
+ *             Array to fill with entries
+ * @param[in]  max_entries
+ *             Number of entries the array can hold
+ * @param[in]  flags
+ *             Zero or #DFS_DIR_RECURSIVE
+ *
+ * @return The number of entries read or a negative value on error.  If this
+ *         equals max_entries, there may be more entries that didn't fit.
+ */
+int dfs_dir_read(const char * const path, dfs_dirent_t *entries, int max_entries, int flags)
+{
+    directory_entry_t *dirent;
+    directory_entry_t *resume[MAX_DIRECTORY_DEPTH];
+    int resume_parent[MAX_DIRECTORY_DEPTH];
+    int depth = 0;
+    int parent = -1;
+    int count = 0;
+
+    if(!path || !entries || max_entries < 0)
+    {
+        /* Bad input! */
+        return DFS_EBADINPUT;
+    }
+
+    int ret = recurse_path(path, WALK_OPEN, &dirent, TYPE_DIR);
+
+    if(ret != DFS_ESUCCESS)
+    {
+        /* Directory not found, or other error */
+        return ret;
+    }
+
+    while(count < max_entries)
+    {
+        if(!dirent)
+        {
+            /* End of this directory, carry on in the one above */
+            if(depth == 0) { break; }
+
+            depth--;
+            dirent = resume[depth];
+            parent = resume_parent[depth];
+            continue;
+        }
+
+        directory_entry_t node;
+        grab_sector(dirent, &node);
+
+        uint32_t type = FILETYPE(get_flags(&node));
+        dfs_dirent_t *entry = &entries[count];
+
+        strcpy(entry->name, node.path);
+        entry->type = type;
+        entry->size = (type == FLAGS_FILE) ? get_size(&node) : 0;
+        entry->offset = node.file_pointer;
+        entry->depth = depth;
+        entry->parent = parent;
+        count++;
+
+        dirent = get_next_entry(&node);
+
+        if(type == FLAGS_DIR && (flags & DFS_DIR_RECURSIVE) && depth < MAX_DIRECTORY_DEPTH)
+        {
+            /* Descend, remembering where to continue afterwards */
+            resume[depth] = dirent;
+            resume_parent[depth] = parent;
+            depth++;
+
+            parent = count - 1;
+            dirent = get_first_entry(&node);
+        }
+    }
+
+    return count;
+}
+
 /**
  * @brief Open a file given a path
  *
@@ -823,6 +1005,8 @@ int dfs_open(const char * const path)
     file->loc = 0;
     file->sector_number = 0;
     file->start_sector = get_first_sector(&t_node);
+    file->sector_loc = file->start_sector;
+    file->sector_stale = 0;
     grab_sector(file->start_sector, &file->cur_sector);
 
     return file->handle;
@@ -991,13 +1175,30 @@ int dfs_read(void * const buf, int size, int count, uint32_t handle)
 
     /* Soemthing we can actually incriment! */
     uint8_t *data = buf;
+    uint8_t *end = data + to_read;
 
     /* Loop in, reading data in the cached sector */
     while(to_read)
     {
         /* Do we need to seek? */
         uint32_t t_sector = sector_from_loc(file->loc);
-        
+
+        /* Whole sectors go straight to the caller when the buffer allows it.
+         * When the buffer is only 4 byte aligned, the sector link lands in
+         * data we already read.  Sectors sharing a cache line with memory
+         * outside the buffer, usually the first and last, go through the
+         * sector cache instead. */
+        int direct = offset_into_sector(file->loc) == 0 && to_read >= SECTOR_PAYLOAD &&
+                     ((((uint32_t)data & 7) == 0 && dma_span_inside(data, SECTOR_PAYLOAD, buf, end)) ||
+                      (((uint32_t)data & 7) == 4 && dma_span_inside(data - sizeof(uint32_t), SECTOR_SIZE, buf, end)));
+
+        if(direct && t_sector == file->sector_number + 1)
+        {
+            /* Step to the next sector without fetching it, it is read below */
+            file->sector_loc = get_next_sector(&file->cur_sector);
+            file->sector_number++;
+        }
+
         if(t_sector != file->sector_number)
         {
             /* Must seek to new sector */
@@ -1011,11 +1212,35 @@ int dfs_read(void * const buf, int size, int count, uint32_t handle)
                 /* Start over, walk all the way */
                 grab_sector(file->start_sector, &file->cur_sector);
                 file->sector_number = 0;
+                file->sector_loc = file->start_sector;
+                file->sector_stale = 0;
 
                 walk_sectors(file, t_sector);
             }
         }
 
+        if(direct)
+        {
+            uint32_t next = read_sector_direct(file->sector_loc, data);
+
+            /* Only the link is valid in the cache now, it is all a walk needs */
+            file->cur_sector.next_sector = next;
+            file->sector_stale = 1;
+
+            data += SECTOR_PAYLOAD;
+            did_read += SECTOR_PAYLOAD;
+            file->loc += SECTOR_PAYLOAD;
+            to_read -= SECTOR_PAYLOAD;
+            continue;
+        }
+
+        if(file->sector_stale)
+        {
+            /* Sector was read directly before, fetch it for real */
+            grab_sector(file->sector_loc, &file->cur_sector);
+            file->sector_stale = 0;
+        }
+
         /* Only read as much as we currently have */
         int read_this_loop = to_read;
         if(read_this_loop > data_left_in_sector(file->loc))
@@ -1127,8 +1352,8 @@ static int __fstat( void *file, struct stat *st )
     st->st_atime = 0;
     st->st_mtime = 0;
     st->st_ctime = 0;
-    st->st_blksize = 0;
-    st->st_blocks = 0;
+    st->st_blksize = DFS_BLOCK_SIZE;
+    st->st_blocks = (st->st_size + 511) / 512;
     //st->st_attr = S_IAREAD | S_IAREAD;
 
     return 0;
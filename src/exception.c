@@ -17,13 +17,14 @@
  * #register_exception_handler will be passed information regarding the
  * exception type and relevant registers.
  *
+ * The @ref crash installs a handler that records a backtrace and writes a
+ * report to the console, USB or EEPROM.
+ *
  * @{
  */
 
 /** @brief Exception handler currently registered with exception system */
 static void (*__exception_handler)(exception_t*) = NULL;
-/** @brief Base register offset as defined by the interrupt controller */
-extern const unsigned char* __baseRegAddr;
 
 /**
  * @brief Register an exception handler to handle exceptions
@@ -67,37 +68,45 @@ static const char* __get_exception_name(uint32_t etype)
  * @param[in]  type
  *             Exception type.  Either #EXCEPTION_TYPE_CRITICAL or 
  *             #EXCEPTION_TYPE_RESET
+ * @param[in]  regs
+ *             Registers saved by the interrupt handler
  */
-static void __fetch_regs(exception_t* e,int32_t type)
+static void __fetch_regs(exception_t* e,int32_t type,reg_block_t* regs)
 {
-	e->regs = (volatile const reg_block_t*) __baseRegAddr;
+	e->regs = regs;
 	e->type = type;
 	e->info = __get_exception_name((uint32_t)e->regs->gpr[30]);
 }
 
 /**
  * @brief Respond to a critical exception
+ *
+ * @param[in] regs
+ *            Registers saved by the interrupt handler
  */
-void __onCriticalException()
+void __onCriticalException(reg_block_t* regs)
 {
 	exception_t e;
 	
 	if(!__exception_handler) { return; }
 
-	__fetch_regs(&e,EXCEPTION_TYPE_CRITICAL);
+	__fetch_regs(&e,EXCEPTION_TYPE_CRITICAL,regs);
 	__exception_handler(&e);
 }
 
 /**
  * @brief Respond to a reset exception
+ *
+ * @param[in] regs
+ *            Registers saved by the interrupt handler
  */
-void __onResetException()
+void __onResetException(reg_block_t* regs)
 {
 	exception_t e;
 	
 	if(!__exception_handler) { return; }
 
-	__fetch_regs(&e,EXCEPTION_TYPE_RESET);
+	__fetch_regs(&e,EXCEPTION_TYPE_RESET,regs);
 	__exception_handler(&e);
 }
 
@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <malloc.h>
 #include <string.h>
+#include "n64sys.h"
 #include "display.h"
 #include "graphics.h"
 #include "font.h"
@@ -195,7 +196,7 @@ void graphics_set_color( uint32_t forecolor, uint32_t backcolor )
  * @retval 1 if the color is fully transparent
  * @retval 0 if the color is translucent or opaque
  */
-static int __is_transparent( int bitdepth, uint32_t color )
+HOT_TEXT static int __is_transparent( int bitdepth, uint32_t color )
 {
     if( bitdepth == 2 )
     {
@@ -479,7 +480,7 @@ void graphics_draw_line_trans( display_context_t disp, int x0, int y0, int x1, i
  *            The 32-bit RGBA color to draw to the screen.  Use #graphics_convert_color
  *            or #graphics_make_color to generate this value.
  */
-void graphics_draw_box( display_context_t disp, int x, int y, int width, int height, uint32_t color )
+HOT_TEXT void graphics_draw_box( display_context_t disp, int x, int y, int width, int height, uint32_t color )
 {
     if( disp == 0 ) { return; }
 
@@ -603,7 +604,7 @@ void graphics_draw_box_trans( display_context_t disp, int x, int y, int width, i
  *            The 32-bit RGBA color to draw to the screen.  Use #graphics_convert_color
  *            or #graphics_make_color to generate this value.
  */
-void graphics_fill_screen( display_context_t disp, uint32_t c )
+HOT_TEXT void graphics_fill_screen( display_context_t disp, uint32_t c )
 {
     if( disp == 0 ) { return; }
 
@@ -647,7 +648,7 @@ void graphics_fill_screen( display_context_t disp, uint32_t c )
  * @param[in] ch
  *            The ASCII character to draw to the screen.
  */
-void graphics_draw_character( display_context_t disp, int x, int y, char ch )
+HOT_TEXT void graphics_draw_character( display_context_t disp, int x, int y, char ch )
 {
     if( disp == 0 ) { return; }
 
@@ -830,7 +831,7 @@ void graphics_draw_sprite( display_context_t disp, int x, int y, sprite_t *sprit
  *            starting from 0.  The top left sprite in the map is 0, the next one to the right 
  *            is 1, and so on.
  */
-void graphics_draw_sprite_stride( display_context_t disp, int x, int y, sprite_t *sprite, int offset )
+HOT_TEXT void graphics_draw_sprite_stride( display_context_t disp, int x, int y, sprite_t *sprite, int offset )
 {
     /* Sanity checking */
     if( disp == 0 ) { return; }
@@ -998,7 +999,7 @@ void graphics_draw_sprite_trans( display_context_t disp, int x, int y, sprite_t
  *            is 1, and so on.
  */
 
-void graphics_draw_sprite_trans_stride( display_context_t disp, int x, int y, sprite_t *sprite, int offset )
+HOT_TEXT void graphics_draw_sprite_trans_stride( display_context_t disp, int x, int y, sprite_t *sprite, int offset )
 {
     /* Sanity checking */
     if( disp == 0 ) { return; }
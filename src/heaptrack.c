@@ -0,0 +1,863 @@
+/**
+ * @file heaptrack.c
+ * @brief Heap Tracking
+ * @ingroup heaptrack
+ */
+#include <stdio.h>
+#define __HEAP_TRACK_INTERNAL
+#include "heaptrack.h"
+
+/**
+ * @defgroup heaptrack Heap Tracking
+ * @ingroup libdragon
+ * @brief Instrumented allocation wrappers for finding leaks and heap growth.
+ *
+ * With only 4 MB of memory, a slow leak or a level that allocates a little
+ * more than the last one ends in an out of memory crash long after the code
+ * responsible ran.  The heap tracker records every live allocation along
+ * with the source line that made it, so the growth can be traced back.
+ *
+ * Building code with HEAP_TRACK defined replaces malloc, calloc, realloc,
+ * memalign, strdup and free with the tracking versions in that code.  The
+ * tracking functions may also be called directly.  Allocations made by code
+ * built without HEAP_TRACK are not seen, and freeing a tracked allocation
+ * from such code leaves it reported as live.
+ *
+ * Call #heap_track_frame once per frame to collect per frame allocation
+ * counts.  #heap_track_report prints the overall usage and peak, the call
+ * sites holding the most memory and histograms of allocation sizes and
+ * allocations per frame.  To find leaks, take a #heap_track_checkpoint
+ * before an operation that should not keep memory, such as loading and
+ * unloading a level, and list what is still live afterwards with
+ * #heap_track_leaks.  Reports are written a line at a time to a callback,
+ * so they can go to the console or to #_64Drive_putstring.
+ *
+ * The tracker only depends on the C library, so it can be built on the host
+ * together with code under test to catch memory regressions there.  The
+ * tables it uses are fixed in size and never allocate.
+ * @{
+ */
+
+#ifdef __mips__
+#include "interrupt.h"
+#else
+/** @brief Host builds have no interrupts to guard against */
+static inline uint32_t interrupt_disable_save( void ) { return 0; }
+/** @brief Host builds have no interrupts to guard against */
+static inline void interrupt_restore( uint32_t state ) { }
+#endif
+
+/** @brief Site index used when the site table is full */
+#define SITE_NONE       -1
+
+/** @brief Number of call sites listed in a report */
+#define REPORT_SITES    8
+
+/** @brief Width in characters of the longest histogram bar */
+#define BAR_WIDTH       32
+
+/** @brief Multiplier for Fibonacci hashing */
+#define HASH_MULT       2654435761u
+
+/**
+ * @brief A live allocation
+ */
+typedef struct
+{
+    /** @brief Pointer returned to the caller, or null for an empty slot */
+    void *ptr;
+    /** @brief Requested size in bytes */
+    uint32_t size;
+    /** @brief Sequence number, compared against checkpoints */
+    uint32_t seq;
+    /** @brief Index of the call site or #SITE_NONE */
+    int site;
+} heap_track_alloc_t;
+
+/** @brief Call sites, hashed by line */
+static heap_track_site_t sites[HEAP_TRACK_MAX_SITES];
+/** @brief Live allocations, hashed by pointer */
+static heap_track_alloc_t allocs[HEAP_TRACK_MAX_ALLOCS];
+/** @brief Overall statistics */
+static heap_track_stats_t stats;
+/** @brief Sequence number given to the next allocation */
+static uint32_t next_seq;
+/** @brief Allocation sizes, by power of two */
+static uint32_t size_hist[HEAP_TRACK_BUCKETS];
+/** @brief Allocations made in each of the last frames */
+static uint32_t frame_allocs[HEAP_TRACK_FRAMES];
+/** @brief Bytes allocated in each of the last frames */
+static uint32_t frame_bytes[HEAP_TRACK_FRAMES];
+/** @brief Buffer reports are formatted into */
+static char line_buf[160];
+
+/**
+ * @brief Return the power of two histogram bucket of a value
+ *
+ * @param[in] value
+ *            Value to bucket
+ *
+ * @return Bucket 0 for 0 and 1, otherwise the index of the highest set bit,
+ *         clamped to the last bucket
+ */
+static int __bucket( uint32_t value )
+{
+    int bucket = 0;
+
+    while( value > 1 && bucket < HEAP_TRACK_BUCKETS - 1 )
+    {
+        value >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/**
+ * @brief Return the per frame histogram bucket of an allocation count
+ *
+ * @param[in] count
+ *            Number of allocations made in a frame
+ *
+ * @return Bucket 0 for frames without allocations, otherwise one past the
+ *         power of two bucket, clamped to the last bucket
+ */
+static int __frame_bucket( uint32_t count )
+{
+    if( !count ) { return 0; }
+
+    int bucket = __bucket( count ) + 1;
+
+    return bucket < HEAP_TRACK_BUCKETS ? bucket : HEAP_TRACK_BUCKETS - 1;
+}
+
+/**
+ * @brief Find or add a call site
+ *
+ * @param[in] file
+ *            Source file
+ * @param[in] line
+ *            Source line
+ *
+ * @return Index of the site or #SITE_NONE if the table is full
+ */
+static int __find_site( const char *file, int line )
+{
+    uint32_t slot = ((uint32_t)line * HASH_MULT) % HEAP_TRACK_MAX_SITES;
+
+    for( int i = 0; i < HEAP_TRACK_MAX_SITES; i++ )
+    {
+        heap_track_site_t *site = &sites[slot];
+
+        if( !site->total_count )
+        {
+            /* Empty slot, so the site isn't known yet */
+            site->file = file;
+            site->line = line;
+            return slot;
+        }
+
+        if( site->line == line &&
+            (site->file == file || (site->file && file && !strcmp( site->file, file ))) )
+        {
+            return slot;
+        }
+
+        slot = (slot + 1) % HEAP_TRACK_MAX_SITES;
+    }
+
+    return SITE_NONE;
+}
+
+/**
+ * @brief Return the slot a pointer hashes to in the allocation table
+ */
+static inline uint32_t __alloc_slot( void *ptr )
+{
+    return ((uint32_t)((uintptr_t)ptr >> 3) * HASH_MULT) % HEAP_TRACK_MAX_ALLOCS;
+}
+
+/**
+ * @brief Record a new allocation
+ *
+ * @param[in] ptr
+ *            Allocated memory, or null if the allocation failed
+ * @param[in] size
+ *            Requested size in bytes
+ * @param[in] file
+ *            Source file of the call
+ * @param[in] line
+ *            Source line of the call
+ */
+static void __record_alloc( void *ptr, size_t size, const char *file, int line )
+{
+    uint32_t state = interrupt_disable_save();
+
+    if( !ptr )
+    {
+        stats.failures++;
+        interrupt_restore( state );
+        return;
+    }
+
+    int site = __find_site( file, line );
+
+    if( site != SITE_NONE )
+    {
+        heap_track_site_t *s = &sites[site];
+
+        s->total_count++;
+        s->live_count++;
+        s->live_bytes += size;
+        if( s->live_bytes > s->peak_bytes ) { s->peak_bytes = s->live_bytes; }
+    }
+
+    /* Find a free slot for the allocation */
+    uint32_t slot = __alloc_slot( ptr );
+    int i;
+
+    for( i = 0; i < HEAP_TRACK_MAX_ALLOCS && allocs[slot].ptr; i++ )
+    {
+        slot = (slot + 1) % HEAP_TRACK_MAX_ALLOCS;
+    }
+
+    if( i < HEAP_TRACK_MAX_ALLOCS )
+    {
+        allocs[slot].ptr = ptr;
+        allocs[slot].size = size;
+        allocs[slot].seq = next_seq;
+        allocs[slot].site = site;
+
+        stats.live_count++;
+        stats.live_bytes += size;
+        if( stats.live_bytes > stats.peak_bytes ) { stats.peak_bytes = stats.live_bytes; }
+    }
+    else
+    {
+        /* Can't be freed from the site later, so don't keep it live there */
+        if( site != SITE_NONE )
+        {
+            sites[site].live_count--;
+            sites[site].live_bytes -= size;
+        }
+
+        stats.dropped++;
+    }
+
+    next_seq++;
+    stats.allocs++;
+    stats.frame_allocs++;
+    stats.frame_bytes += size;
+    size_hist[__bucket( size )]++;
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Forget an allocation that is being freed
+ *
+ * Unknown pointers are ignored, as they were allocated by untracked code or
+ * didn't fit in the table.
+ *
+ * @param[in]  ptr
+ *             Memory being freed
+ * @param[out] old
+ *             Receives the forgotten entry if not null
+ *
+ * @return The size of the allocation, or 0 if it wasn't tracked
+ */
+static uint32_t __record_free( void *ptr, heap_track_alloc_t *old )
+{
+    uint32_t size = 0;
+
+    if( !ptr ) { return 0; }
+
+    uint32_t state = interrupt_disable_save();
+    uint32_t slot = __alloc_slot( ptr );
+
+    for( int i = 0; i < HEAP_TRACK_MAX_ALLOCS && allocs[slot].ptr; i++ )
+    {
+        if( allocs[slot].ptr == ptr )
+        {
+            heap_track_alloc_t *a = &allocs[slot];
+
+            if( a->site != SITE_NONE )
+            {
+                sites[a->site].live_count--;
+                sites[a->site].live_bytes -= a->size;
+            }
+
+            stats.live_count--;
+            stats.live_bytes -= a->size;
+            stats.frees++;
+
+            /* Shift later entries of the probe sequence back into the hole */
+            uint32_t hole = slot;
+            uint32_t next = (slot + 1) % HEAP_TRACK_MAX_ALLOCS;
+
+            size = a->size;
+            if( old ) { *old = *a; }
+            a->ptr = 0;
+
+            while( allocs[next].ptr )
+            {
+                uint32_t home = __alloc_slot( allocs[next].ptr );
+
+                /* Move the entry if its home isn't between the hole and it */
+                if( ((next - home) % HEAP_TRACK_MAX_ALLOCS) >= ((next - hole) % HEAP_TRACK_MAX_ALLOCS) )
+                {
+                    allocs[hole] = allocs[next];
+                    allocs[next].ptr = 0;
+                    hole = next;
+                }
+
+                next = (next + 1) % HEAP_TRACK_MAX_ALLOCS;
+            }
+
+            break;
+        }
+
+        slot = (slot + 1) % HEAP_TRACK_MAX_ALLOCS;
+    }
+
+    interrupt_restore( state );
+
+    return size;
+}
+
+/**
+ * @brief Track an allocation again after a failed realloc
+ *
+ * Undoes #__record_free, so the block keeps its call site and sequence
+ * number and the failed call doesn't count as a free.
+ *
+ * @param[in] old
+ *            Entry returned by #__record_free
+ */
+static void __restore_alloc( const heap_track_alloc_t *old )
+{
+    uint32_t state = interrupt_disable_save();
+    uint32_t slot = __alloc_slot( old->ptr );
+    int i;
+
+    for( i = 0; i < HEAP_TRACK_MAX_ALLOCS && allocs[slot].ptr; i++ )
+    {
+        slot = (slot + 1) % HEAP_TRACK_MAX_ALLOCS;
+    }
+
+    stats.frees--;
+
+    if( i < HEAP_TRACK_MAX_ALLOCS )
+    {
+        allocs[slot] = *old;
+
+        if( old->site != SITE_NONE )
+        {
+            sites[old->site].live_count++;
+            sites[old->site].live_bytes += old->size;
+        }
+
+        stats.live_count++;
+        stats.live_bytes += old->size;
+    }
+    else
+    {
+        /* An interrupt filled the table in the meantime */
+        stats.dropped++;
+    }
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Forget all tracked allocations and statistics
+ *
+ * Memory already allocated is not freed.
+ */
+void heap_track_reset( void )
+{
+    uint32_t state = interrupt_disable_save();
+
+    memset( sites, 0, sizeof(sites) );
+    memset( allocs, 0, sizeof(allocs) );
+    memset( &stats, 0, sizeof(stats) );
+    memset( size_hist, 0, sizeof(size_hist) );
+    memset( frame_allocs, 0, sizeof(frame_allocs) );
+    memset( frame_bytes, 0, sizeof(frame_bytes) );
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Allocate memory and track the allocation
+ *
+ * @param[in] size
+ *            Size in bytes
+ * @param[in] file
+ *            Source file of the call, or null
+ * @param[in] line
+ *            Source line of the call
+ *
+ * @return A pointer to the memory or null if out of memory
+ */
+void *heap_track_malloc( size_t size, const char *file, int line )
+{
+    void *ptr = malloc( size );
+
+    __record_alloc( ptr, size, file, line );
+
+    return ptr;
+}
+
+/**
+ * @brief Allocate zeroed memory for an array and track the allocation
+ *
+ * @param[in] count
+ *            Number of elements
+ * @param[in] size
+ *            Size of each element in bytes
+ * @param[in] file
+ *            Source file of the call, or null
+ * @param[in] line
+ *            Source line of the call
+ *
+ * @return A pointer to the memory or null if out of memory
+ */
+void *heap_track_calloc( size_t count, size_t size, const char *file, int line )
+{
+    void *ptr = calloc( count, size );
+
+    __record_alloc( ptr, count * size, file, line );
+
+    return ptr;
+}
+
+/**
+ * @brief Resize an allocation and track the result
+ *
+ * @param[in] ptr
+ *            Memory to resize, or null to allocate new memory
+ * @param[in] size
+ *            New size in bytes
+ * @param[in] file
+ *            Source file of the call, or null
+ * @param[in] line
+ *            Source line of the call
+ *
+ * @return A pointer to the resized memory or null if out of memory, in
+ *         which case the original memory is left untouched
+ */
+void *heap_track_realloc( void *ptr, size_t size, const char *file, int line )
+{
+    /* Forget the old memory first, as realloc may hand its address out again */
+    heap_track_alloc_t old = { 0 };
+
+    __record_free( ptr, &old );
+
+    void *ret = realloc( ptr, size );
+
+    if( ret || size )
+    {
+        __record_alloc( ret, size, file, line );
+    }
+
+    if( !ret && size && old.ptr )
+    {
+        /* The original memory is still allocated */
+        __restore_alloc( &old );
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Allocate aligned memory and track the allocation
+ *
+ * @param[in] align
+ *            Alignment in bytes, a power of two
+ * @param[in] size
+ *            Size in bytes
+ * @param[in] file
+ *            Source file of the call, or null
+ * @param[in] line
+ *            Source line of the call
+ *
+ * @return A pointer to the memory or null if out of memory
+ */
+void *heap_track_memalign( size_t align, size_t size, const char *file, int line )
+{
+    void *ptr = memalign( align, size );
+
+    __record_alloc( ptr, size, file, line );
+
+    return ptr;
+}
+
+/**
+ * @brief Duplicate a string and track the allocation
+ *
+ * @param[in] str
+ *            String to duplicate
+ * @param[in] file
+ *            Source file of the call, or null
+ * @param[in] line
+ *            Source line of the call
+ *
+ * @return A pointer to the copy or null if out of memory
+ */
+char *heap_track_strdup( const char *str, const char *file, int line )
+{
+    size_t size = strlen( str ) + 1;
+    char *ret = malloc( size );
+
+    if( ret ) { memcpy( ret, str, size ); }
+
+    __record_alloc( ret, size, file, line );
+
+    return ret;
+}
+
+/**
+ * @brief Free memory and stop tracking it
+ *
+ * @param[in] ptr
+ *            Memory to free, or null
+ */
+void heap_track_free( void *ptr )
+{
+    __record_free( ptr, 0 );
+    free( ptr );
+}
+
+/**
+ * @brief Mark the end of a frame
+ *
+ * The allocations made since the previous call are added to the per frame
+ * histogram.
+ */
+void heap_track_frame( void )
+{
+    uint32_t state = interrupt_disable_save();
+    int slot = stats.frame % HEAP_TRACK_FRAMES;
+
+    frame_allocs[slot] = stats.frame_allocs;
+    frame_bytes[slot] = stats.frame_bytes;
+    stats.frame_allocs = 0;
+    stats.frame_bytes = 0;
+    stats.frame++;
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Return a checkpoint to look for leaks from
+ *
+ * @return A value to pass to #heap_track_leaks
+ */
+uint32_t heap_track_checkpoint( void )
+{
+    return next_seq;
+}
+
+/**
+ * @brief Read the overall statistics
+ *
+ * @param[out] out
+ *             Structure to copy the statistics into
+ */
+void heap_track_get_stats( heap_track_stats_t *out )
+{
+    uint32_t state = interrupt_disable_save();
+    *out = stats;
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Read the statistics of a call site
+ *
+ * @param[in]  index
+ *             Index of the site, from 0 to #HEAP_TRACK_MAX_SITES - 1
+ * @param[out] out
+ *             Structure to copy the statistics into
+ *
+ * @retval 1 if the site has been used
+ * @retval 0 if the slot is empty or out of range
+ */
+int heap_track_get_site( int index, heap_track_site_t *out )
+{
+    if( index < 0 || index >= HEAP_TRACK_MAX_SITES ) { return 0; }
+
+    uint32_t state = interrupt_disable_save();
+    *out = sites[index];
+    interrupt_restore( state );
+
+    return out->total_count != 0;
+}
+
+/**
+ * @brief Write a report line through an output callback
+ *
+ * @param[in] output
+ *            Callback, or null to write to stdout
+ */
+static void __output( heap_track_output_t output )
+{
+    if( output )
+    {
+        output( line_buf );
+    }
+    else
+    {
+        fputs( line_buf, stdout );
+    }
+}
+
+/**
+ * @brief Format a call site as file:line
+ *
+ * @param[out] buf
+ *             Buffer to write to
+ * @param[in]  size
+ *             Size of the buffer
+ * @param[in]  site
+ *             Call site, or null if it didn't fit in the table
+ */
+static void __format_site( char *buf, int size, const heap_track_site_t *site )
+{
+    if( !site )
+    {
+        snprintf( buf, size, "(untracked site)" );
+    }
+    else if( !site->file )
+    {
+        snprintf( buf, size, "(unknown)" );
+    }
+    else
+    {
+        /* Only the file name, paths make the report too wide */
+        const char *name = strrchr( site->file, '/' );
+
+        snprintf( buf, size, "%s:%d", name ? name + 1 : site->file, site->line );
+    }
+}
+
+/**
+ * @brief Write one histogram bar
+ *
+ * @param[in] output
+ *            Output callback
+ * @param[in] label
+ *            Label of the bucket
+ * @param[in] value
+ *            Value of the bucket
+ * @param[in] max
+ *            Largest value in the histogram
+ */
+static void __output_bar( heap_track_output_t output, const char *label, uint32_t value, uint32_t max )
+{
+    int len = snprintf( line_buf, sizeof(line_buf), "  %-8s %8lu ", label, (unsigned long)value );
+    int bar = max ? (int)((uint64_t)value * BAR_WIDTH / max) : 0;
+
+    if( value && !bar ) { bar = 1; }
+
+    for( int i = 0; i < bar; i++ ) { line_buf[len++] = '#'; }
+
+    line_buf[len++] = '\n';
+    line_buf[len] = 0;
+
+    __output( output );
+}
+
+/**
+ * @brief List the allocations made after a checkpoint that are still live
+ *
+ * @param[in] checkpoint
+ *            Value returned by #heap_track_checkpoint, or 0 for everything
+ * @param[in] output
+ *            Callback to write each line to, or null to write to stdout
+ *
+ * @return The number of live allocations found
+ */
+int heap_track_leaks( uint32_t checkpoint, heap_track_output_t output )
+{
+    char site[64];
+    int count = 0;
+    uint32_t bytes = 0;
+
+    for( int i = 0; i < HEAP_TRACK_MAX_ALLOCS; i++ )
+    {
+        /* Copy the entry so output isn't done with interrupts disabled */
+        uint32_t state = interrupt_disable_save();
+        heap_track_alloc_t a = allocs[i];
+        if( a.ptr ) { __format_site( site, sizeof(site), a.site == SITE_NONE ? 0 : &sites[a.site] ); }
+        interrupt_restore( state );
+
+        if( !a.ptr || (int32_t)(a.seq - checkpoint) < 0 ) { continue; }
+
+        snprintf( line_buf, sizeof(line_buf), "leak: %p %lu bytes from %s\n",
+                  a.ptr, (unsigned long)a.size, site );
+        __output( output );
+
+        count++;
+        bytes += a.size;
+    }
+
+    snprintf( line_buf, sizeof(line_buf), "%d allocations, %lu bytes live since checkpoint\n",
+              count, (unsigned long)bytes );
+    __output( output );
+
+    return count;
+}
+
+/**
+ * @brief Write a report of heap usage
+ *
+ * The report holds the overall usage and peak, the call sites with the
+ * most live memory and histograms of allocation sizes and allocations per
+ * frame.
+ *
+ * @param[in] output
+ *            Callback to write each line to, or null to write to stdout
+ */
+void heap_track_report( heap_track_output_t output )
+{
+    static heap_track_site_t snapshot[HEAP_TRACK_MAX_SITES];
+    static uint32_t sizes[HEAP_TRACK_BUCKETS];
+    static uint32_t per_frame[HEAP_TRACK_BUCKETS];
+    heap_track_stats_t s;
+    int top[REPORT_SITES];
+    int num_top = 0;
+    uint32_t max_frame = 0;
+    uint64_t sum_frame = 0;
+    char site[64];
+    char label[16];
+
+    /* Take a consistent copy of everything, then format without locking */
+    uint32_t state = interrupt_disable_save();
+
+    s = stats;
+    memcpy( snapshot, sites, sizeof(sites) );
+    memcpy( sizes, size_hist, sizeof(sizes) );
+    memset( per_frame, 0, sizeof(per_frame) );
+
+    int frames = s.frame < HEAP_TRACK_FRAMES ? s.frame : HEAP_TRACK_FRAMES;
+
+    for( int i = 0; i < frames; i++ )
+    {
+        per_frame[__frame_bucket( frame_allocs[i] )]++;
+        sum_frame += frame_allocs[i];
+        if( frame_allocs[i] > max_frame ) { max_frame = frame_allocs[i]; }
+    }
+
+    interrupt_restore( state );
+
+    snprintf( line_buf, sizeof(line_buf), "heap: %lu live allocations, %lu bytes, peak %lu bytes\n",
+              (unsigned long)s.live_count, (unsigned long)s.live_bytes, (unsigned long)s.peak_bytes );
+    __output( output );
+
+    snprintf( line_buf, sizeof(line_buf), "%lu allocs, %lu frees, %lu failed, %lu untracked\n",
+              (unsigned long)s.allocs, (unsigned long)s.frees,
+              (unsigned long)s.failures, (unsigned long)s.dropped );
+    __output( output );
+
+    /* Keep the sites with the most live bytes, sorted by insertion */
+    for( int i = 0; i < HEAP_TRACK_MAX_SITES; i++ )
+    {
+        if( !snapshot[i].live_bytes ) { continue; }
+
+        int pos = num_top;
+
+        if( num_top < REPORT_SITES )
+        {
+            num_top++;
+        }
+        else if( snapshot[top[REPORT_SITES - 1]].live_bytes >= snapshot[i].live_bytes )
+        {
+            continue;
+        }
+        else
+        {
+            pos = REPORT_SITES - 1;
+        }
+
+        while( pos > 0 && snapshot[top[pos - 1]].live_bytes < snapshot[i].live_bytes )
+        {
+            top[pos] = top[pos - 1];
+            pos--;
+        }
+
+        top[pos] = i;
+    }
+
+    if( num_top )
+    {
+        snprintf( line_buf, sizeof(line_buf), "top sites by live bytes:\n" );
+        __output( output );
+    }
+
+    for( int i = 0; i < num_top; i++ )
+    {
+        heap_track_site_t *t = &snapshot[top[i]];
+
+        __format_site( site, sizeof(site), t );
+        snprintf( line_buf, sizeof(line_buf), "  %-24s %6lu bytes in %lu, peak %lu, total %lu\n",
+                  site, (unsigned long)t->live_bytes, (unsigned long)t->live_count,
+                  (unsigned long)t->peak_bytes, (unsigned long)t->total_count );
+        __output( output );
+    }
+
+    /* Allocation sizes */
+    uint32_t max = 0;
+    for( int i = 0; i < HEAP_TRACK_BUCKETS; i++ ) { if( sizes[i] > max ) { max = sizes[i]; } }
+
+    snprintf( line_buf, sizeof(line_buf), "allocation sizes:\n" );
+    __output( output );
+
+    for( int i = 0; i < HEAP_TRACK_BUCKETS; i++ )
+    {
+        if( !sizes[i] ) { continue; }
+
+        if( i < HEAP_TRACK_BUCKETS - 1 )
+        {
+            snprintf( label, sizeof(label), "<%lu", 2UL << i );
+        }
+        else
+        {
+            snprintf( label, sizeof(label), ">=%lu", 1UL << i );
+        }
+
+        __output_bar( output, label, sizes[i], max );
+    }
+
+    if( !frames ) { return; }
+
+    /* Allocations per frame, bucket 0 holds frames without allocations */
+    max = 0;
+    for( int i = 0; i < HEAP_TRACK_BUCKETS; i++ ) { if( per_frame[i] > max ) { max = per_frame[i]; } }
+
+    snprintf( line_buf, sizeof(line_buf), "allocations per frame over %d frames, avg %lu, max %lu:\n",
+              frames, (unsigned long)(sum_frame / frames), (unsigned long)max_frame );
+    __output( output );
+
+    for( int i = 0; i < HEAP_TRACK_BUCKETS; i++ )
+    {
+        if( !per_frame[i] ) { continue; }
+
+        if( i == 0 )
+        {
+            snprintf( label, sizeof(label), "0" );
+        }
+        else if( i < HEAP_TRACK_BUCKETS - 1 )
+        {
+            snprintf( label, sizeof(label), "<%lu", 2UL << (i - 1) );
+        }
+        else
+        {
+            snprintf( label, sizeof(label), ">=%lu", 1UL << (i - 1) );
+        }
+
+        __output_bar( output, label, per_frame[i], max );
+    }
+}
+
+/** @} */
@@ -3,7 +3,7 @@
  * @brief Interrupt Controller
  * @ingroup interrupt
  */
-#include <malloc.h>
+#include <string.h>
 #include "libdragon.h"
 #include "regsinternal.h"
 
@@ -37,6 +37,47 @@
  * In this manner, it is safe to nest calls to disable and enable
  * interrupts.
  *
+ * For short sections on hot paths, #interrupt_disable_save and
+ * #interrupt_restore are inlined and keep the previous state in a register
+ * instead of going through the nesting counter.  The atomic helpers such as
+ * #atomic_add and #atomic_set_bits are built on them, and are safe to use
+ * on data shared with interrupt handlers.  The outermost #enable_interrupts
+ * restores the state found by the outermost #disable_interrupts, so both
+ * kinds of sections may be nested inside each other.
+ *
+ * Callbacks are kept in fixed size tables, so registering a callback never
+ * allocates memory and may be done at any time, including from inside an
+ * interrupt handler.  Up to eight callbacks can be registered for each
+ * interrupt.
+ *
+ * By default callbacks run with interrupts disabled, so a slow callback
+ * delays every other interrupt.  #set_interrupt_priority gives interrupt
+ * sources a priority, and the callbacks of a source then run with the
+ * interrupts of higher priority sources enabled.  For example, raising the
+ * priority of AI above the others keeps audio buffers refilled on time
+ * while a long SI or DP callback runs.  Sources of equal or lower priority
+ * wait until the callback returns, so a source never interrupts its own
+ * callbacks.  Registers of interrupted code are kept in frames on the
+ * exception stack, and #in_interrupt returns how many interrupts are
+ * currently being handled.
+ *
+ * Callbacks can also hand slow work to #defer_work, which runs it with
+ * interrupts enabled just before the outermost interrupt returns.
+ *
+ * When libdragon is built with INTERRUPT_PROFILE defined, the time spent
+ * in the callbacks of each interrupt and the longest time interrupts were
+ * disabled are recorded, and can be read with #interrupt_profile_get, for
+ * example to display them on screen.  This adds a few timer reads to every
+ * interrupt and every #disable_interrupts call, so it is off by default.
+ *
+ * Most of the work of entering and leaving an interrupt is saving and
+ * restoring the FPU registers, so that callbacks may use floating point.
+ * If callbacks rarely do, #set_interrupt_fpu_save can turn this off,
+ * roughly halving the cost of every interrupt.  Callbacks then run with the
+ * FPU disabled, and the first floating point instruction of one traps and
+ * saves the FPU after all, so the interrupted code is never corrupted and
+ * only the interrupts that use the FPU pay for it.
+ *
  * @{
  */
 
@@ -112,134 +153,342 @@
  */
 static int __interrupt_depth = -1;
 
+/** @brief Interrupt enable bit of the status register before the outermost disable */
+static uint32_t __interrupt_sr_ie = 0;
+
+/** @brief Number of interrupts being handled, maintained by the interrupt handler */
+volatile int __interrupt_nest HOT_DATA = 0;
+
+/** @brief Registers saved by the innermost interrupt being handled */
+reg_block_t * volatile __interrupt_regs HOT_DATA = 0;
+
+/** @brief Status register interrupt enable bit */
+#define SR_IE 0x00000001
+/** @brief Status register exception level bit */
+#define SR_EXL 0x00000002
+/** @brief Status register timer interrupt mask bit */
+#define SR_IM7 0x00008000
+
+/** @brief Maximum number of callbacks that can be registered per interrupt */
+#define MAX_CALLBACKS 8
+
+/**
+ * @brief Number of interrupt sources coming through the MI
+ *
+ * These are numbered after their bit in the MI interrupt register.
+ */
+#define MI_SOURCE_COUNT INTERRUPT_SOURCE_TI
+
+/**
+ * @brief List of callbacks for an interrupt source
+ */
+typedef struct
+{
+    /** @brief Number of registered callbacks */
+    int count;
+    /** @brief Number of walks over the list in progress */
+    int walking;
+    /** @brief Nonzero if callbacks were removed during a walk */
+    int removed;
+    /**
+     * @brief Callback functions, in order of registration
+     *
+     * Callbacks removed while the list is walked are set to null, and the
+     * list is compacted once the walk is done.
+     */
+    void (*callback[MAX_CALLBACKS])();
+} callback_list_t;
+
 /**
- * @brief Structure of an interrupt callback
+ * @brief How to acknowledge an MI interrupt
  */
-typedef struct callback_link
+typedef struct
 {
-    /** @brief Callback function */
-    void (*callback)();
-    /** @brief Pointer to next callback */
-    struct callback_link * next;
-} _callback_link;
+    /** @brief Register to write to clear the interrupt */
+    volatile uint32_t *reg;
+    /** @brief Value to write to clear the interrupt */
+    uint32_t value;
+} intr_ack_t;
+
+/** @brief Bits of all MI sources */
+#define MI_SOURCE_ALL ((1 << MI_SOURCE_COUNT) - 1)
+
+/** @brief Priority of each interrupt source */
+static int priority[INTERRUPT_SOURCE_COUNT];
+/** @brief Sources allowed to interrupt the callbacks of each source */
+static uint32_t preempt_mask[INTERRUPT_SOURCE_COUNT] HOT_DATA;
+/** @brief MI sources enabled with the set accessors */
+static uint32_t mi_enabled HOT_DATA = 0;
+/** @brief MI sources held off while a callback of higher priority runs */
+static uint32_t mi_blocked HOT_DATA = 0;
 
-/** @brief Static structure to address AI registers */
-static volatile struct AI_regs_s * const AI_regs = (struct AI_regs_s *)0xa4500000;
 /** @brief Static structure to address MI registers */
 static volatile struct MI_regs_s * const MI_regs = (struct MI_regs_s *)0xa4300000;
 /** @brief Static structure to address VI registers */
 static volatile struct VI_regs_s * const VI_regs = (struct VI_regs_s *)0xa4400000;
-/** @brief Static structure to address PI registers */
-static volatile struct PI_regs_s * const PI_regs = (struct PI_regs_s *)0xa4600000;
-/** @brief Static structure to address SI registers */
-static volatile struct SI_regs_s * const SI_regs = (struct SI_regs_s *)0xa4800000;
-/** @brief Static structure to address SP registers */
-static volatile struct SP_regs_s * const SP_regs = (struct SP_regs_s *)0xa4040000;
-
-/** @brief Linked list of AI callbacks */
-struct callback_link * AI_callback = 0;
-/** @brief Linked list of VI callbacks */
-struct callback_link * VI_callback = 0;
-/** @brief Linked list of PI callbacks */
-struct callback_link * PI_callback = 0;
-/** @brief Linked list of DP callbacks */
-struct callback_link * DP_callback = 0;
-/** @brief Linked list of TI callbacks */
-struct callback_link * TI_callback = 0;
-/** @brief Linked list of SI callbacks */
-struct callback_link * SI_callback = 0;
-/** @brief Linked list of SP callbacks */
-struct callback_link * SP_callback = 0;
+
+/** @brief Registered callbacks for each interrupt source */
+static callback_list_t callbacks[INTERRUPT_SOURCE_COUNT] HOT_DATA;
+
+/**
+ * @brief Acknowledge actions for each MI interrupt source
+ *
+ * Any write to the VI current line register clears the VI interrupt.
+ */
+static const intr_ack_t mi_ack[MI_SOURCE_COUNT] =
+{
+    [INTERRUPT_SOURCE_SP] = { &((struct SP_regs_s *)0xa4040000)->status, SP_CLEAR_INTERRUPT },
+    [INTERRUPT_SOURCE_SI] = { &((struct SI_regs_s *)0xa4800000)->status, SI_CLEAR_INTERRUPT },
+    [INTERRUPT_SOURCE_AI] = { &((struct AI_regs_s *)0xa4500000)->status, AI_CLEAR_INTERRUPT },
+    [INTERRUPT_SOURCE_VI] = { &((struct VI_regs_s *)0xa4400000)->cur_line, 0 },
+    [INTERRUPT_SOURCE_PI] = { &((struct PI_regs_s *)0xa4600000)->status, PI_CLEAR_INTERRUPT },
+    [INTERRUPT_SOURCE_DP] = { &((struct MI_regs_s *)0xa4300000)->mode, DP_CLEAR_INTERRUPT },
+};
+
+/** @brief Nonzero if interrupts save the FPU, read by the interrupt handler */
+volatile int __interrupt_fpu_save HOT_DATA = 1;
+
+#ifdef INTERRUPT_PROFILE
+/** @brief Time spent in the callbacks of each interrupt source */
+static interrupt_source_profile_t profile[INTERRUPT_SOURCE_COUNT];
+/** @brief Longest time interrupts were disabled */
+static uint32_t max_disabled_ticks = 0;
+/** @brief Caller that started the longest window with interrupts disabled */
+static void *max_disabled_caller = 0;
+/** @brief Tick count when interrupts were last disabled */
+static long long disabled_start = 0;
+/** @brief Caller that last disabled interrupts */
+static void *disabled_caller = 0;
+#endif
 
 /** 
- * @brief Call each callback in a linked list of callbacks
+ * @brief Call each callback registered for an interrupt source
  *
- * @param[in] head
- *            Pointer to the head of a callback linke list
+ * Callbacks are called newest first.  A callback may unregister itself or
+ * any other callback, which is then no longer called; callbacks registered
+ * meanwhile are first called on the next interrupt.
+ *
+ * @param[in] source
+ *            Interrupt source to call the callbacks of
  */
-static void __call_callback( struct callback_link * head )
+HOT_TEXT static void __call_callback( interrupt_source_t source )
 {
-    /* Call each registered callback */
-    while( head )
+    callback_list_t *list = &callbacks[source];
+#ifdef INTERRUPT_PROFILE
+    long long start = timer_ticks_fast();
+#endif
+
+    uint32_t state = interrupt_disable_save();
+    list->walking++;
+    interrupt_restore( state );
+
+    for( int i = list->count - 1; i >= 0; i-- )
     {
-        if( head->callback )
+        void (*callback)() = list->callback[i];
+
+        if( callback ) { callback(); }
+    }
+
+    state = interrupt_disable_save();
+
+    if( !--list->walking && list->removed )
+    {
+        /* Close the gaps left by callbacks removed during the walk */
+        int kept = 0;
+
+        for( int i = 0; i < list->count; i++ )
         {
-        	head->callback();
+            if( list->callback[i] ) { list->callback[kept++] = list->callback[i]; }
         }
 
-        /* Go to next */
-	    head=head->next;
+        list->count = kept;
+        list->removed = 0;
     }
+
+    interrupt_restore( state );
+
+#ifdef INTERRUPT_PROFILE
+    /* The timer rewinds the count register, so only trust the low bits */
+    uint32_t ticks = (uint32_t)(timer_ticks_fast() - start);
+
+    profile[source].count++;
+    profile[source].total_ticks += ticks;
+    if( ticks > profile[source].max_ticks ) { profile[source].max_ticks = ticks; }
+#endif
 }
 
 /**
- * @brief Add a callback to a linked list of callbacks
+ * @brief Write the MI mask register from the enabled and blocked sources
+ */
+HOT_TEXT static void __mi_update_mask( void )
+{
+    uint32_t active = mi_enabled & ~mi_blocked;
+    uint32_t write = 0;
+
+    /* Each source has a clear bit followed by a set bit */
+    for( int source = 0; source < MI_SOURCE_COUNT; source++ )
+    {
+        write |= ((active >> source) & 1) ? (2 << (source * 2)) : (1 << (source * 2));
+    }
+
+    MI_regs->mask = write;
+}
+
+/**
+ * @brief Enable or disable an MI interrupt source
  *
- * @param[in,out] head
- *                Pointer to the head of a linked list to add to
- * @param[in]     callback
- *                Function to call when executing callbacks in this linked list
+ * @param[in] source
+ *            Interrupt source
+ * @param[in] active
+ *            Nonzero to enable the interrupt
  */
-static void __register_callback( struct callback_link ** head, void (*callback)() )
+static void __set_mi_interrupt( interrupt_source_t source, int active )
 {
-    if( head )
+    uint32_t state = interrupt_disable_save();
+
+    if( active ) { mi_enabled |= (1 << source); }
+    else { mi_enabled &= ~(1 << source); }
+
+    __mi_update_mask();
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Leave exception level so the interrupt handler can be entered again
+ *
+ * @param[in] allow_timer
+ *            Nonzero to let the timer interrupt in as well
+ *
+ * @return The status register to restore with #__return_exception_level
+ */
+static inline uint32_t __leave_exception_level( int allow_timer )
+{
+    uint32_t sr;
+
+    asm volatile("mfc0 %0,$12" : "=r"(sr));
+    uint32_t nested = (sr & ~SR_EXL) | SR_IE;
+    if( !allow_timer ) { nested &= ~SR_IM7; }
+
+    asm volatile("mtc0 %0,$12\n\tnop" : : "r"(nested) : "memory");
+
+    return sr;
+}
+
+/**
+ * @brief Go back to exception level with interrupts disabled
+ *
+ * @param[in] sr
+ *            Value returned by #__leave_exception_level
+ */
+static inline void __return_exception_level( uint32_t sr )
+{
+    asm volatile("mtc0 %0,$12\n\tnop" : : "r"(sr) : "memory");
+}
+
+/**
+ * @brief Call the callbacks of an interrupt source, letting higher priority
+ *        interrupts in while they run
+ *
+ * @param[in] source
+ *            Interrupt source to call the callbacks of
+ */
+HOT_TEXT static void __dispatch( interrupt_source_t source )
+{
+    uint32_t allowed = preempt_mask[source];
+    uint32_t old_blocked = mi_blocked;
+    uint32_t sr;
+
+    if( !allowed )
     {
-        /* Add to beginning of linked list */
-        struct callback_link *next = *head;
-        (*head) = malloc(sizeof(struct callback_link));
+        __call_callback( source );
+        return;
+    }
 
-        if( *head )
-        {
-            (*head)->next=next;
-            (*head)->callback=callback;
-        }
+    mi_blocked |= ~allowed & MI_SOURCE_ALL;
+    __mi_update_mask();
+
+    sr = __leave_exception_level( allowed & (1 << INTERRUPT_SOURCE_TI) );
+    __call_callback( source );
+    __return_exception_level( sr );
+
+    mi_blocked = old_blocked;
+    __mi_update_mask();
+}
+
+/**
+ * @brief Run deferred work on the way out of the outermost interrupt
+ */
+HOT_TEXT static void __run_deferred( void )
+{
+    if( in_interrupt() != 1 || !defer_pending() ) { return; }
+
+    uint32_t sr = __leave_exception_level( 1 );
+    defer_poll();
+    __return_exception_level( sr );
+}
+
+/**
+ * @brief Add a callback to a list of callbacks
+ *
+ * @note If the list is already full, the callback is not registered.
+ *
+ * @param[in,out] list
+ *                List of callbacks to add to
+ * @param[in]     callback
+ *                Function to call when executing callbacks in this list
+ */
+static void __register_callback( callback_list_t * list, void (*callback)() )
+{
+    if( !callback ) { return; }
+
+    disable_interrupts();
+
+    if( list->count < MAX_CALLBACKS )
+    {
+        list->callback[list->count++] = callback;
     }
+
+    enable_interrupts();
 }
 
 /**
- * @brief Remove a callback from a linked list of callbacks
+ * @brief Remove a callback from a list of callbacks
  *
- * @param[in,out] head
- *                Pointer to the head of a linked list to remove from
+ * @param[in,out] list
+ *                List of callbacks to remove from
  * @param[in]     callback
  *                Function to search for and remove from callback list
  */
-static void __unregister_callback( struct callback_link ** head, void (*callback)() )
+static void __unregister_callback( callback_list_t * list, void (*callback)() )
 {
-    if( head )
-    {
-        /* Try to find callback this matches */
-        struct callback_link *last = 0;
-        struct callback_link *cur  = *head;
+    disable_interrupts();
 
-        while( cur )
+    for( int i = 0; i < list->count; i++ )
+    {
+        if( list->callback[i] == callback )
         {
-            if( cur->callback == callback )
+            /* A walk in progress would skip a callback if the list moved */
+            if( list->walking )
             {
-                /* We found it!  Try to remove it from the list */
-                if( last )
-                {
-                    /* This is somewhere in the linked list */
-                    last->next = cur->next;
-                }
-                else
-                {
-                    /* This is the first node */
-                    *head = cur->next;
-                }
-
-                /* Free memory */
-                free( cur );
-
-                /* Exit early */
+                list->callback[i] = 0;
+                list->removed = 1;
                 break;
             }
 
-            /* Go to next entry */
-            last = cur;
-            cur = cur->next;
+            /* Close the gap, keeping registration order */
+            list->count--;
+
+            for( ; i < list->count; i++ )
+            {
+                list->callback[i] = list->callback[i + 1];
+            }
+
+            break;
         }
     }
+
+    enable_interrupts();
 }
 
 /**
@@ -248,66 +497,36 @@ static void __unregister_callback( struct callback_link ** head, void (*callback
  * @note This function handles most of the interrupts on the system as
  *       they come through the MI.
  */
-void __MI_handler(void)
+HOT_TEXT void __MI_handler(void)
 {
-    unsigned long status = MI_regs->intr & MI_regs->mask;
-
-    if( status & MI_INTR_SP )
-    {
-        /* Clear interrupt */
-        SP_regs->status=SP_CLEAR_INTERRUPT;
+    uint32_t status = MI_regs->intr & MI_regs->mask;
 
-        __call_callback(SP_callback);
-    }
-
-    if( status & MI_INTR_SI )
+    for( int source = 0; status && source < MI_SOURCE_COUNT; source++ )
     {
-        /* Clear interrupt */
-        SI_regs->status=SI_CLEAR_INTERRUPT;
-
-        __call_callback(SI_callback);
-    }
-
-    if( status & MI_INTR_AI )
-    {
-        /* Clear interrupt */
-    	AI_regs->status=AI_CLEAR_INTERRUPT;
-
-	    __call_callback(AI_callback);
-    }
-
-    if( status & MI_INTR_VI )
-    {
-        /* Clear interrupt */
-    	VI_regs->cur_line=VI_regs->cur_line;
-
-    	__call_callback(VI_callback);
-    }
+        if( status & (1 << source) )
+        {
+            /* Clear interrupt */
+            *mi_ack[source].reg = mi_ack[source].value;
 
-    if( status & MI_INTR_PI )
-    {
-        /* Clear interrupt */
-        PI_regs->status=PI_CLEAR_INTERRUPT;
+            __dispatch(source);
 
-        __call_callback(PI_callback);
+            /* Sources of higher priority may have been handled meanwhile */
+            if( preempt_mask[source] ) { status &= MI_regs->intr; }
+        }
     }
 
-    if( status & MI_INTR_DP )
-    {
-        /* Clear interrupt */
-        MI_regs->mode=DP_CLEAR_INTERRUPT;
-
-        __call_callback(DP_callback);
-    }
+    __run_deferred();
 }
 
 /**
  * @brief Handle a timer interrupt
  */
-void __TI_handler(void)
+HOT_TEXT void __TI_handler(void)
 {
 	/* timer int cleared in int handler */
-    __call_callback(TI_callback);
+    __dispatch(INTERRUPT_SOURCE_TI);
+
+    __run_deferred();
 }
 
 /**
@@ -318,7 +537,7 @@ void __TI_handler(void)
  */
 void register_AI_handler( void (*callback)() )
 {
-    __register_callback(&AI_callback,callback);
+    __register_callback(&callbacks[INTERRUPT_SOURCE_AI],callback);
 }
 
 /**
@@ -329,7 +548,7 @@ void register_AI_handler( void (*callback)() )
  */
 void unregister_AI_handler( void (*callback)() )
 {
-    __unregister_callback(&AI_callback,callback);
+    __unregister_callback(&callbacks[INTERRUPT_SOURCE_AI],callback);
 }
 
 /**
@@ -340,7 +559,7 @@ void unregister_AI_handler( void (*callback)() )
  */
 void register_VI_handler( void (*callback)() )
 {
-    __register_callback(&VI_callback,callback);
+    __register_callback(&callbacks[INTERRUPT_SOURCE_VI],callback);
 }
 
 /**
@@ -351,7 +570,7 @@ void register_VI_handler( void (*callback)() )
  */
 void unregister_VI_handler( void (*callback)() )
 {
-    __unregister_callback(&VI_callback,callback);
+    __unregister_callback(&callbacks[INTERRUPT_SOURCE_VI],callback);
 }
 
 /**
@@ -362,7 +581,7 @@ void unregister_VI_handler( void (*callback)() )
  */
 void register_PI_handler( void (*callback)() )
 {
-    __register_callback(&PI_callback,callback);
+    __register_callback(&callbacks[INTERRUPT_SOURCE_PI],callback);
 }
 
 /**
@@ -373,7 +592,7 @@ void register_PI_handler( void (*callback)() )
  */
 void unregister_PI_handler( void (*callback)() )
 {
-    __unregister_callback(&PI_callback,callback);
+    __unregister_callback(&callbacks[INTERRUPT_SOURCE_PI],callback);
 }
 
 /**
@@ -384,7 +603,7 @@ void unregister_PI_handler( void (*callback)() )
  */
 void register_DP_handler( void (*callback)() )
 {
-    __register_callback(&DP_callback,callback);
+    __register_callback(&callbacks[INTERRUPT_SOURCE_DP],callback);
 }
 
 /**
@@ -395,7 +614,7 @@ void register_DP_handler( void (*callback)() )
  */
 void unregister_DP_handler( void (*callback)() )
 {
-    __unregister_callback(&DP_callback,callback);
+    __unregister_callback(&callbacks[INTERRUPT_SOURCE_DP],callback);
 }
 
 /**
@@ -406,7 +625,7 @@ void unregister_DP_handler( void (*callback)() )
  */
 void register_TI_handler( void (*callback)() )
 {
-    __register_callback(&TI_callback,callback);
+    __register_callback(&callbacks[INTERRUPT_SOURCE_TI],callback);
 }
 
 /**
@@ -417,7 +636,7 @@ void register_TI_handler( void (*callback)() )
  */
 void unregister_TI_handler( void (*callback)() )
 {
-    __unregister_callback(&TI_callback,callback);
+    __unregister_callback(&callbacks[INTERRUPT_SOURCE_TI],callback);
 }
 
 /**
@@ -428,7 +647,7 @@ void unregister_TI_handler( void (*callback)() )
  */
 void register_SI_handler( void (*callback)() )
 {
-    __register_callback(&SI_callback,callback);
+    __register_callback(&callbacks[INTERRUPT_SOURCE_SI],callback);
 }
 
 /**
@@ -439,7 +658,7 @@ void register_SI_handler( void (*callback)() )
  */
 void unregister_SI_handler( void (*callback)() )
 {
-    __unregister_callback(&SI_callback,callback);
+    __unregister_callback(&callbacks[INTERRUPT_SOURCE_SI],callback);
 }
 
 /**
@@ -450,7 +669,7 @@ void unregister_SI_handler( void (*callback)() )
  */
 void register_SP_handler( void (*callback)() )
 {
-    __register_callback(&SP_callback,callback);
+    __register_callback(&callbacks[INTERRUPT_SOURCE_SP],callback);
 }
 
 /**
@@ -461,7 +680,7 @@ void register_SP_handler( void (*callback)() )
  */
 void unregister_SP_handler( void (*callback)() )
 {
-    __unregister_callback(&SP_callback,callback);
+    __unregister_callback(&callbacks[INTERRUPT_SOURCE_SP],callback);
 }
 
 /**
@@ -472,14 +691,7 @@ void unregister_SP_handler( void (*callback)() )
  */
 void set_AI_interrupt(int active)
 {
-    if( active )
-    {
-        MI_regs->mask=MI_MASK_SET_AI;
-    }
-    else
-    {
-        MI_regs->mask=MI_MASK_CLR_AI;
-    }
+    __set_mi_interrupt( INTERRUPT_SOURCE_AI, active );
 }
 
 /**
@@ -495,13 +707,10 @@ void set_VI_interrupt(int active, unsigned long line)
 {
     if( active )
     {
-    	MI_regs->mask=MI_MASK_SET_VI;
 	    VI_regs->v_int=line;
     }
-    else
-    {
-        MI_regs->mask=MI_MASK_CLR_VI;
-    }
+
+    __set_mi_interrupt( INTERRUPT_SOURCE_VI, active );
 }
 
 /**
@@ -512,14 +721,7 @@ void set_VI_interrupt(int active, unsigned long line)
  */
 void set_PI_interrupt(int active)
 {
-    if ( active )
-    {
-        MI_regs->mask=MI_MASK_SET_PI;
-    }
-    else
-    {
-        MI_regs->mask=MI_MASK_CLR_PI;
-    }
+    __set_mi_interrupt( INTERRUPT_SOURCE_PI, active );
 }
 
 /**
@@ -530,14 +732,7 @@ void set_PI_interrupt(int active)
  */
 void set_DP_interrupt(int active)
 {
-    if( active )
-    {
-        MI_regs->mask=MI_MASK_SET_DP;
-    }
-    else
-    {
-        MI_regs->mask=MI_MASK_CLR_DP;
-    }
+    __set_mi_interrupt( INTERRUPT_SOURCE_DP, active );
 }
 
 /**
@@ -548,14 +743,7 @@ void set_DP_interrupt(int active)
  */
 void set_SI_interrupt(int active)
 {
-    if( active )
-    {
-        MI_regs->mask=MI_MASK_SET_SI;
-    }
-    else
-    {
-        MI_regs->mask=MI_MASK_CLR_SI;
-    }
+    __set_mi_interrupt( INTERRUPT_SOURCE_SI, active );
 }
 
 /**
@@ -566,14 +754,7 @@ void set_SI_interrupt(int active)
  */
 void set_SP_interrupt(int active)
 {
-    if( active )
-    {
-        MI_regs->mask=MI_MASK_SET_SP;
-    }
-    else
-    {
-        MI_regs->mask=MI_MASK_CLR_SP;
-    }
+    __set_mi_interrupt( INTERRUPT_SOURCE_SP, active );
 }
 
 /**
@@ -586,6 +767,8 @@ void init_interrupts()
     {
         /* Clear and mask all interrupts on the system so we start with a clean slate */
         MI_regs->mask=MI_MASK_CLR_SP|MI_MASK_CLR_SI|MI_MASK_CLR_AI|MI_MASK_CLR_VI|MI_MASK_CLR_PI|MI_MASK_CLR_DP;
+        mi_enabled = 0;
+        mi_blocked = 0;
 
         /* Set that we are enabled */
         __interrupt_depth = 0;
@@ -595,6 +778,60 @@ void init_interrupts()
     }
 }
 
+/**
+ * @brief Set the priority of an interrupt source
+ *
+ * The callbacks of a source can be interrupted by sources with a higher
+ * priority.  All sources start out with priority 0, so by default no
+ * callback is ever interrupted.  Callbacks of a source that can be
+ * interrupted must not rely on interrupts being disabled while they run,
+ * and should protect data shared with higher priority callbacks with
+ * #interrupt_disable_save or #disable_interrupts.
+ *
+ * @param[in] source
+ *            Interrupt source
+ * @param[in] prio
+ *            New priority, higher numbers preempt lower ones
+ */
+void set_interrupt_priority( interrupt_source_t source, int prio )
+{
+    if( source >= INTERRUPT_SOURCE_COUNT ) { return; }
+
+    disable_interrupts();
+
+    priority[source] = prio;
+
+    for( int i = 0; i < INTERRUPT_SOURCE_COUNT; i++ )
+    {
+        preempt_mask[i] = 0;
+
+        for( int j = 0; j < INTERRUPT_SOURCE_COUNT; j++ )
+        {
+            if( priority[j] > priority[i] ) { preempt_mask[i] |= (1 << j); }
+        }
+    }
+
+    enable_interrupts();
+}
+
+/**
+ * @brief Choose whether interrupts save the FPU registers
+ *
+ * With saving off, the FPU is saved on the first floating point
+ * instruction of a callback instead, which costs a trap on top of the
+ * save.  Turn it off if most interrupts don't use floating point, keeping
+ * in mind that timers and the audio and display code run user callbacks
+ * from interrupts too.
+ *
+ * @param[in] save
+ *            Nonzero to save the FPU on every interrupt, the default, or
+ *            zero to save it only when a callback uses it
+ */
+void set_interrupt_fpu_save( int save )
+{
+    __interrupt_fpu_save = save ? 1 : 0;
+}
+
 /**
  * @brief Disable interrupts systemwide
  *
@@ -608,8 +845,13 @@ void disable_interrupts()
 
     if( __interrupt_depth == 0 )
     {
-        /* Interrupts are enabled, so its safe to disable them */
-        asm("\tmfc0 $8,$12\n\tla $9,~1\n\tand $8,$9\n\tmtc0 $8,$12\n\tnop":::"$8","$9");
+        /* Remember whether interrupts were enabled, and disable them */
+        __interrupt_sr_ie = interrupt_disable_save() & 1;
+
+#ifdef INTERRUPT_PROFILE
+        disabled_start = timer_ticks_fast();
+        disabled_caller = __builtin_return_address(0);
+#endif
     }
 
     /* Ensure that we remember nesting levels */
@@ -621,7 +863,8 @@ void disable_interrupts()
  *
  * @note If this is called inside a nested disable call, it will have no effect on the
  *       system.  Therefore it is safe to nest disable/enable calls.  After the last
- *       nested interrupt is enabled, systemwide interrupts will be reenabled.
+ *       nested interrupt is enabled, systemwide interrupts will be reenabled, unless
+ *       they were already disabled when the outermost disable call was made.
  */
 void enable_interrupts()
 {
@@ -633,8 +876,18 @@ void enable_interrupts()
 
     if( __interrupt_depth == 0 )
     {
-        /* Interrupts are disabled but we hit the base nesting level, time to enable */
-        asm("\tmfc0 $8,$12\n\tori $8,1\n\tmtc0 $8,$12\n\tnop":::"$8");
+#ifdef INTERRUPT_PROFILE
+        uint32_t ticks = (uint32_t)(timer_ticks_fast() - disabled_start);
+
+        if( ticks > max_disabled_ticks )
+        {
+            max_disabled_ticks = ticks;
+            max_disabled_caller = disabled_caller;
+        }
+#endif
+
+        /* We hit the base nesting level, restore the state found when disabling */
+        interrupt_restore( __interrupt_sr_ie );
     }
 }
 
@@ -661,4 +914,54 @@ interrupt_state_t get_interrupts_state()
     }
 }
 
+/**
+ * @brief Read the interrupt profile
+ *
+ * @param[out] out
+ *             Structure to fill with the times recorded since startup or
+ *             the last #interrupt_profile_reset
+ *
+ * @retval 0 on success
+ * @retval -1 if libdragon was built without INTERRUPT_PROFILE
+ */
+int interrupt_profile_get( interrupt_profile_t *out )
+{
+#ifdef INTERRUPT_PROFILE
+    disable_interrupts();
+
+    for( int i = 0; i < INTERRUPT_SOURCE_COUNT; i++ )
+    {
+        out->source[i] = profile[i];
+        out->source[i].avg_ticks = profile[i].count ? profile[i].total_ticks / profile[i].count : 0;
+    }
+
+    out->max_disabled_ticks = max_disabled_ticks;
+    out->max_disabled_caller = max_disabled_caller;
+
+    enable_interrupts();
+
+    return 0;
+#else
+    memset( out, 0, sizeof(interrupt_profile_t) );
+
+    return -1;
+#endif
+}
+
+/**
+ * @brief Clear the interrupt profile
+ */
+void interrupt_profile_reset()
+{
+#ifdef INTERRUPT_PROFILE
+    disable_interrupts();
+
+    memset( profile, 0, sizeof(profile) );
+    max_disabled_ticks = 0;
+    max_disabled_caller = 0;
+
+    enable_interrupts();
+#endif
+}
+
 /** @} */
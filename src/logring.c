@@ -0,0 +1,418 @@
+/**
+ * @file logring.c
+ * @brief Log Ring
+ * @ingroup logring
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logring.h"
+
+/**
+ * @defgroup logring Log Ring
+ * @ingroup libdragon
+ * @brief Buffered logging that drains to 64drive USB in the background.
+ *
+ * Sending a string over 64drive USB with #_64Drive_putstring waits for the
+ * previous transfer to finish, and printing to the console renders text,
+ * so logging much from a game loop ruins frame timing.  The log ring
+ * instead copies log output into a ring buffer in RAM and returns right
+ * away.  The ring is drained to a sink, by default 64drive USB, from the
+ * VI and PI interrupts whenever the sink is idle.
+ *
+ * Set the ring up with #log_ring_init, then either write to it with
+ * #log_ring_write or send stdout and stderr to it with #log_ring_hook_stdio.
+ * If the ring fills up, writes are dropped rather than waited on and
+ * counted in the statistics returned by #log_ring_get_stats.  The VI
+ * interrupt is only raised once #display_init has set it up; without it,
+ * the ring drains on PI interrupts, or call #log_ring_flush to drain it
+ * completely, such as before a crash report.
+ *
+ * Writers never take a lock.  A writer reserves space by atomically moving
+ * the head of the ring, copies its data, and then marks its record as
+ * complete.  The drain sends complete records in order from the tail and
+ * stops at the first one still being written, so a writer interrupted
+ * halfway, even by another writer or the drain itself, never holds up the
+ * others.
+ *
+ * The ring only depends on the C library, and off the N64 drains to a stand
+ * in for the USB endpoint that writes to the host's stdout, so logging code
+ * can be exercised in host builds.
+ * @{
+ */
+
+#ifdef __mips__
+#include <sys/stat.h>
+#include "libdragon.h"
+#include "system.h"
+#else
+/** @brief Host builds have no interrupts to guard against */
+static inline int atomic_compare_exchange( volatile int *value, int expected, int new_value )
+{
+    int ok = (*value == expected);
+    if( ok ) { *value = new_value; }
+
+    return ok;
+}
+
+/** @brief Host builds have no interrupts to guard against */
+static inline int atomic_exchange( volatile int *value, int new_value )
+{
+    int old = *value;
+    *value = new_value;
+
+    return old;
+}
+
+/** @brief Memory barrier to keep stores in order */
+#define MEMORY_BARRIER() asm volatile ("" : : : "memory")
+#endif
+
+/** @brief Set in a record header once the record is complete */
+#define RECORD_READY    0x80000000
+/** @brief Record length marking the rest of the ring as unused */
+#define RECORD_SKIP     0xFFFF
+/** @brief Mask for the length in a record header */
+#define RECORD_LEN_MASK 0xFFFF
+/** @brief Size of a record header */
+#define RECORD_HEADER   4
+
+/** @brief Round a length up to whole words */
+#define ROUND_WORD(x)   (((x) + 3) & ~3)
+
+/** @brief Ring buffer, zero wherever no record has been written */
+static uint8_t *ring = 0;
+/** @brief Size of the ring, a power of two */
+static uint32_t ring_size = 0;
+/** @brief Position up to which space has been reserved, counting from init */
+static volatile int head = 0;
+/** @brief Position of the oldest record not yet drained */
+static volatile int tail = 0;
+/** @brief Nonzero while the ring is being drained */
+static volatile int draining = 0;
+/** @brief Where drained data goes */
+static log_sink_t sink = 0;
+/** @brief Statistics */
+static log_ring_stats_t stats;
+/** @brief Buffer records are gathered into before going to the sink */
+static uint8_t chunk[LOG_RING_CHUNK] __attribute__((aligned(8)));
+
+/**
+ * @brief Return a pointer to a position in the ring
+ */
+static inline uint8_t *__ring_at( uint32_t pos )
+{
+    return ring + (pos & (ring_size - 1));
+}
+
+#ifdef __mips__
+/**
+ * @brief Sink sending data over 64drive USB
+ */
+static int __usb_sink( const void *data, int len )
+{
+    if( !data )
+    {
+        return _64Drive_usb_status_write() == CI_STAT_USB_WR_IDLE && !dma_busy();
+    }
+
+    return _64Drive_usb_write_async( data, len );
+}
+
+/**
+ * @brief stdout and stderr hook writing to the ring
+ */
+static int __stdio_write( char *data, unsigned int len )
+{
+    log_ring_write( data, len );
+
+    /* Dropped output still counts as written, stdio must not retry it */
+    return len;
+}
+
+/** @brief Hooks passed to #hook_stdio_calls */
+static stdio_t log_stdio = { 0, __stdio_write, __stdio_write };
+#else
+/**
+ * @brief Stand in for the USB endpoint in host builds, writing to stdout
+ */
+static int __usb_sink( const void *data, int len )
+{
+    if( !data ) { return 1; }
+
+    return fwrite( data, 1, len, stdout );
+}
+#endif
+
+/**
+ * @brief Set up the log ring
+ *
+ * On the N64 this also makes the 64drive ROM area writable for USB
+ * transfers and starts draining from the VI and PI interrupts.
+ *
+ * @param[in] size
+ *            Size of the ring in bytes, rounded up to a power of two and at
+ *            least #LOG_RING_MIN_SIZE
+ *
+ * @retval 0 on success
+ * @retval -1 if the ring could not be allocated
+ */
+int log_ring_init( uint32_t size )
+{
+    uint32_t rounded = LOG_RING_MIN_SIZE;
+
+    log_ring_close();
+
+    while( rounded < size ) { rounded <<= 1; }
+
+    ring = calloc( 1, rounded );
+    if( !ring ) { return -1; }
+
+    ring_size = rounded;
+    head = 0;
+    tail = 0;
+    memset( &stats, 0, sizeof(stats) );
+
+    if( !sink ) { sink = __usb_sink; }
+
+#ifdef __mips__
+    if( sink == __usb_sink ) { _64Drive_rom_writable( 1 ); }
+
+    register_VI_handler( log_ring_drain );
+    register_PI_handler( log_ring_drain );
+    set_PI_interrupt( 1 );
+#endif
+
+    return 0;
+}
+
+/**
+ * @brief Stop draining and free the log ring
+ *
+ * Anything not drained yet is lost, call #log_ring_flush first to keep it.
+ */
+void log_ring_close( void )
+{
+    if( !ring ) { return; }
+
+#ifdef __mips__
+    unregister_VI_handler( log_ring_drain );
+    unregister_PI_handler( log_ring_drain );
+#endif
+
+    free( ring );
+    ring = 0;
+    ring_size = 0;
+}
+
+/**
+ * @brief Reserve space in the ring
+ *
+ * @param[in] len
+ *            Payload length in bytes
+ *
+ * @return Position of the record header, or -1 if the ring is full
+ */
+static int __reserve( int len )
+{
+    uint32_t need = RECORD_HEADER + ROUND_WORD( len );
+    uint32_t pos, skip;
+
+    do
+    {
+        pos = head;
+        skip = 0;
+
+        /* Records never wrap, the end of the ring is skipped instead */
+        if( (pos & (ring_size - 1)) + need > ring_size )
+        {
+            skip = ring_size - (pos & (ring_size - 1));
+        }
+
+        if( pos + skip + need - (uint32_t)tail > ring_size ) { return -1; }
+    } while( !atomic_compare_exchange( &head, pos, pos + skip + need ) );
+
+    if( skip )
+    {
+        *(uint32_t *)__ring_at( pos ) = RECORD_READY | RECORD_SKIP;
+    }
+
+    uint32_t used = pos + skip + need - (uint32_t)tail;
+    if( used > stats.high_water ) { stats.high_water = used; }
+
+    return pos + skip;
+}
+
+/**
+ * @brief Write data to the log ring
+ *
+ * This never waits.  Data that doesn't fit is dropped and counted.  May be
+ * called from interrupt handlers and any thread.
+ *
+ * @param[in] data
+ *            Data to write
+ * @param[in] len
+ *            Length of the data in bytes
+ *
+ * @return The number of bytes stored, less than len if some were dropped
+ */
+int log_ring_write( const char *data, int len )
+{
+    int written = 0;
+
+    if( !ring || !data ) { return 0; }
+
+    while( written < len )
+    {
+        int part = len - written;
+        if( part > LOG_RING_MAX_RECORD ) { part = LOG_RING_MAX_RECORD; }
+
+        int pos = __reserve( part );
+
+        if( pos < 0 )
+        {
+            stats.dropped_writes++;
+            stats.dropped_bytes += len - written;
+            break;
+        }
+
+        memcpy( __ring_at( pos ) + RECORD_HEADER, data + written, part );
+
+        /* The data must be in place before the record is marked complete */
+        MEMORY_BARRIER();
+        *(volatile uint32_t *)__ring_at( pos ) = RECORD_READY | part;
+
+        written += part;
+    }
+
+    stats.written += written;
+
+    return written;
+}
+
+/**
+ * @brief Send complete records to the sink
+ *
+ * Gathers complete records from the tail into one chunk and hands it to the
+ * sink if it is idle.  Called from the VI and PI interrupts, and may also
+ * be called directly.
+ */
+void log_ring_drain( void )
+{
+    if( !ring || !sink ) { return; }
+
+    /* Interrupts and direct calls may overlap, only one drains at a time */
+    if( atomic_exchange( &draining, 1 ) ) { return; }
+
+    if( (uint32_t)tail != (uint32_t)head && sink( 0, 0 ) )
+    {
+        uint32_t pos = tail;
+        int len = 0;
+
+        while( pos != (uint32_t)head )
+        {
+            uint32_t header = *(volatile uint32_t *)__ring_at( pos );
+            uint32_t part = header & RECORD_LEN_MASK;
+
+            /* Stop at a record that is still being written */
+            if( !(header & RECORD_READY) ) { break; }
+
+            if( part == RECORD_SKIP )
+            {
+                pos += ring_size - (pos & (ring_size - 1));
+                continue;
+            }
+
+            if( len + part > LOG_RING_CHUNK ) { break; }
+
+            memcpy( chunk + len, __ring_at( pos ) + RECORD_HEADER, part );
+            len += part;
+            pos += RECORD_HEADER + ROUND_WORD( part );
+        }
+
+        if( !len || sink( chunk, len ) == len )
+        {
+            /* Free the space, which must read as zero to the next writer */
+            for( uint32_t cur = tail; cur != pos; )
+            {
+                uint32_t part = ring_size - (cur & (ring_size - 1));
+                if( part > pos - cur ) { part = pos - cur; }
+
+                memset( __ring_at( cur ), 0, part );
+                cur += part;
+            }
+
+            MEMORY_BARRIER();
+            tail = pos;
+            stats.drained += len;
+        }
+    }
+
+    draining = 0;
+}
+
+/**
+ * @brief Drain everything in the log ring, waiting for the sink
+ *
+ * Records still being written by an interrupted writer can't be drained
+ * and are left in the ring.
+ */
+void log_ring_flush( void )
+{
+    if( !ring ) { return; }
+
+    for( ;; )
+    {
+        uint32_t before = tail;
+
+        while( sink && !sink( 0, 0 ) ) { }
+
+        log_ring_drain();
+
+        if( (uint32_t)tail == (uint32_t)head || (uint32_t)tail == before ) { break; }
+    }
+
+    /* Let the final transfer finish */
+    while( sink && !sink( 0, 0 ) ) { }
+}
+
+/**
+ * @brief Change where the log ring drains to
+ *
+ * @param[in] new_sink
+ *            Sink to use, or null for 64drive USB
+ */
+void log_ring_set_sink( log_sink_t new_sink )
+{
+    sink = new_sink ? new_sink : __usb_sink;
+}
+
+/**
+ * @brief Read the log ring statistics
+ *
+ * @param[out] out
+ *             Structure to copy the statistics into
+ */
+void log_ring_get_stats( log_ring_stats_t *out )
+{
+    *out = stats;
+}
+
+/**
+ * @brief Send stdout and stderr to the log ring
+ *
+ * @note Only available on the N64, host builds keep their stdout.
+ *
+ * @retval 0 on success
+ * @retval -1 if the hooks could not be installed
+ */
+int log_ring_hook_stdio( void )
+{
+#ifdef __mips__
+    return hook_stdio_calls( &log_stdio );
+#else
+    return -1;
+#endif
+}
+
+/** @} */
@@ -54,6 +54,29 @@ void sys_set_boot_cic(int bc)
     __bootcic = ( (bc >= 6102) && (bc <= 6106) ) ? bc : 6102;
 }
 
+/**
+ * @brief Return the amount of RDRAM detected at boot
+ *
+ * The size is read from where the boot code left it, which depends on the
+ * boot CIC.  See #sys_set_boot_cic.
+ *
+ * @return Size of RDRAM in bytes, 4 MiB or 8 MiB with an Expansion Pak
+ */
+int get_memory_size()
+{
+    return (__bootcic != 6105) ? (*(int*)0xA0000318) : (*(int*)0xA00003F0);
+}
+
+/**
+ * @brief Return whether an Expansion Pak is installed
+ *
+ * @return Nonzero if more than 4 MiB of RDRAM was detected
+ */
+int is_memory_expanded()
+{
+    return get_memory_size() > 0x400000;
+}
+
 /**
  * @brief Read the number of ticks since system startup
  *
@@ -0,0 +1,293 @@
+/**
+ * @file profile.c
+ * @brief Sampling Profiler
+ * @ingroup profile
+ */
+#include <malloc.h>
+#include <string.h>
+#include "libdragon.h"
+
+/**
+ * @defgroup profile Sampling Profiler
+ * @ingroup libdragon
+ * @brief Statistical CPU profiler driven by the timer interrupt.
+ *
+ * The profiler finds out where the CPU spends its time without changing
+ * the code being measured.  A continuous timer interrupts the program at a
+ * fixed rate, and each time the address of the interrupted instruction,
+ * as saved by the interrupt handler, is counted in a histogram.  Functions
+ * that run often or for long collect proportionally more samples.
+ *
+ * Along with the program counter, each sample keeps the return address
+ * register.  In a leaf function, or in any function before its first call,
+ * that is the address the function was called from, so the host tool can
+ * attribute samples one level up the call chain.  When the return address
+ * points back into the sampled function itself it carries no extra
+ * information and the tool ignores it.
+ *
+ * The timer subsystem must be initialized with #timer_init before calling
+ * #profile_init.  Start and stop sampling with #profile_start and
+ * #profile_stop, then write the histogram out with #profile_dump or
+ * #profile_dump_usb.  The n64prof tool reads a dump together with the ELF
+ * file of the program and prints a flat profile, or folded stacks for
+ * flamegraph.pl and speedscope.  The n64order tool turns the same dump into
+ * n64order.ld, which the linker scripts use to put the hottest functions
+ * next to each other at the start of the text section.
+ *
+ * Higher rates give more detail in shorter runs but each sample costs a
+ * full interrupt, so rates much over a few kHz noticeably slow the program
+ * down.
+ * @{
+ */
+
+/** @brief Slots looked at before a sample is dropped */
+#define MAX_PROBE       16
+
+/** @brief Largest piece of a dump sent over USB at once */
+#define USB_CHUNK       (64 * 1024)
+
+/** @brief Registers saved by the innermost interrupt being handled */
+extern reg_block_t * volatile __interrupt_regs;
+
+/** @brief Histogram, a slot is free while its count is zero */
+static profile_slot_t *slots = 0;
+/** @brief Number of histogram slots, a power of two */
+static uint32_t num_slots = 0;
+/** @brief Number of histogram slots in use */
+static uint32_t used_slots = 0;
+/** @brief Sampling rate */
+static int sample_hz = 0;
+/** @brief Timer taking the samples while profiling */
+static timer_link_t *sample_timer = 0;
+/** @brief Total number of samples */
+static uint32_t samples = 0;
+/** @brief Samples lost to a full histogram */
+static uint32_t dropped = 0;
+
+/**
+ * @brief Timer callback counting the interrupted instruction
+ */
+static void __profile_sample( int ovfl )
+{
+    /* Creating another timer runs the callbacks outside of the interrupt,
+       when there is no interrupted instruction to count */
+    if( !in_interrupt() ) { return; }
+
+    uint32_t pc = __interrupt_regs->epc;
+    uint32_t ra = (uint32_t)__interrupt_regs->gpr[31];
+    uint32_t hash = ((pc >> 2) ^ (ra >> 2) * 0x9E3779B1) * 0x9E3779B1;
+
+    samples++;
+
+    for( int i = 0; i < MAX_PROBE; i++ )
+    {
+        profile_slot_t *slot = &slots[(hash + i) & (num_slots - 1)];
+
+        if( !slot->count )
+        {
+            slot->pc = pc;
+            slot->ra = ra;
+            slot->count = 1;
+            used_slots++;
+            return;
+        }
+
+        if( slot->pc == pc && slot->ra == ra )
+        {
+            slot->count++;
+            return;
+        }
+    }
+
+    dropped++;
+}
+
+/**
+ * @brief Set up the profiler
+ *
+ * @param[in] hz
+ *            Samples to take per second, or 0 for #PROFILE_DEFAULT_HZ
+ * @param[in] count
+ *            Number of histogram slots, rounded up to a power of two, or 0
+ *            for #PROFILE_DEFAULT_SLOTS
+ *
+ * @retval 0 on success
+ * @retval -1 if the histogram could not be allocated
+ */
+int profile_init( int hz, int count )
+{
+    uint32_t rounded = 1;
+
+    profile_close();
+
+    if( hz <= 0 ) { hz = PROFILE_DEFAULT_HZ; }
+    if( count <= 0 ) { count = PROFILE_DEFAULT_SLOTS; }
+    while( rounded < count ) { rounded <<= 1; }
+
+    slots = calloc( rounded, sizeof(profile_slot_t) );
+    if( !slots ) { return -1; }
+
+    num_slots = rounded;
+    sample_hz = hz;
+    profile_reset();
+
+    return 0;
+}
+
+/**
+ * @brief Stop sampling and free the histogram
+ */
+void profile_close( void )
+{
+    profile_stop();
+
+    if( slots )
+    {
+        free( slots );
+        slots = 0;
+        num_slots = 0;
+    }
+}
+
+/**
+ * @brief Start taking samples
+ */
+void profile_start( void )
+{
+    if( !slots || sample_timer ) { return; }
+
+    sample_timer = new_timer( TIMER_TICKS( 1000000 / sample_hz ), TF_CONTINUOUS, __profile_sample );
+}
+
+/**
+ * @brief Stop taking samples, keeping the ones taken so far
+ */
+void profile_stop( void )
+{
+    if( !sample_timer ) { return; }
+
+    delete_timer( sample_timer );
+    sample_timer = 0;
+}
+
+/**
+ * @brief Forget all samples
+ */
+void profile_reset( void )
+{
+    uint32_t state = interrupt_disable_save();
+
+    if( slots ) { memset( slots, 0, num_slots * sizeof(profile_slot_t) ); }
+
+    used_slots = 0;
+    samples = 0;
+    dropped = 0;
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Return the size in bytes of a dump of the current histogram
+ */
+int profile_dump_size( void )
+{
+    return sizeof(profile_header_t) + used_slots * sizeof(profile_slot_t);
+}
+
+/**
+ * @brief Write the histogram into a buffer
+ *
+ * Only the slots in use are written.  Sampling is held off while the
+ * histogram is copied.
+ *
+ * @param[out] buf
+ *             Buffer to write the dump to, 4 byte aligned
+ * @param[in]  size
+ *             Size of the buffer in bytes
+ *
+ * @return The number of bytes written, or -1 if the buffer is too small
+ */
+int profile_dump( void *buf, int size )
+{
+    profile_header_t *header = buf;
+    profile_slot_t *out = (profile_slot_t *)(header + 1);
+
+    if( !slots ) { return -1; }
+
+    uint32_t state = interrupt_disable_save();
+
+    if( size < profile_dump_size() )
+    {
+        interrupt_restore( state );
+        return -1;
+    }
+
+    header->magic = PROFILE_MAGIC;
+    header->version = PROFILE_VERSION;
+    header->slot_size = sizeof(profile_slot_t);
+    header->hz = sample_hz;
+    header->num_slots = used_slots;
+    header->samples = samples;
+    header->dropped = dropped;
+
+    for( uint32_t i = 0; i < num_slots; i++ )
+    {
+        if( slots[i].count ) { *out++ = slots[i]; }
+    }
+
+    interrupt_restore( state );
+
+    return (uint8_t *)out - (uint8_t *)buf;
+}
+
+/**
+ * @brief Send the histogram over 64drive USB
+ *
+ * The dump has the same format as #profile_dump and is sent as binary data.
+ * Sampling is paused until the dump has been sent.
+ *
+ * @retval 0 on success
+ * @retval -1 if there is nothing to send or no memory for the dump
+ */
+int profile_dump_usb( void )
+{
+    int was_sampling = (sample_timer != 0);
+
+    /* The histogram must not grow between sizing and writing the dump */
+    profile_stop();
+
+    int size = profile_dump_size();
+    uint8_t *buf = memalign( 8, size );
+
+    if( buf ) { size = profile_dump( buf, size ); }
+
+    if( !buf || size < 0 )
+    {
+        free( buf );
+        if( was_sampling ) { profile_start(); }
+        return -1;
+    }
+
+    _64Drive_rom_writable( 1 );
+
+    for( int sent = 0; sent < size; )
+    {
+        int part = size - sent;
+        if( part > USB_CHUNK ) { part = USB_CHUNK; }
+
+        /* Nonzero once the transfer could be started */
+        while( !_64Drive_usb_write_data( buf + sent, part, USB_DATATYPE_BINARY ) ) { }
+
+        sent += part;
+    }
+
+    /* Don't return while the host is still receiving */
+    _64Drive_usb_spin_write();
+    free( buf );
+
+    if( was_sampling ) { profile_start(); }
+
+    return 0;
+}
+
+/** @} */
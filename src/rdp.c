@@ -123,6 +123,8 @@ static sprite_cache cache[8];
  */
 static void __rdp_interrupt()
 {
+    trace_instant( TRACE_ID_RDP_SYNC, 0 );
+
     /* Flag that the interrupt happened */
     wait_intr++;
 }
@@ -256,13 +258,16 @@ void rdp_execute_display_list( display_list_t *list, int size, display_list_loca
 {
     uint32_t length_in_uint64s = 0;
 
-    while(list[length_in_uint64s].command != 0xFFFFFFFFFFFFFFFF)
+    /* Look for the sentinel added by rdp_end_display_list */
+    while(length_in_uint64s < (uint32_t)size && list[length_in_uint64s].command != 0x7FFFFFFFFFFFFFFF)
     {
         length_in_uint64s++;
     }
 
     data_cache_hit_writeback_invalidate(list, size * sizeof(display_list_t));
 
+    trace_instant( TRACE_ID_RDP_SUBMIT, length_in_uint64s );
+
     /* Make sure another thread doesn't attempt to render */
     disable_interrupts();
 
@@ -474,19 +479,15 @@ void rdp_set_other_modes( display_list_t **list, uint64_t mode_bits )
     ADVANCE_DISPLAY_LIST_PTR;
     */
 
-   MMIO32(((uint32_t)list[0]) + 0) = 0xAF0000FF | (mode_bits >> 32);
-   MMIO32(((uint32_t)list[0]) + 4) = (mode_bits & 0x00000000FFFFFFFF);
-   ADVANCE_DISPLAY_LIST_PTR;
+    /* One store; dithering is always turned off here */
+    rdp_command( list, RDP_SET_OTHER_MODES( mode_bits | 0xFF00000000ULL ) );
 }
 
 void rdp_set_combine_mode( display_list_t **list, uint64_t combine_mode )
 {
     // Color formula: (A - B) * C + D
 
-    list[0]->words.hi = ( 0xBC000000 | (combine_mode >> 32) );
-    MMIO32(((uint32_t)list[0]) + 4) = (combine_mode & 0x00000000FFFFFFFF);
-
-    ADVANCE_DISPLAY_LIST_PTR; 
+    rdp_command( list, RDP_SET_COMBINE( combine_mode ) );
 }
 
 /**
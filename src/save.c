@@ -0,0 +1,1288 @@
+/**
+ * @file save.c
+ * @brief Save Store
+ * @ingroup save
+ */
+#include <string.h>
+#include "libdragon.h"
+
+/**
+ * @defgroup save Save Store
+ * @ingroup lowlevel
+ * @brief Crash safe key-value storage on cartridge save memory.
+ *
+ * The save store keeps small records, each identified by a 16 bit key, on
+ * EEPROM, SRAM or FlashRAM.  Instead of rewriting a save image in place,
+ * which loses the save if power is cut halfway through, every write is
+ * appended to a log.  A record only counts once all of it, including a
+ * checksum, is on the medium, so a write either happens completely or not
+ * at all, and the previous value of the key stays readable until then.
+ *
+ * The medium is split into segments which the log goes through in a ring.
+ * Before the log moves into a segment, the records still in use in the
+ * segment after it are copied forward, so there is always a free segment to
+ * move into next.  Going around the ring spreads writes evenly over the
+ * medium, which matters for FlashRAM and EEPROM since they wear out.  A
+ * segment is erased, or on media that can be overwritten reused, only once
+ * per trip around the ring.  Two segments are kept for this, so the store
+ * holds at most the size of the medium less two segments, minus a header
+ * of 8 bytes per record and 12 per segment, and records are padded to the
+ * write unit of the medium.
+ *
+ * Media are described by a #save_media_t.  #save_media_eeprom,
+ * #save_media_sram and #save_media_flashram set one up for cartridge save
+ * memory.  #save_media_ram uses a buffer in memory, behaving like either
+ * kind of medium, and #save_media_ram_cut makes it stop writing partway
+ * through, to test recovering from power loss or to measure the store.
+ *
+ * Call #save_format once to set up a new store, and #save_mount at startup
+ * to find the records of an existing one.  Only one store can be mounted at
+ * a time, and access to it is not thread safe.
+ * @{
+ */
+
+/** @brief Magic number at the start of each segment, "SAV1" */
+#define SEGMENT_MAGIC       0x53415631
+/** @brief Size of the header of a record */
+#define HEADER_SIZE         8
+/** @brief Record length marking a deleted key */
+#define TOMBSTONE           0xFFFF
+/** @brief Most segments a medium can be split into */
+#define MAX_SEGMENTS        32
+
+/** @brief Milliseconds an EEPROM block takes to write */
+#define EEPROM_WRITE_MS     15
+
+/** @brief PI address of SRAM and FlashRAM */
+#define PI_DOM2_ADDR        0x08000000
+/** @brief PI domain 2 timing registers */
+#define PI_BSD_DOM2_LAT     ((volatile uint32_t *)0xA4600024)
+/** @copydoc PI_BSD_DOM2_LAT */
+#define PI_BSD_DOM2_PWD     ((volatile uint32_t *)0xA4600028)
+/** @copydoc PI_BSD_DOM2_LAT */
+#define PI_BSD_DOM2_PGS     ((volatile uint32_t *)0xA460002C)
+/** @copydoc PI_BSD_DOM2_LAT */
+#define PI_BSD_DOM2_RLS     ((volatile uint32_t *)0xA4600030)
+
+/** @brief Size of SRAM on cartridges that have it */
+#define SRAM_SIZE           32768
+
+/** @brief Size of FlashRAM */
+#define FLASH_SIZE          131072
+/** @brief FlashRAM page, the unit of writing */
+#define FLASH_PAGE          128
+/** @brief FlashRAM sector, the unit of erasing */
+#define FLASH_SECTOR        16384
+/** @brief PI address of the FlashRAM command register */
+#define FLASH_CMD_ADDR      (PI_DOM2_ADDR + 0x10000)
+/** @brief Milliseconds to wait for a FlashRAM operation to finish */
+#define FLASH_TIMEOUT_MS    3000
+
+/**
+ * @name FlashRAM commands
+ * @{
+ */
+#define FLASH_CMD_ERASE_SECTOR  0x4B000000
+#define FLASH_CMD_ERASE_EXECUTE 0x78000000
+#define FLASH_CMD_PROGRAM       0xA5000000
+#define FLASH_CMD_LOAD          0xB4000000
+#define FLASH_CMD_STATUS        0xD2000000
+#define FLASH_CMD_READ          0xF0000000
+/** @} */
+
+/** @brief FlashRAM status bit set while an operation is running */
+#define FLASH_STATUS_BUSY   0x01
+
+/**
+ * @brief Header at the start of each segment
+ */
+typedef struct
+{
+    /** @brief #SEGMENT_MAGIC */
+    uint32_t magic;
+    /** @brief Sequence number, increasing each time a segment is used */
+    uint32_t seq;
+    /** @brief Inverted sequence number, to reject a header cut short */
+    uint32_t check;
+} segment_header_t;
+
+/**
+ * @brief Header of each record
+ */
+typedef struct
+{
+    /** @brief Key of the record */
+    uint16_t key;
+    /** @brief Length of the data following the header, or #TOMBSTONE */
+    uint16_t len;
+    /** @brief CRC-32 of the segment sequence number, key, length and data */
+    uint32_t crc;
+} record_header_t;
+
+/**
+ * @brief Where the current record of a key is
+ */
+typedef struct
+{
+    /** @brief Key */
+    uint16_t key;
+    /** @brief Length of the data */
+    uint16_t len;
+    /** @brief Offset of the record header on the medium */
+    uint32_t offset;
+} index_entry_t;
+
+/**
+ * @brief State of a record being written
+ */
+typedef struct
+{
+    /** @brief Offset of the next write unit */
+    uint32_t pos;
+    /** @brief Bytes waiting in #unit_buf */
+    uint32_t fill;
+    /** @brief Nonzero if a write failed */
+    int error;
+} writer_t;
+
+/** @brief Mounted medium, or NULL */
+static save_media_t *media = NULL;
+/** @brief Number of segments on the medium */
+static int num_segments;
+/** @brief Space taken by a segment header, rounded up to the write unit */
+static uint32_t segment_header_size;
+/** @brief Segment the log is being written to */
+static int head;
+/** @brief Sequence number of the head segment */
+static uint32_t head_seq;
+/** @brief Offset the next record is written at */
+static uint32_t tail;
+/** @brief Current record of each key */
+static index_entry_t keys[SAVE_MAX_KEYS];
+/** @brief Number of keys */
+static int num_keys;
+/** @brief Statistics */
+static save_stats_t stats;
+/** @brief Nonzero if writing has to wait for the store to be mounted again */
+static int write_failed;
+/** @brief Write unit being assembled */
+static uint8_t unit_buf[SAVE_MAX_UNIT] __attribute__((aligned(8)));
+/** @brief Bounce buffer for PI DMA */
+static uint8_t pi_buf[SAVE_MAX_UNIT] __attribute__((aligned(8)));
+/** @brief Bytes a RAM medium writes before power is cut */
+static uint32_t ram_budget = SAVE_NO_CUT;
+
+/** @brief Nibble table for CRC-32 */
+static const uint32_t crc_table[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+/**
+ * @brief Add bytes to a running CRC-32
+ *
+ * @param[in] crc
+ *            CRC so far, start with 0xFFFFFFFF
+ * @param[in] data
+ *            Bytes to add
+ * @param[in] len
+ *            Number of bytes
+ *
+ * @return The updated CRC
+ */
+static uint32_t __crc32( uint32_t crc, const void *data, uint32_t len )
+{
+    const uint8_t *p = data;
+
+    while( len-- )
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc_table[crc & 15];
+        crc = (crc >> 4) ^ crc_table[crc & 15];
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Add bytes on the medium to a running CRC-32
+ *
+ * @param[in]  crc
+ *             CRC so far
+ * @param[in]  offset
+ *             Offset of the bytes on the medium
+ * @param[in]  len
+ *             Number of bytes
+ * @param[out] error
+ *             Set to nonzero if the medium could not be read
+ *
+ * @return The updated CRC
+ */
+static uint32_t __crc32_media( uint32_t crc, uint32_t offset, uint32_t len, int *error )
+{
+    uint8_t buf[64];
+
+    while( len )
+    {
+        uint32_t n = len < sizeof(buf) ? len : sizeof(buf);
+
+        if( media->read( media, offset, buf, n ) < 0 ) { *error = 1; }
+
+        crc = __crc32( crc, buf, n );
+        offset += n;
+        len -= n;
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Start the CRC of a record
+ *
+ * Covering the segment's sequence number means records left over from an
+ * earlier trip around the ring never check out.
+ *
+ * @param[in] seq
+ *            Sequence number of the segment holding the record
+ * @param[in] key
+ *            Key of the record
+ * @param[in] len
+ *            Length field of the record
+ *
+ * @return The CRC so far
+ */
+static uint32_t __crc32_record( uint32_t seq, uint16_t key, uint16_t len )
+{
+    uint32_t crc = __crc32( 0xFFFFFFFF, &seq, sizeof(seq) );
+
+    crc = __crc32( crc, &key, sizeof(key) );
+    return __crc32( crc, &len, sizeof(len) );
+}
+
+/**
+ * @brief Round a size up to the write unit of the medium
+ */
+static inline uint32_t __round_up( uint32_t size )
+{
+    return (size + media->write_unit - 1) & ~(media->write_unit - 1);
+}
+
+/**
+ * @brief Return the space a record takes on the medium
+ *
+ * @param[in] len
+ *            Length field of the record
+ */
+static inline uint32_t __record_size( uint16_t len )
+{
+    return __round_up( HEADER_SIZE + (len == TOMBSTONE ? 0 : len) );
+}
+
+/**
+ * @brief Return the offset of a segment
+ */
+static inline uint32_t __segment_start( int segment )
+{
+    return segment * media->segment_size;
+}
+
+/**
+ * @brief Return the space for records in a segment
+ */
+static inline uint32_t __segment_payload( void )
+{
+    return media->segment_size - segment_header_size;
+}
+
+/**
+ * @brief Return the most live data the store can hold
+ */
+static inline uint32_t __capacity( void )
+{
+    return (num_segments - 2) * __segment_payload();
+}
+
+/**
+ * @brief Find the index entry of a key
+ *
+ * @return The index in #keys, or -1 if the key is not stored
+ */
+static int __find_key( uint16_t key )
+{
+    for( int i = 0; i < num_keys; i++ )
+    {
+        if( keys[i].key == key ) { return i; }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Point a key at a new record, or remove it for a tombstone
+ *
+ * @return #SAVE_ESUCCESS or #SAVE_ENOSPC if there are too many keys
+ */
+static int __set_key( uint16_t key, uint16_t len, uint32_t offset )
+{
+    int i = __find_key( key );
+
+    if( len == TOMBSTONE )
+    {
+        if( i >= 0 ) { keys[i] = keys[--num_keys]; }
+        return SAVE_ESUCCESS;
+    }
+
+    if( i < 0 )
+    {
+        if( num_keys == SAVE_MAX_KEYS ) { return SAVE_ENOSPC; }
+        i = num_keys++;
+    }
+
+    keys[i].key = key;
+    keys[i].len = len;
+    keys[i].offset = offset;
+
+    return SAVE_ESUCCESS;
+}
+
+/**
+ * @brief Return the space taken by live records
+ */
+static uint32_t __live_bytes( void )
+{
+    uint32_t total = 0;
+
+    for( int i = 0; i < num_keys; i++ )
+    {
+        total += __record_size( keys[i].len );
+    }
+
+    return total;
+}
+
+/**
+ * @brief Return whether a segment holds any live record
+ */
+static int __segment_live( int segment )
+{
+    for( int i = 0; i < num_keys; i++ )
+    {
+        if( keys[i].offset / media->segment_size == segment ) { return 1; }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Write out the write unit being assembled
+ */
+static void __flush( writer_t *w )
+{
+    if( !w->fill || w->error ) { return; }
+
+    memset( unit_buf + w->fill, 0, media->write_unit - w->fill );
+
+    if( media->write( media, w->pos, unit_buf, media->write_unit ) < 0 ) { w->error = 1; }
+
+    stats.bytes_written += media->write_unit;
+    w->pos += media->write_unit;
+    w->fill = 0;
+}
+
+/**
+ * @brief Add bytes to a record being written
+ */
+static void __put( writer_t *w, const void *data, uint32_t len )
+{
+    const uint8_t *p = data;
+
+    while( len && !w->error )
+    {
+        uint32_t n = media->write_unit - w->fill;
+
+        if( n > len ) { n = len; }
+
+        memcpy( unit_buf + w->fill, p, n );
+        w->fill += n;
+        p += n;
+        len -= n;
+
+        if( w->fill == media->write_unit ) { __flush( w ); }
+    }
+}
+
+/**
+ * @brief Add bytes from elsewhere on the medium to a record being written
+ */
+static void __put_media( writer_t *w, uint32_t offset, uint32_t len )
+{
+    uint8_t buf[64];
+
+    while( len && !w->error )
+    {
+        uint32_t n = len < sizeof(buf) ? len : sizeof(buf);
+
+        if( media->read( media, offset, buf, n ) < 0 ) { w->error = 1; }
+
+        __put( w, buf, n );
+        offset += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Append a record to the head segment
+ *
+ * @param[in] key
+ *            Key of the record
+ * @param[in] len
+ *            Length of the data, or #TOMBSTONE
+ * @param[in] data
+ *            Data of the record, or NULL to copy it from the medium
+ * @param[in] src
+ *            Offset of the data on the medium if data is NULL
+ *
+ * @return #SAVE_ESUCCESS, #SAVE_ENOSPC if it does not fit or #SAVE_EIO
+ */
+static int __append( uint16_t key, uint16_t len, const void *data, uint32_t src )
+{
+    uint32_t size = __record_size( len );
+    uint32_t data_len = (len == TOMBSTONE) ? 0 : len;
+    int error = 0;
+
+    if( tail + size > __segment_start( head ) + media->segment_size ) { return SAVE_ENOSPC; }
+
+    uint32_t crc = __crc32_record( head_seq, key, len );
+    crc = data ? __crc32( crc, data, data_len ) : __crc32_media( crc, src, data_len, &error );
+
+    if( error ) { return SAVE_EIO; }
+
+    record_header_t header = { key, len, ~crc };
+    writer_t w = { tail, 0, 0 };
+
+    __put( &w, &header, sizeof(header) );
+
+    if( data ) { __put( &w, data, data_len ); }
+    else { __put_media( &w, src, data_len ); }
+
+    __flush( &w );
+
+    /* Whatever made it to the medium is skipped even if the write failed */
+    uint32_t offset = tail;
+    tail += size;
+
+    if( w.error ) { return SAVE_EIO; }
+
+    return __set_key( key, len, offset );
+}
+
+/**
+ * @brief Copy the live records of a segment to the head
+ *
+ * @param[in] segment
+ *            Segment to copy from
+ * @param[in] partial
+ *            Nonzero to copy only the records that fit
+ *
+ * @return #SAVE_ESUCCESS or a negative error code
+ */
+static int __relocate( int segment, int partial )
+{
+    uint32_t end = __segment_start( head ) + media->segment_size;
+
+    for( int i = 0; i < num_keys; i++ )
+    {
+        if( keys[i].offset / media->segment_size != segment ) { continue; }
+        if( partial && tail + __record_size( keys[i].len ) > end ) { continue; }
+
+        int ret = __append( keys[i].key, keys[i].len, NULL, keys[i].offset + HEADER_SIZE );
+
+        if( ret != SAVE_ESUCCESS ) { return ret; }
+
+        stats.relocations++;
+    }
+
+    return SAVE_ESUCCESS;
+}
+
+/**
+ * @brief Erase or reuse a segment and write its header
+ *
+ * @return #SAVE_ESUCCESS or #SAVE_EIO
+ */
+static int __open_segment( int segment, uint32_t seq )
+{
+    segment_header_t header = { SEGMENT_MAGIC, seq, ~seq };
+
+    if( media->erase && media->erase( media, __segment_start( segment ) ) < 0 ) { return SAVE_EIO; }
+
+    memset( unit_buf, 0xFF, segment_header_size );
+    memcpy( unit_buf, &header, sizeof(header) );
+
+    stats.segments_used++;
+    stats.bytes_written += segment_header_size;
+
+    if( media->write( media, __segment_start( segment ), unit_buf, segment_header_size ) < 0 ) { return SAVE_EIO; }
+
+    return SAVE_ESUCCESS;
+}
+
+/**
+ * @brief Make a segment stop checking out
+ *
+ * @return #SAVE_ESUCCESS or #SAVE_EIO
+ */
+static int __invalidate( int segment )
+{
+    if( media->erase )
+    {
+        if( media->erase( media, __segment_start( segment ) ) < 0 ) { return SAVE_EIO; }
+    }
+    else
+    {
+        memset( unit_buf, 0, media->write_unit );
+
+        if( media->write( media, __segment_start( segment ), unit_buf, media->write_unit ) < 0 ) { return SAVE_EIO; }
+    }
+
+    return SAVE_ESUCCESS;
+}
+
+/**
+ * @brief Move the log into the next segment
+ *
+ * @return #SAVE_ESUCCESS or a negative error code
+ */
+static int __advance( void )
+{
+    int next = (head + 1) % num_segments;
+
+    /* Only possible if a relocation was cut short */
+    if( __segment_live( next ) ) { return SAVE_ENOSPC; }
+
+    if( __open_segment( next, head_seq + 1 ) != SAVE_ESUCCESS ) { return SAVE_EIO; }
+
+    head = next;
+    head_seq++;
+    tail = __segment_start( head ) + segment_header_size;
+
+    /* Keep the segment after the head free for the next time.  Its live
+       records are at most a segment's worth, so they fit the new head. */
+    int ret = __relocate( (head + 1) % num_segments, 0 );
+
+    /* Mounting drops a head that is missing some of these, so writing
+       anything else there would be lost */
+    if( ret != SAVE_ESUCCESS ) { write_failed = 1; }
+
+    return ret;
+}
+
+/**
+ * @brief Return whether a write unit is still erased
+ */
+static int __unit_blank( uint32_t offset )
+{
+    uint8_t buf[SAVE_MAX_UNIT];
+
+    if( media->read( media, offset, buf, media->write_unit ) < 0 ) { return 0; }
+
+    for( int i = 0; i < media->write_unit; i++ )
+    {
+        if( buf[i] != 0xFF ) { return 0; }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Read the records of a segment into the index
+ *
+ * @param[in] segment
+ *            Segment to read
+ * @param[in] seq
+ *            Sequence number of the segment
+ *
+ * @return Offset after the last record, where writing can resume
+ */
+static uint32_t __replay( int segment, uint32_t seq )
+{
+    uint32_t pos = __segment_start( segment ) + segment_header_size;
+    uint32_t end = __segment_start( segment ) + media->segment_size;
+    uint32_t tail = pos;
+
+    while( pos + HEADER_SIZE <= end )
+    {
+        record_header_t header;
+        int error = 0;
+
+        if( media->read( media, pos, &header, sizeof(header) ) < 0 ) { break; }
+
+        uint32_t size = __record_size( header.len );
+        uint32_t data_len = (header.len == TOMBSTONE) ? 0 : header.len;
+
+        if( header.key != SAVE_KEY_INVALID && pos + size <= end )
+        {
+            uint32_t crc = __crc32_record( seq, header.key, header.len );
+            crc = __crc32_media( crc, pos + HEADER_SIZE, data_len, &error );
+
+            if( !error && ~crc == header.crc )
+            {
+                __set_key( header.key, header.len, pos );
+                pos += size;
+                tail = pos;
+                continue;
+            }
+        }
+
+        /* A record cut short, one from an earlier trip around the ring, or
+           the end of the log.  Media that can be overwritten carry on
+           writing from here. */
+        if( !media->erase ) { break; }
+
+        /* Flash cannot be written twice without erasing, so writing carried
+           on after the remains of a cut off write.  Look for records there. */
+        if( !__unit_blank( pos ) ) { tail = pos + media->write_unit; }
+
+        pos += media->write_unit;
+    }
+
+    return tail;
+}
+
+/**
+ * @brief Check a medium and set up the state for it
+ *
+ * @return #SAVE_ESUCCESS or #SAVE_EBADINPUT
+ */
+static int __use_media( save_media_t *m )
+{
+    media = NULL;
+
+    if( !m || !m->read || !m->write || !m->segment_size ) { return SAVE_EBADINPUT; }
+
+    int unit = m->write_unit;
+
+    if( unit < HEADER_SIZE || unit > SAVE_MAX_UNIT || (unit & (unit - 1)) ||
+        m->segment_size % unit || m->size / m->segment_size < 3 || m->size / m->segment_size > MAX_SEGMENTS )
+    {
+        return SAVE_EBADINPUT;
+    }
+
+    media = m;
+    num_segments = m->size / m->segment_size;
+    segment_header_size = __round_up( sizeof(segment_header_t) );
+    num_keys = 0;
+    write_failed = 0;
+    memset( &stats, 0, sizeof(stats) );
+
+    return SAVE_ESUCCESS;
+}
+
+/**
+ * @brief Set up a new, empty store
+ *
+ * Anything on the medium is lost.  The store is mounted afterwards.
+ *
+ * @param[in] m
+ *            Medium to format
+ *
+ * @return #SAVE_ESUCCESS or a negative error code
+ */
+int save_format( save_media_t *m )
+{
+    if( __use_media( m ) != SAVE_ESUCCESS ) { return SAVE_EBADINPUT; }
+
+    /* Make sure no segment from before checks out */
+    for( int i = 1; i < num_segments; i++ )
+    {
+        if( __invalidate( i ) != SAVE_ESUCCESS ) { media = NULL; return SAVE_EIO; }
+    }
+
+    if( __open_segment( 0, 1 ) != SAVE_ESUCCESS ) { media = NULL; return SAVE_EIO; }
+
+    head = 0;
+    head_seq = 1;
+    tail = segment_header_size;
+
+    return SAVE_ESUCCESS;
+}
+
+/**
+ * @brief Mount the store on a medium
+ *
+ * Reads the whole log to find the current record of each key.  If power
+ * was cut during a write, the key keeps its previous value.
+ *
+ * @param[in] m
+ *            Medium holding the store
+ *
+ * @return #SAVE_ESUCCESS, #SAVE_ENOFS if there is no store on the medium or
+ *         another negative error code
+ */
+int save_mount( save_media_t *m )
+{
+    uint32_t seqs[MAX_SEGMENTS];
+    uint32_t last = 0;
+
+    if( __use_media( m ) != SAVE_ESUCCESS ) { return SAVE_EBADINPUT; }
+
+    for( int i = 0; i < num_segments; i++ )
+    {
+        segment_header_t header;
+
+        seqs[i] = 0;
+
+        if( media->read( media, __segment_start( i ), &header, sizeof(header) ) < 0 ) { media = NULL; return SAVE_EIO; }
+
+        if( header.magic == SEGMENT_MAGIC && header.seq && header.check == ~header.seq ) { seqs[i] = header.seq; }
+    }
+
+    head = -1;
+
+    /* Replay segments from oldest to newest, so later records win */
+    while( 1 )
+    {
+        int next = -1;
+
+        for( int i = 0; i < num_segments; i++ )
+        {
+            if( seqs[i] > last && (next < 0 || seqs[i] < seqs[next]) ) { next = i; }
+        }
+
+        if( next < 0 ) { break; }
+
+        head = next;
+        head_seq = last = seqs[next];
+        tail = __replay( next, head_seq );
+    }
+
+    if( head < 0 ) { media = NULL; return SAVE_ENOFS; }
+
+    /* Power was cut while the records of the segment after the head were
+       being copied into it.  The head holds nothing but those copies, so
+       drop it and let the next write start over, in case what was cut off
+       takes up the space needed to finish. */
+    if( __segment_live( (head + 1) % num_segments ) )
+    {
+        if( __invalidate( head ) != SAVE_ESUCCESS ) { media = NULL; return SAVE_EIO; }
+
+        return save_mount( m );
+    }
+
+    return SAVE_ESUCCESS;
+}
+
+/**
+ * @brief Stop using the mounted store
+ */
+void save_unmount( void )
+{
+    media = NULL;
+}
+
+/**
+ * @brief Read the record of a key
+ *
+ * @param[in]  key
+ *             Key to read
+ * @param[out] buf
+ *             Buffer for the data, or NULL to only get the length
+ * @param[in]  size
+ *             Size of the buffer, longer records are cut short
+ *
+ * @return The length of the record, or a negative error code
+ */
+int save_read( uint16_t key, void *buf, int size )
+{
+    if( !media ) { return SAVE_EBADINPUT; }
+
+    int i = __find_key( key );
+
+    if( i < 0 ) { return SAVE_ENOKEY; }
+
+    if( buf && size > 0 )
+    {
+        uint32_t n = keys[i].len < size ? keys[i].len : size;
+
+        if( media->read( media, keys[i].offset + HEADER_SIZE, buf, n ) < 0 ) { return SAVE_EIO; }
+    }
+
+    return keys[i].len;
+}
+
+/**
+ * @brief Make room for a record at the tail of the log
+ *
+ * @return #SAVE_ESUCCESS or a negative error code
+ */
+static int __make_room( uint32_t size )
+{
+    for( int tries = 0; tail + size > __segment_start( head ) + media->segment_size; tries++ )
+    {
+        if( tries == 2 * num_segments ) { return SAVE_ENOSPC; }
+
+        /* Fill what is left of the head from the segment that the next head
+           takes its records from.  They would be copied then anyway, and
+           this way the next head has more room. */
+        int ret = __relocate( (head + 2) % num_segments, 1 );
+
+        if( ret == SAVE_ESUCCESS ) { ret = __advance(); }
+
+        if( ret != SAVE_ESUCCESS ) { return ret; }
+    }
+
+    return SAVE_ESUCCESS;
+}
+
+/**
+ * @brief Write the record of a key
+ *
+ * The new record replaces the old one only once it is completely written,
+ * so if power is cut, reading the key gives either the old or the new data.
+ *
+ * @param[in] key
+ *            Key to write, anything but #SAVE_KEY_INVALID
+ * @param[in] data
+ *            Data to store
+ * @param[in] len
+ *            Length of the data, which with an 8 byte header must fit in a
+ *            segment
+ *
+ * @return #SAVE_ESUCCESS or a negative error code.  After #SAVE_EIO, writes
+ *         fail until the store is mounted again.
+ */
+int save_write( uint16_t key, const void *data, int len )
+{
+    if( !media || key == SAVE_KEY_INVALID || len < 0 || len >= TOMBSTONE || (!data && len) ) { return SAVE_EBADINPUT; }
+    if( write_failed ) { return SAVE_EIO; }
+
+    uint32_t size = __record_size( len );
+
+    if( size > __segment_payload() ) { return SAVE_EBADINPUT; }
+
+    int i = __find_key( key );
+
+    if( i < 0 && num_keys == SAVE_MAX_KEYS ) { return SAVE_ENOSPC; }
+
+    uint32_t live = __live_bytes() - (i >= 0 ? __record_size( keys[i].len ) : 0) + size;
+
+    if( live > __capacity() ) { return SAVE_ENOSPC; }
+
+    int ret = __make_room( size );
+
+    if( ret != SAVE_ESUCCESS ) { return ret; }
+
+    return __append( key, len, data ? data : "", 0 );
+}
+
+/**
+ * @brief Delete the record of a key
+ *
+ * @param[in] key
+ *            Key to delete
+ *
+ * @return #SAVE_ESUCCESS or a negative error code
+ */
+int save_delete( uint16_t key )
+{
+    if( !media ) { return SAVE_EBADINPUT; }
+    if( write_failed ) { return SAVE_EIO; }
+    if( __find_key( key ) < 0 ) { return SAVE_ENOKEY; }
+
+    int ret = __make_room( __record_size( TOMBSTONE ) );
+
+    if( ret != SAVE_ESUCCESS ) { return ret; }
+
+    return __append( key, TOMBSTONE, "", 0 );
+}
+
+/**
+ * @brief Read the save store statistics
+ *
+ * @param[out] out
+ *             Structure to copy the statistics into
+ */
+void save_get_stats( save_stats_t *out )
+{
+    *out = stats;
+
+    if( media )
+    {
+        out->live_bytes = __live_bytes();
+        out->capacity = __capacity();
+    }
+}
+
+/**
+ * @brief Read from EEPROM
+ */
+static int __eeprom_read( save_media_t *m, uint32_t offset, void *buf, uint32_t len )
+{
+    uint8_t block[8];
+    uint8_t *out = buf;
+
+    while( len )
+    {
+        uint32_t skip = offset % 8;
+        uint32_t n = 8 - skip;
+
+        if( n > len ) { n = len; }
+
+        eeprom_read( offset / 8, block );
+        memcpy( out, block + skip, n );
+
+        out += n;
+        offset += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Write whole blocks to EEPROM
+ */
+static int __eeprom_write( save_media_t *m, uint32_t offset, const void *buf, uint32_t len )
+{
+    const uint8_t *in = buf;
+
+    for( uint32_t i = 0; i < len; i += 8 )
+    {
+        eeprom_write( (offset + i) / 8, in + i );
+
+        /* The EEPROM ignores commands until the block is written */
+        wait_ms( EEPROM_WRITE_MS );
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Set up EEPROM as a save medium
+ *
+ * @param[out] m
+ *             Medium to fill in
+ * @param[in]  blocks
+ *             Size of the EEPROM in 8 byte blocks, 64 for 4 kbit or 256 for
+ *             16 kbit
+ */
+void save_media_eeprom( save_media_t *m, int blocks )
+{
+    memset( m, 0, sizeof(save_media_t) );
+
+    m->size = blocks * 8;
+    m->segment_size = m->size / 4;
+    m->write_unit = 8;
+    m->read = __eeprom_read;
+    m->write = __eeprom_write;
+}
+
+/**
+ * @brief Read from PI domain 2 through the bounce buffer
+ *
+ * @param[in]  base
+ *             PI address of the medium
+ * @param[in]  shift
+ *             How far offsets are shifted right to form addresses
+ * @param[in]  offset
+ *             Offset on the medium
+ * @param[out] buf
+ *             Buffer for the data
+ * @param[in]  len
+ *             Number of bytes
+ */
+static void __pi_read( uint32_t base, int shift, uint32_t offset, void *buf, uint32_t len )
+{
+    uint8_t *out = buf;
+
+    while( len )
+    {
+        uint32_t start = offset & ~7;
+        uint32_t skip = offset - start;
+        uint32_t n = sizeof(pi_buf) - skip;
+
+        if( n > len ) { n = len; }
+
+        /* Make sure we have fresh cache */
+        data_cache_hit_writeback_invalidate( pi_buf, sizeof(pi_buf) );
+
+        dma_read( (void *)((uint32_t)pi_buf & 0x1FFFFFFF), base + (start >> shift), (skip + n + 1) & ~1 );
+
+        /* Fresh cache again */
+        data_cache_hit_invalidate( pi_buf, sizeof(pi_buf) );
+
+        memcpy( out, pi_buf + skip, n );
+        out += n;
+        offset += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Write to PI domain 2 through the bounce buffer
+ *
+ * @param[in] addr
+ *            PI address to write to
+ * @param[in] buf
+ *            Data to write
+ * @param[in] len
+ *            Number of bytes, at most #SAVE_MAX_UNIT
+ */
+static void __pi_write( uint32_t addr, const void *buf, uint32_t len )
+{
+    memcpy( pi_buf, buf, len );
+    data_cache_hit_writeback( pi_buf, len );
+
+    dma_write( (void *)((uint32_t)pi_buf & 0x1FFFFFFF), addr, len );
+}
+
+/**
+ * @brief Read from SRAM
+ */
+static int __sram_read( save_media_t *m, uint32_t offset, void *buf, uint32_t len )
+{
+    __pi_read( PI_DOM2_ADDR, 0, offset, buf, len );
+
+    return 0;
+}
+
+/**
+ * @brief Write to SRAM
+ */
+static int __sram_write( save_media_t *m, uint32_t offset, const void *buf, uint32_t len )
+{
+    const uint8_t *in = buf;
+
+    for( uint32_t i = 0; i < len; i += SAVE_MAX_UNIT )
+    {
+        uint32_t n = len - i < SAVE_MAX_UNIT ? len - i : SAVE_MAX_UNIT;
+
+        __pi_write( PI_DOM2_ADDR + offset + i, in + i, n );
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Set up SRAM as a save medium
+ *
+ * @param[out] m
+ *             Medium to fill in
+ * @param[in]  size
+ *             Size of the SRAM in bytes, 0 for the usual 32 KiB
+ */
+void save_media_sram( save_media_t *m, uint32_t size )
+{
+    memset( m, 0, sizeof(save_media_t) );
+
+    /* Timing for SRAM, as set up by the boot code of SRAM games */
+    *PI_BSD_DOM2_LAT = 0x05;
+    *PI_BSD_DOM2_PWD = 0x0C;
+    *PI_BSD_DOM2_PGS = 0x0D;
+    *PI_BSD_DOM2_RLS = 0x02;
+
+    m->size = size ? size : SRAM_SIZE;
+    m->segment_size = m->size / 8;
+    m->write_unit = 8;
+    m->read = __sram_read;
+    m->write = __sram_write;
+}
+
+/**
+ * @brief Wait for FlashRAM to finish programming or erasing
+ *
+ * @return 0 or -1 on timeout
+ */
+static int __flash_wait( void )
+{
+    unsigned long start = get_ticks_ms();
+
+    io_write( FLASH_CMD_ADDR, FLASH_CMD_STATUS );
+
+    while( io_read( PI_DOM2_ADDR ) & FLASH_STATUS_BUSY )
+    {
+        if( get_ticks_ms() - start > FLASH_TIMEOUT_MS ) { return -1; }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Read from FlashRAM
+ */
+static int __flash_read( save_media_t *m, uint32_t offset, void *buf, uint32_t len )
+{
+    io_write( FLASH_CMD_ADDR, FLASH_CMD_READ );
+
+    /* FlashRAM is addressed in 16 bit words */
+    __pi_read( PI_DOM2_ADDR, 1, offset, buf, len );
+
+    return 0;
+}
+
+/**
+ * @brief Program whole FlashRAM pages
+ */
+static int __flash_write( save_media_t *m, uint32_t offset, const void *buf, uint32_t len )
+{
+    const uint8_t *in = buf;
+
+    for( uint32_t i = 0; i < len; i += FLASH_PAGE )
+    {
+        /* Load the page buffer, then program it */
+        io_write( FLASH_CMD_ADDR, FLASH_CMD_LOAD );
+        __pi_write( PI_DOM2_ADDR, in + i, FLASH_PAGE );
+        io_write( FLASH_CMD_ADDR, FLASH_CMD_PROGRAM | ((offset + i) / FLASH_PAGE) );
+
+        if( __flash_wait() < 0 ) { return -1; }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Erase a FlashRAM sector
+ */
+static int __flash_erase( save_media_t *m, uint32_t offset )
+{
+    io_write( FLASH_CMD_ADDR, FLASH_CMD_ERASE_SECTOR | (offset / FLASH_PAGE) );
+    io_write( FLASH_CMD_ADDR, FLASH_CMD_ERASE_EXECUTE );
+
+    return __flash_wait();
+}
+
+/**
+ * @brief Set up FlashRAM as a save medium
+ *
+ * @param[out] m
+ *             Medium to fill in
+ */
+void save_media_flashram( save_media_t *m )
+{
+    memset( m, 0, sizeof(save_media_t) );
+
+    /* Timing for FlashRAM, as set up by the boot code of FlashRAM games */
+    *PI_BSD_DOM2_LAT = 0x05;
+    *PI_BSD_DOM2_PWD = 0x0C;
+    *PI_BSD_DOM2_PGS = 0x0F;
+    *PI_BSD_DOM2_RLS = 0x02;
+
+    m->size = FLASH_SIZE;
+    m->segment_size = FLASH_SECTOR;
+    m->write_unit = FLASH_PAGE;
+    m->read = __flash_read;
+    m->write = __flash_write;
+    m->erase = __flash_erase;
+}
+
+/**
+ * @brief Take bytes from the write budget of RAM media
+ *
+ * @param[in,out] len
+ *                Bytes to write, cut short if power runs out
+ *
+ * @return 0, or -1 if power was cut
+ */
+static int __ram_spend( uint32_t *len )
+{
+    if( ram_budget == SAVE_NO_CUT ) { return 0; }
+
+    if( *len > ram_budget )
+    {
+        *len = ram_budget;
+        ram_budget = 0;
+        return -1;
+    }
+
+    ram_budget -= *len;
+    return 0;
+}
+
+/**
+ * @brief Read from RAM media
+ */
+static int __ram_read( save_media_t *m, uint32_t offset, void *buf, uint32_t len )
+{
+    memcpy( buf, (uint8_t *)m->ctx + offset, len );
+
+    return 0;
+}
+
+/**
+ * @brief Write to RAM media
+ */
+static int __ram_write( save_media_t *m, uint32_t offset, const void *buf, uint32_t len )
+{
+    uint8_t *out = (uint8_t *)m->ctx + offset;
+    const uint8_t *in = buf;
+    int ret = __ram_spend( &len );
+
+    for( uint32_t i = 0; i < len; i++ )
+    {
+        /* Like flash, programming can only clear bits */
+        out[i] = m->erase ? (out[i] & in[i]) : in[i];
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Erase a segment of RAM media
+ */
+static int __ram_erase( save_media_t *m, uint32_t offset )
+{
+    uint32_t len = m->segment_size;
+    int ret = __ram_spend( &len );
+
+    memset( (uint8_t *)m->ctx + offset, 0xFF, len );
+
+    return ret;
+}
+
+/**
+ * @brief Set up a buffer in memory as a save medium
+ *
+ * @param[out] m
+ *             Medium to fill in
+ * @param[in]  buf
+ *             Memory to use
+ * @param[in]  size
+ *             Size of the memory in bytes
+ * @param[in]  segment_size
+ *             Segment size in bytes
+ * @param[in]  write_unit
+ *             Write unit in bytes
+ * @param[in]  erasable
+ *             Nonzero to behave like flash, needing an erase before writing
+ *             again, or zero to behave like EEPROM and SRAM
+ */
+void save_media_ram( save_media_t *m, void *buf, uint32_t size, uint32_t segment_size, uint32_t write_unit, int erasable )
+{
+    memset( m, 0, sizeof(save_media_t) );
+
+    m->size = size;
+    m->segment_size = segment_size;
+    m->write_unit = write_unit;
+    m->read = __ram_read;
+    m->write = __ram_write;
+    m->erase = erasable ? __ram_erase : NULL;
+    m->ctx = buf;
+}
+
+/**
+ * @brief Cut power to RAM media after a number of bytes
+ *
+ * Once the budget runs out, the write in progress stops partway and it and
+ * every later write and erase fail, as if the console had been turned off.
+ * Call again with #SAVE_NO_CUT to turn power back on.
+ *
+ * @param[in] bytes
+ *            Bytes that can still be written or erased, or #SAVE_NO_CUT
+ */
+void save_media_ram_cut( uint32_t bytes )
+{
+    ram_budget = bytes;
+}
+
+/** @} */
@@ -0,0 +1,584 @@
+/**
+ * @file sd.c
+ * @brief SD Card
+ * @ingroup sd
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "libdragon.h"
+#include "system.h"
+#include "64drive.h"
+
+/**
+ * @defgroup sd SD Card
+ * @ingroup lowlevel
+ * @brief Reading the SD card slot of a 64drive.
+ *
+ * The 64drive reads sectors from its SD card into cartridge SDRAM, from
+ * where the PI copies them to RDRAM.  Both steps take a while, so
+ * #sd_read_sectors splits large reads into chunks and alternates between
+ * two halves of a staging area in SDRAM: while the PI copies one chunk out,
+ * the cartridge is already reading the next one into the other half.
+ *
+ * #sd_init also attaches the card as a filesystem under "sd:/".  There is no
+ * FAT support; instead, file names select a raw region of the card, which
+ * suits streaming large assets in development builds.  "sd:/2048" is
+ * everything from sector 2048 on, and "sd:/2048+1048576" is the megabyte
+ * starting there, which also gives the file a size for fstat and
+ * SEEK_END.  Numbers may be given in hex with a 0x prefix.  Asset packs
+ * are put on the card with a tool such as dd, for example
+ * `dd if=assets.bin of=/dev/sdX seek=2048`.  The filesystem is read only.
+ *
+ * The cartridge is reached through an #sd_backend_t.  Besides the 64drive,
+ * #sd_sim_backend emulates its registers over a disk image in memory, so
+ * that code using the card can run on emulators and flash carts without
+ * one.  The emulation only finishes a command after its status has been
+ * polled a few times, which catches code that uses a chunk too early, and
+ * loses the rest of any cache line a copy only partly covers, like the
+ * cache invalidation after a DMA does.  The register and DMA access of the
+ * 64drive live in sd_hw.c, so the rest of the driver also builds on the
+ * host, where the tests run it against the emulation.
+ *
+ * Reads wait for the cartridge by polling, and are not safe to make from
+ * more than one thread at a time.
+ * @{
+ */
+
+/** @brief Busy bit of the cartridge interface status register */
+#define CI_STATUS_BUSY      0x1000
+/** @brief Status polls before a command is given up on */
+#define CI_TIMEOUT          4000000
+/** @brief Value of CI_REG_HWMAGIC on a 64drive, "UDEV" */
+#define CI_HWMAGIC          0x55444556
+/** @brief Status polls the simulated backend stays busy for */
+#define SIM_BUSY_POLLS      4
+/** @brief What the simulated backend leaves in partly covered cache lines */
+#define SIM_STALE           0xEE
+
+/**
+ * @brief An open file on the SD filesystem
+ */
+typedef struct
+{
+    /** @brief Nonzero if this handle is in use */
+    int used;
+    /** @brief First sector of the file */
+    uint32_t lba;
+    /** @brief Size of the file in bytes, or zero if not known */
+    uint32_t size;
+    /** @brief Current position in bytes */
+    uint32_t pos;
+} sd_file_t;
+
+/** @brief Backend in use, or NULL before #sd_init */
+static const sd_backend_t *backend = NULL;
+/** @brief Open files */
+static sd_file_t files[SD_MAX_OPEN_FILES];
+/** @brief Buffer for reads that do not cover whole aligned sectors */
+static uint8_t bounce[SD_SECTOR_SIZE] __attribute__((aligned(16)));
+
+#ifdef __mips__
+/* Register and DMA access of the 64drive */
+extern const sd_backend_t __sd_hw_backend;
+#endif
+
+/** @brief Disk image of the simulated backend */
+static const uint8_t *sim_image = NULL;
+/** @brief Number of sectors in the simulated disk image */
+static uint32_t sim_sectors = 0;
+/** @brief Simulated staging area */
+static uint8_t *sim_sdram = NULL;
+/** @brief Simulated LBA, LENGTH and BUF registers */
+static uint32_t sim_lba, sim_length, sim_buf;
+/** @brief Polls until the simulated command finishes, zero when idle */
+static int sim_busy = 0;
+
+/**
+ * @brief Finish the command of the simulated backend
+ */
+static void __sim_complete( void )
+{
+    uint8_t *dest = sim_sdram + (sim_buf - SD_SDRAM_AREA);
+
+    for( uint32_t i = 0; i < sim_length; i++, dest += SD_SECTOR_SIZE )
+    {
+        /* Sectors past the end of the image read as zeros */
+        if( sim_lba + i < sim_sectors )
+        {
+            memcpy( dest, sim_image + (sim_lba + i) * SD_SECTOR_SIZE, SD_SECTOR_SIZE );
+        }
+        else
+        {
+            memset( dest, 0, SD_SECTOR_SIZE );
+        }
+    }
+}
+
+/**
+ * @brief Read a register of the simulated backend
+ *
+ * @param[in] reg
+ *            Register offset
+ *
+ * @return The value of the register
+ */
+static uint32_t __sim_reg_read( uint32_t reg )
+{
+    switch( reg )
+    {
+        case CI_REG_STATUS:
+            if( !sim_busy ) { return 0; }
+            if( --sim_busy == 0 ) { __sim_complete(); }
+            return CI_STATUS_BUSY;
+        case CI_REG_LBA:
+            return sim_lba;
+        case CI_REG_LENGTH:
+            return sim_length;
+        case CI_REG_HWMAGIC:
+            return CI_HWMAGIC;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Write a register of the simulated backend
+ *
+ * @param[in] reg
+ *            Register offset
+ * @param[in] value
+ *            Value to write
+ */
+static void __sim_reg_write( uint32_t reg, uint32_t value )
+{
+    /* Registers cannot be changed while a command runs */
+    if( sim_busy ) { return; }
+
+    switch( reg )
+    {
+        case CI_REG_BUF:
+            sim_buf = value;
+            break;
+        case CI_REG_LBA:
+            sim_lba = value;
+            break;
+        case CI_REG_LENGTH:
+            sim_length = value;
+            break;
+        case CI_REG_COMMAND:
+            /* Only reads into the staging area are emulated */
+            if( value == CI_CMD_READ_SECTORS && sim_buf >= SD_SDRAM_AREA &&
+                sim_buf - SD_SDRAM_AREA + sim_length * SD_SECTOR_SIZE <= 2 * SD_CHUNK_SIZE )
+            {
+                sim_busy = SIM_BUSY_POLLS;
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Copy from the simulated staging area
+ *
+ * @param[out] ram
+ *             16 byte aligned destination
+ * @param[in]  sdram
+ *             Offset in cartridge SDRAM
+ * @param[in]  len
+ *             Number of bytes
+ */
+static void __sim_sdram_read( void *ram, uint32_t sdram, uint32_t len )
+{
+    uint8_t *start = (uint8_t *)((uintptr_t)ram & ~15);
+    uint8_t *end = (uint8_t *)(((uintptr_t)ram + len + 15) & ~15);
+
+    /* The cache invalidation on hardware loses whatever else was in the lines */
+    memset( start, SIM_STALE, end - start );
+    memcpy( ram, sim_sdram + (sdram - SD_SDRAM_AREA), len );
+}
+
+/** @brief Backend emulating a 64drive over a disk image */
+static const sd_backend_t sim_backend = { __sim_reg_read, __sim_reg_write, __sim_sdram_read };
+
+/**
+ * @brief Return a backend that emulates a 64drive over a disk image
+ *
+ * @param[in] image
+ *            Disk image, which must stay valid while the backend is in use
+ * @param[in] num_sectors
+ *            Size of the disk image in sectors
+ *
+ * @return The backend to pass to #sd_init, or NULL if out of memory
+ */
+const sd_backend_t *sd_sim_backend( const void *image, uint32_t num_sectors )
+{
+    if( !sim_sdram ) { sim_sdram = malloc( 2 * SD_CHUNK_SIZE ); }
+    if( !sim_sdram ) { return NULL; }
+
+    sim_image = image;
+    sim_sectors = num_sectors;
+    sim_busy = 0;
+
+    return &sim_backend;
+}
+
+/**
+ * @brief Wait for the cartridge to finish a command
+ *
+ * @return #SD_ESUCCESS or #SD_ETIMEOUT
+ */
+static int __wait( void )
+{
+    for( int i = 0; i < CI_TIMEOUT; i++ )
+    {
+        if( !(backend->reg_read( CI_REG_STATUS ) & CI_STATUS_BUSY) ) { return SD_ESUCCESS; }
+    }
+
+    return SD_ETIMEOUT;
+}
+
+/**
+ * @brief Start reading sectors into a half of the staging area
+ *
+ * @param[in] lba
+ *            First sector
+ * @param[in] count
+ *            Number of sectors, at most #SD_CHUNK_SECTORS
+ * @param[in] half
+ *            Half of the staging area to read into
+ */
+static void __start_read( uint32_t lba, uint32_t count, int half )
+{
+    backend->reg_write( CI_REG_BUF, SD_SDRAM_AREA + half * SD_CHUNK_SIZE );
+    backend->reg_write( CI_REG_LBA, lba );
+    backend->reg_write( CI_REG_LENGTH, count );
+    backend->reg_write( CI_REG_COMMAND, CI_CMD_READ_SECTORS );
+}
+
+/**
+ * @brief Copy from the staging area without touching memory around it
+ *
+ * The cache lines a copy touches are invalidated after the DMA, and #dma_read
+ * lets other threads and interrupts run meanwhile.  Anything they wrote to a
+ * line the destination only partly covers would be lost, so such lines at
+ * either end go through a line of their own.
+ *
+ * @param[out] ram
+ *             8 byte aligned destination
+ * @param[in]  sdram
+ *             Offset in cartridge SDRAM
+ * @param[in]  len
+ *             Number of bytes
+ */
+static void __sdram_read( void *ram, uint32_t sdram, uint32_t len )
+{
+    uint8_t line[16] __attribute__((aligned(16)));
+    uint8_t *out = ram;
+    uint32_t head = (16 - ((uintptr_t)out & 15)) & 15;
+
+    if( head > len ) { head = len; }
+
+    uint32_t tail = (len - head) & 15;
+    uint32_t middle = len - head - tail;
+
+    if( head )
+    {
+        backend->sdram_read( line, sdram, head );
+        memcpy( out, line, head );
+    }
+
+    if( middle ) { backend->sdram_read( out + head, sdram + head, middle ); }
+
+    if( tail )
+    {
+        backend->sdram_read( line, sdram + head + middle, tail );
+        memcpy( out + head + middle, line, tail );
+    }
+}
+
+/**
+ * @brief Read sectors from the SD card
+ *
+ * @param[in]  lba
+ *             First sector to read
+ * @param[in]  count
+ *             Number of sectors to read
+ * @param[out] buf
+ *             8 byte aligned buffer of count * #SD_SECTOR_SIZE bytes
+ *
+ * @return #SD_ESUCCESS or a negative error code
+ */
+int sd_read_sectors( uint32_t lba, uint32_t count, void *buf )
+{
+    uint8_t *out = buf;
+    int half = 0;
+
+    if( !backend ) { return SD_ENODEV; }
+    if( (uintptr_t)buf & 7 ) { return SD_EBADINPUT; }
+    if( !count ) { return SD_ESUCCESS; }
+
+    uint32_t chunk = count < SD_CHUNK_SECTORS ? count : SD_CHUNK_SECTORS;
+
+    if( __wait() != SD_ESUCCESS ) { return SD_ETIMEOUT; }
+    __start_read( lba, chunk, half );
+
+    while( count )
+    {
+        if( __wait() != SD_ESUCCESS ) { return SD_ETIMEOUT; }
+
+        uint32_t next_count = count - chunk;
+        uint32_t next_chunk = next_count < SD_CHUNK_SECTORS ? next_count : SD_CHUNK_SECTORS;
+
+        /* Read the next chunk into the other half while this one is copied */
+        if( next_chunk ) { __start_read( lba + chunk, next_chunk, !half ); }
+
+        __sdram_read( out, SD_SDRAM_AREA + half * SD_CHUNK_SIZE, chunk * SD_SECTOR_SIZE );
+
+        out += chunk * SD_SECTOR_SIZE;
+        lba += chunk;
+        count = next_count;
+        chunk = next_chunk;
+        half = !half;
+    }
+
+    return SD_ESUCCESS;
+}
+
+/**
+ * @brief Newlib-compatible open
+ *
+ * @param[in] name
+ *            Region of the card, as "<lba>" or "<lba>+<size>"
+ * @param[in] flags
+ *            POSIX file flags
+ *
+ * @return A newlib-compatible file handle, or NULL on error
+ */
+static void *__open( char *name, int flags )
+{
+    char *end;
+
+    /* The filesystem is read only */
+    if( (flags & O_ACCMODE) != O_RDONLY ) { return NULL; }
+
+    uint32_t lba = strtoul( name, &end, 0 );
+    uint32_t size = 0;
+
+    if( end == name ) { return NULL; }
+
+    if( *end == '+' )
+    {
+        name = end + 1;
+        size = strtoul( name, &end, 0 );
+
+        if( end == name || !size ) { return NULL; }
+    }
+
+    if( *end ) { return NULL; }
+
+    for( int i = 0; i < SD_MAX_OPEN_FILES; i++ )
+    {
+        if( !files[i].used )
+        {
+            files[i].used = 1;
+            files[i].lba = lba;
+            files[i].size = size;
+            files[i].pos = 0;
+
+            return &files[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Newlib-compatible fstat
+ *
+ * @param[in]  file
+ *             File pointer as returned by #__open
+ * @param[out] st
+ *             Stat structure to populate
+ *
+ * @return 0.
+ */
+static int __fstat( void *file, struct stat *st )
+{
+    sd_file_t *f = file;
+
+    memset( st, 0, sizeof(struct stat) );
+    st->st_mode = S_IFREG;
+    st->st_nlink = 1;
+    st->st_size = f->size;
+
+    /* Big enough for stdio refills to overlap several chunks */
+    st->st_blksize = 4 * SD_CHUNK_SIZE;
+    st->st_blocks = (st->st_size + 511) / 512;
+
+    return 0;
+}
+
+/**
+ * @brief Newlib-compatible lseek
+ *
+ * @param[in] file
+ *            File pointer as returned by #__open
+ * @param[in] ptr
+ *            Offset based on dir
+ * @param[in] dir
+ *            A direction to seek from.  Either #SEEK_SET, #SEEK_CUR or #SEEK_END
+ *
+ * @return The new position in the file after the seek, or a negative value
+ *         on error.
+ */
+static int __lseek( void *file, int ptr, int dir )
+{
+    sd_file_t *f = file;
+    int64_t pos;
+
+    switch( dir )
+    {
+        case SEEK_SET:
+            pos = ptr;
+            break;
+        case SEEK_CUR:
+            pos = (int64_t)f->pos + ptr;
+            break;
+        case SEEK_END:
+            /* Only regions with a size have an end */
+            if( !f->size ) { return -1; }
+            pos = (int64_t)f->size + ptr;
+            break;
+        default:
+            return -1;
+    }
+
+    if( pos < 0 || pos > 0x7FFFFFFF ) { return -1; }
+
+    f->pos = pos;
+
+    return pos;
+}
+
+/**
+ * @brief Newlib-compatible read
+ *
+ * @param[in]  file
+ *             File pointer as returned by #__open
+ * @param[out] ptr
+ *             Buffer to place data read into
+ * @param[in]  len
+ *             Length of data that should be read into ptr
+ *
+ * @return The actual number of bytes read or a negative value on error.
+ */
+static int __read( void *file, uint8_t *ptr, int len )
+{
+    sd_file_t *f = file;
+    int done = 0;
+
+    if( f->size )
+    {
+        if( f->pos >= f->size ) { return 0; }
+        if( len > f->size - f->pos ) { len = f->size - f->pos; }
+    }
+
+    while( len > 0 )
+    {
+        uint32_t lba = f->lba + f->pos / SD_SECTOR_SIZE;
+        uint32_t offset = f->pos % SD_SECTOR_SIZE;
+        uint32_t bytes;
+
+        if( !offset && len >= SD_SECTOR_SIZE && !((uintptr_t)ptr & 7) )
+        {
+            /* Whole sectors go straight to the caller */
+            bytes = len - len % SD_SECTOR_SIZE;
+
+            if( sd_read_sectors( lba, bytes / SD_SECTOR_SIZE, ptr ) != SD_ESUCCESS ) { break; }
+        }
+        else
+        {
+            bytes = SD_SECTOR_SIZE - offset;
+            if( bytes > len ) { bytes = len; }
+
+            if( sd_read_sectors( lba, 1, bounce ) != SD_ESUCCESS ) { break; }
+            memcpy( ptr, bounce + offset, bytes );
+        }
+
+        ptr += bytes;
+        len -= bytes;
+        f->pos += bytes;
+        done += bytes;
+    }
+
+    /* Only report an error if nothing could be read */
+    return (done || len <= 0) ? done : -1;
+}
+
+/**
+ * @brief Newlib-compatible close
+ *
+ * @param[in] file
+ *            File pointer as returned by #__open
+ *
+ * @return 0.
+ */
+static int __close( void *file )
+{
+    ((sd_file_t *)file)->used = 0;
+
+    return 0;
+}
+
+/** @brief Newlib hooks for the SD filesystem */
+static filesystem_t sd_fs = {
+    __open,
+    __fstat,
+    __lseek,
+    __read,
+    0,
+    __close,
+    0,
+    0,
+    0
+};
+
+/**
+ * @brief Initialize the SD card driver and attach "sd:/"
+ *
+ * @param[in] sd_backend
+ *            Backend to use, or NULL for a 64drive, which host builds don't
+ *            have
+ *
+ * @return #SD_ESUCCESS, or #SD_ENODEV if there is no 64drive
+ */
+int sd_init( const sd_backend_t *sd_backend )
+{
+#ifdef __mips__
+    if( !sd_backend ) { sd_backend = &__sd_hw_backend; }
+#endif
+
+    if( !sd_backend || sd_backend->reg_read( CI_REG_HWMAGIC ) != CI_HWMAGIC ) { return SD_ENODEV; }
+
+    sd_close();
+
+    backend = sd_backend;
+    memset( files, 0, sizeof(files) );
+    attach_filesystem( "sd:/", &sd_fs );
+
+    return SD_ESUCCESS;
+}
+
+/**
+ * @brief Detach "sd:/" and stop using the card
+ */
+void sd_close( void )
+{
+    if( !backend ) { return; }
+
+    detach_filesystem( "sd:/" );
+    backend = NULL;
+}
+
+/** @} */
@@ -0,0 +1,67 @@
+/**
+ * @file sd_hw.c
+ * @brief SD Card Hardware Access
+ * @ingroup sd
+ */
+#include "libdragon.h"
+#include "64drive.h"
+
+/**
+ * @addtogroup sd
+ * @{
+ */
+
+/**
+ * @brief Read a 64drive register
+ *
+ * @param[in] reg
+ *            Register offset
+ *
+ * @return The value of the register
+ */
+static uint32_t __hw_reg_read( uint32_t reg )
+{
+    return io_read( CART_BASE_UNCACHED + CI_REG_BASE + reg );
+}
+
+/**
+ * @brief Write a 64drive register
+ *
+ * @param[in] reg
+ *            Register offset
+ * @param[in] value
+ *            Value to write
+ */
+static void __hw_reg_write( uint32_t reg, uint32_t value )
+{
+    io_write( CART_BASE_UNCACHED + CI_REG_BASE + reg, value );
+}
+
+/**
+ * @brief DMA from 64drive SDRAM
+ *
+ * The whole cache lines the destination touches are invalidated, which is
+ * why the driver only hands over lines that belong to it.
+ *
+ * @param[out] ram
+ *             16 byte aligned destination
+ * @param[in]  sdram
+ *             Offset in cartridge SDRAM
+ * @param[in]  len
+ *             Number of bytes
+ */
+static void __hw_sdram_read( void *ram, uint32_t sdram, uint32_t len )
+{
+    /* Make sure we have fresh cache */
+    data_cache_hit_writeback_invalidate( ram, len );
+
+    dma_read( (void *)((uint32_t)ram & 0x1FFFFFFF), CART_BASE_UNCACHED + sdram, len );
+
+    /* Fresh cache again */
+    data_cache_hit_invalidate( ram, len );
+}
+
+/** @brief Backend for a real 64drive, used by #sd_init by default */
+const sd_backend_t __sd_hw_backend = { __hw_reg_read, __hw_reg_write, __hw_sdram_read };
+
+/** @} */
@@ -67,6 +67,23 @@
 #define STDERR_FILENO   2
 /** @} */
 
+/**
+ * @brief First file descriptor handed out for open files
+ *
+ * File descriptors are direct indices into #handles, offset past the
+ * standard streams.
+ */
+#define FIRST_FILENO    3
+
+/** @brief Word type that may alias any other type, for word-at-a-time string routines */
+typedef uint32_t __attribute__((__may_alias__)) word_t;
+
+/** @brief Nonzero if any byte in a word is zero */
+#define HAS_ZERO_BYTE( w ) (((w) - 0x01010101) & ~(w) & 0x80808080)
+
+/** @brief Nonzero if a pointer is word aligned */
+#define WORD_ALIGNED( p ) ((((uint32_t)(p)) & 3) == 0)
+
 /**
  * @brief Stack size
  *
@@ -106,7 +123,7 @@ struct timeval;
 int errno;
 
 /* Externs from libdragon */
-extern int __bootcic;
+extern int get_memory_size();
 extern void enable_interrupts();
 extern void disable_interrupts();
 
@@ -124,6 +141,10 @@ typedef struct
      * (eg. 'rom:/' or 'cf:/') 
      */
     char *prefix;
+    /** @brief Length of the prefix, precomputed for lookups */
+    int prefix_len;
+    /** @brief Hash of the prefix, precomputed for lookups */
+    uint32_t prefix_hash;
     /** @brief Filesystem callback pointers */
     filesystem_t *fs;
 } fs_mapping_t;
@@ -136,22 +157,31 @@ typedef struct
  */
 typedef struct
 {
+    /** @brief Filesystem callback pointers, copied from #filesystems */
+    filesystem_t *fs;
     /** @brief Index into #filesystems */
     int fs_mapping;
     /** @brief The handle assigned to this open file as returned by the 
      *         filesystem code called to handle the open operation.  Will
      *         be passed to all subsequent file operations on the file. */
     void *handle;
-    /** @brief The handle assigned by the filesystem code that will be returned
-     *         to newlib.  All subsequent newlib calls will use this handle which
-     *         will be used to look up the internal reference. */
+    /** @brief The handle returned to newlib, or 0 if this entry is free.
+     *         This is always the index of the entry plus #FIRST_FILENO. */
     int fileno;
+    /** @brief Index of the next free entry when this entry is free */
+    int next_free;
 } fs_handle_t;
 
 /** @brief Array of filesystems registered */
 static fs_mapping_t filesystems[MAX_FILESYSTEMS] = { { 0 } };
-/** @brief Array of open handles tracked */
+/** @brief Array of open handles tracked, indexed by file descriptor */
 static fs_handle_t handles[MAX_OPEN_HANDLES] = { { 0 } };
+/** @brief Index of the most recently closed free entry in #handles, or -1 */
+static int free_handle = -1;
+/** @brief Number of entries in #handles that have ever been used */
+static int used_handles = 0;
+/** @brief Index into #filesystems of the last filesystem looked up by name */
+static int last_mapping = 0;
 /** @brief Current stdio hook structure */
 static stdio_t stdio_hooks = { 0 };
 
@@ -161,6 +191,9 @@ int close( int fildes );
 /**
  * @brief Simple implementation of strlen
  *
+ * Once aligned, a word is checked at a time.  Reading the rest of the word
+ * holding the terminator is safe as it can't cross a page.
+ *
  * @note We can't link against regular libraries, so this is reimplemented
  *
  * @param[in] str
@@ -172,18 +205,34 @@ static int __strlen( const char * const str )
 {
     if( !str ) { return 0; }
 
-    int len = 0;
-    while( str[len] != 0 )
+    const char *cur = str;
+
+    while( !WORD_ALIGNED( cur ) )
+    {
+        if( *cur == 0 ) { return cur - str; }
+        cur++;
+    }
+
+    const word_t *word = (const word_t *)cur;
+    while( !HAS_ZERO_BYTE( *word ) )
     {
-        len++;
+        word++;
     }
 
-    return len;
+    cur = (const char *)word;
+    while( *cur != 0 )
+    {
+        cur++;
+    }
+
+    return cur - str;
 }
 
 /**
  * @brief Simple implementation of memcpy
  *
+ * Copies a word at a time when both pointers are word aligned.
+ *
  * @note We can't link against regular libraries, so this is reimplemented
  *
  * @param[out] a
@@ -195,7 +244,17 @@ static int __strlen( const char * const str )
  */
 static void __memcpy( char * const a, const char * const b, int len )
 {
-    for( int i = 0; i < len; i++ )
+    int i = 0;
+
+    if( WORD_ALIGNED( a ) && WORD_ALIGNED( b ) )
+    {
+        for( ; i + 4 <= len; i += 4 )
+        {
+            *(word_t *)(a + i) = *(const word_t *)(b + i);
+        }
+    }
+
+    for( ; i < len; i++ )
     {
         a[i] = b[i];
     }
@@ -215,49 +274,56 @@ static char *__strdup( const char * const in )
 {
     if( !in ) { return 0; }
 
-    char *ret = malloc( __strlen( in ) + 1 );
-    __memcpy( ret, in, __strlen( in ) + 1 );
+    int len = __strlen( in ) + 1;
+    char *ret = malloc( len );
+
+    if( ret ) { __memcpy( ret, in, len ); }
 
     return ret;
 }
 
 /**
- * @brief Simple iplementation of strncmp
+ * @brief Simple implementation of memcmp that only checks for equality
+ *
+ * Compares a word at a time when both pointers are word aligned.
  *
  * @note We can't link against regular libraries, so this is reimplemented
  *
  * @param[in] a
- *            First string to compare against
+ *            First buffer to compare
  * @param[in] b
- *            Second string to compare against
+ *            Second buffer to compare
  * @param[in] len
- *            Number of relevant characters.  Specify -1 for infinite
+ *            Number of bytes to compare
  *
- * @return 0 if the two strings match or nonzero otherwise
+ * @return 0 if the buffers match or nonzero otherwise
  */
-static int __strncmp( const char * const a, const char * const b, int len )
+static int __memcmp( const char * const a, const char * const b, int len )
 {
-    if( !a || !b ) { return 0; }
+    int i = 0;
 
-    int cur = 0;
-    while( cur != len )
+    if( WORD_ALIGNED( a ) && WORD_ALIGNED( b ) )
     {
-        /* Only care about equality */
-        if( a[cur] != b[cur] ) { return 1; }
-        if( a[cur] == 0 && b[cur] == 0 ) { return 0; }
-        if( a[cur] == 0 || b[cur] == 0 ) { return 1; }
+        for( ; i + 4 <= len; i += 4 )
+        {
+            if( *(const word_t *)(a + i) != *(const word_t *)(b + i) ) { return 1; }
+        }
+    }
 
-        /* Next please */
-        cur++;
+    for( ; i < len; i++ )
+    {
+        if( a[i] != b[i] ) { return 1; }
     }
 
-    /* Must have worked */
     return 0;
 }
 
 /**
  * @brief Simple implementation of strcmp
  *
+ * Compares a word at a time when both strings are word aligned, finishing
+ * byte by byte from the word holding a terminator or a difference.
+ *
  * @note We can't link against regular libraries, so this is reimplemented
  *
  * @param[in] a
@@ -269,28 +335,112 @@ static int __strncmp( const char * const a, const char * const b, int len )
  */
 static int __strcmp( const char * const a, const char * const b )
 {
-    return __strncmp( a, b, -1 );
+    if( !a || !b ) { return 0; }
+
+    int cur = 0;
+
+    if( WORD_ALIGNED( a ) && WORD_ALIGNED( b ) )
+    {
+        for( ;; cur += 4 )
+        {
+            word_t wa = *(const word_t *)(a + cur);
+
+            if( wa != *(const word_t *)(b + cur) || HAS_ZERO_BYTE( wa ) ) { break; }
+        }
+    }
+
+    for( ;; cur++ )
+    {
+        /* Only care about equality */
+        if( a[cur] != b[cur] ) { return 1; }
+        if( a[cur] == 0 ) { return 0; }
+    }
 }
 
 /**
- * @brief Return a unique filesystem handle
+ * @brief Find and hash the filesystem prefix of a path
+ *
+ * The prefix runs up to and including the first ":/".  The hash is 32 bit
+ * FNV-1a.
  *
- * @return A unique 32-bit value usable as a filesystem handle
+ * @param[in]  name
+ *             Path starting with a filesystem prefix
+ * @param[out] hash
+ *             Hash of the prefix
+ *
+ * @return Length of the prefix, or 0 if the path has no prefix
  */
-static int __get_new_handle()
+static int __prefix_hash( const char * const name, uint32_t *hash )
 {
-    /* Start past STDIN, STDOUT, STDERR file handles */
-    static int handle = 3;
-    int newhandle;
+    uint32_t h = 2166136261u;
+
+    for( int len = 0; name[len] != 0; len++ )
+    {
+        h = (h ^ (uint8_t)name[len]) * 16777619u;
+
+        if( name[len] == ':' && name[len + 1] == '/' )
+        {
+            *hash = (h ^ '/') * 16777619u;
+            return len + 2;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Allocate an entry in the open handle table
+ *
+ * Recently closed entries are reused first, then entries that were never
+ * used, so this never has to scan the table.
+ *
+ * @return A free entry marked as in use, or null if the table is full
+ */
+static fs_handle_t *__alloc_handle()
+{
+    fs_handle_t *entry = 0;
+    int index = -1;
 
     disable_interrupts();
 
-    /* Always give out a nonzero handle unique to the system */
-    newhandle = handle++;
+    if( free_handle >= 0 )
+    {
+        index = free_handle;
+        free_handle = handles[index].next_free;
+    }
+    else if( used_handles < MAX_OPEN_HANDLES )
+    {
+        index = used_handles++;
+    }
+
+    if( index >= 0 )
+    {
+        entry = &handles[index];
+        entry->fileno = index + FIRST_FILENO;
+    }
 
     enable_interrupts();
 
-    return newhandle;
+    return entry;
+}
+
+/**
+ * @brief Return an entry to the open handle table
+ *
+ * @param[in] entry
+ *            Entry returned by #__alloc_handle
+ */
+static void __free_handle( fs_handle_t *entry )
+{
+    disable_interrupts();
+
+    entry->fileno = 0;
+    entry->fs = 0;
+    entry->handle = 0;
+    entry->next_free = free_handle;
+    free_handle = entry - handles;
+
+    enable_interrupts();
 }
 
 /**
@@ -326,10 +476,11 @@ int attach_filesystem( const char * const prefix, filesystem_t *filesystem )
         return -1; 
     }
 
-    /* Make sure prefix is valid */
+    /* Make sure prefix is valid, it must end at its first ":/" */
+    uint32_t hash;
     int len = __strlen( prefix );
 
-    if( len < 3 || prefix[len - 1] != '/' || prefix[len - 2] != ':' )
+    if( len < 3 || __prefix_hash( prefix, &hash ) != len )
     {
         errno = EINVAL;
         return -1;
@@ -370,6 +521,14 @@ int attach_filesystem( const char * const prefix, filesystem_t *filesystem )
 
     /* Attach the prefix */
     filesystems[handle].prefix = __strdup( prefix );
+    filesystems[handle].prefix_len = len;
+    filesystems[handle].prefix_hash = hash;
+
+    if( !filesystems[handle].prefix )
+    {
+        errno = ENOMEM;
+        return -3;
+    }
 
     /* Attach the inputted filesystem */
     filesystems[handle].fs = filesystem;
@@ -407,7 +566,7 @@ int detach_filesystem( const char * const prefix )
             if( __strcmp( filesystems[i].prefix, prefix ) == 0 )
             {
                 /* We found the filesystem, now go through and close every open file handle */
-                for( int j = 0; j < MAX_OPEN_HANDLES; j++ )
+                for( int j = 0; j < used_handles; j++ )
                 {
                     if( handles[j].fileno > 0 && handles[j].fs_mapping == i )
                     {
@@ -432,39 +591,59 @@ int detach_filesystem( const char * const prefix )
 }
 
 /**
- * @brief Get a filesystem pointer by handle
+ * @brief Look up an open handle by file handle
  *
- * Given a file handle, return the filesystem callback structure.
+ * File handles index the open handle table directly, so this is constant
+ * time regardless of how many files are open.
  *
  * @param[in] fileno
  *            File handle
  * 
- * @return Pointer to a filesystem callback structure or null if not found.
+ * @return Pointer to the open handle or null if the file is not open.
  */
-static filesystem_t *__get_fs_pointer_by_handle( int fileno )
+static inline fs_handle_t *__get_handle( int fileno )
 {
-    /* Invalid */
-    if( fileno <= 0 )
+    unsigned int index = (unsigned int)(fileno - FIRST_FILENO);
+
+    /* Catches the standard streams and negative handles too */
+    if( index >= MAX_OPEN_HANDLES || handles[index].fileno != fileno )
     {
         return 0;
     }
 
-    for( int i = 0; i < MAX_OPEN_HANDLES; i++ )
-    {
-        if( handles[i].fileno == fileno )
-        {
-            /* Found it */
-            return filesystems[handles[i].fs_mapping].fs;
-        }
-    }
+    return &handles[index];
+}
 
-    /* Couldn't find it */
-    return 0;
+/**
+ * @brief Check whether a filesystem is mounted at a given prefix
+ *
+ * @param[in] mapping
+ *            Index into #filesystems
+ * @param[in] name
+ *            The filename including the prefix
+ * @param[in] len
+ *            Length of the prefix of the filename
+ * @param[in] hash
+ *            Hash of the prefix of the filename
+ *
+ * @return Nonzero if the filesystem matches
+ */
+static inline int __fs_matches( int mapping, const char * const name, int len, uint32_t hash )
+{
+    fs_mapping_t *fs = &filesystems[mapping];
+
+    /* Cheap integer checks first, the prefix only needs comparing on a hit */
+    return fs->prefix && fs->prefix_len == len && fs->prefix_hash == hash &&
+           __memcmp( fs->prefix, name, len ) == 0;
 }
 
 /**
  * @brief Get the index of the registered filesystem based on fully qualified filename
  *
+ * The prefix of the name is hashed once and checked against the length and
+ * hash stored for each filesystem.  The last filesystem found is checked
+ * first, as accesses tend to go to the same filesystem.
+ *
  * @param[in] name
  *            The filename of the file being opened including the prefix
  *
@@ -472,21 +651,33 @@ static filesystem_t *__get_fs_pointer_by_handle( int fileno )
  */
 static int __get_fs_link_by_name( const char * const name )
 {
+    uint32_t hash;
+
     /* Invalid */
     if( !name )
     {
         return -1;
     }
 
+    int len = __prefix_hash( name, &hash );
+
+    if( len == 0 )
+    {
+        return -1;
+    }
+
+    if( __fs_matches( last_mapping, name, len, hash ) )
+    {
+        return last_mapping;
+    }
+
     for( int i = 0; i < MAX_FILESYSTEMS; i++ )
     {
-        if( filesystems[i].prefix )
+        if( __fs_matches( i, name, len, hash ) )
         {
-            if( __strncmp( filesystems[i].prefix, name, __strlen( filesystems[i].prefix ) ) == 0 )
-            {
-                /* Found it */
-                return i;
-            }
+            /* Found it */
+            last_mapping = i;
+            return i;
         }
     }
 
@@ -517,35 +708,6 @@ static filesystem_t *__get_fs_pointer_by_name( const char * const name )
     }
 }
 
-/**
- * @brief Look up the internal handle of a file given a file handle
- *
- * @param[in] fileno
- *            File handle
- *
- * @return The internal file handle to be passed to the filesystem function or null if not found.
- */
-static void *__get_fs_handle( int fileno )
-{
-    /* Invalid */
-    if( fileno <= 0 )
-    {
-        return 0;
-    }
-
-    for( int i = 0; i < MAX_OPEN_HANDLES; i++ )
-    {
-        if( handles[i].fileno == fileno )
-        {
-            /* Found it */
-            return handles[i].handle;
-        }
-    }
-
-    /* Couldn't find it */
-    return 0;
-}
-
 /**
  * @brief Change ownership on a file or directory
  *
@@ -577,23 +739,28 @@ int chown( const char *path, uid_t owner, gid_t group )
  */
 int close( int fildes )
 {
-    filesystem_t *fs = __get_fs_pointer_by_handle( fildes );
-    void *handle = __get_fs_handle( fildes );
+    fs_handle_t *entry = __get_handle( fildes );
 
-    if( fs == 0 )
+    if( entry == 0 )
     {
         errno = EINVAL;
         return -1;
     }
 
-    if( fs->close == 0 )
+    if( entry->fs->close == 0 )
     {
-        /* Filesystem doesn't support close */
+        /* Filesystem doesn't support close, but the handle must not leak */
+        __free_handle( entry );
         errno = ENOSYS;
         return -1;
     }
 
-    return fs->close( handle );
+    int ret = entry->fs->close( entry->handle );
+
+    /* The file handle is released even if the filesystem reported an error */
+    __free_handle( entry );
+
+    return ret;
 }
 
 /**
@@ -669,23 +836,25 @@ int fstat( int fildes, struct stat *st )
     }
     else
     {
-        filesystem_t *fs = __get_fs_pointer_by_handle( fildes );
-        void *handle = __get_fs_handle( fildes );
+        fs_handle_t *entry = __get_handle( fildes );
 
-        if( fs == 0 )
+        if( entry == 0 )
         {
             errno = EINVAL;
             return -1;
         }
 
-        if( fs->fstat == 0 )
+        if( entry->fs->fstat == 0 )
         {
             /* Filesystem doesn't support fstat */
             errno = ENOSYS;
             return -1;
         }
 
-        return fs->fstat( handle, st );
+        /* Fields the filesystem doesn't know about, such as the block size, read as zero */
+        *st = (struct stat){ 0 };
+
+        return entry->fs->fstat( entry->handle, st );
     }
 }
 
@@ -800,23 +969,22 @@ int link( char *existing, char *new )
  */
 int lseek( int file, int ptr, int dir )
 {
-    filesystem_t *fs = __get_fs_pointer_by_handle( file );
-    void *handle = __get_fs_handle( file );
+    fs_handle_t *entry = __get_handle( file );
 
-    if( fs == 0 )
+    if( entry == 0 )
     {
         errno = EINVAL;
         return -1;
     }
 
-    if( fs->lseek == 0 )
+    if( entry->fs->lseek == 0 )
     {
         /* Filesystem doesn't support lseek */
         errno = ENOSYS;
         return -1;
     }
 
-    return fs->lseek( handle, ptr, dir );
+    return entry->fs->lseek( entry->handle, ptr, dir );
 }
 
 /**
@@ -833,14 +1001,16 @@ int lseek( int file, int ptr, int dir )
  */
 int open( char *file, int flags, int mode )
 {
-    filesystem_t *fs = __get_fs_pointer_by_name( file );
+    int mapping = __get_fs_link_by_name( file );
 
-    if( fs == 0 )
+    if( mapping < 0 )
     {
         errno = EINVAL;
         return -1;
     }
 
+    filesystem_t *fs = filesystems[mapping].fs;
+
     if( fs->open == 0 )
     {
         /* Filesystem doesn't support open */
@@ -849,43 +1019,35 @@ int open( char *file, int flags, int mode )
     }
 
     /* Do we have room for a new file? */
-    for( int i = 0; i < MAX_OPEN_HANDLES; i++ )
+    fs_handle_t *entry = __alloc_handle();
+
+    if( entry == 0 )
     {
-        if( handles[i].fileno == 0 )
-        {
-            /* Yes, we have room, try the open */
-            int mapping = __get_fs_link_by_name( file );
+        /* No file handles available */
+        errno = ENOMEM;
+        return -1;
+    }
 
-            if( mapping < 0 )
-            {
-                errno = ENOMEM;
-                return -1;
-            }
- 
-            void *ptr = fs->open( file + __strlen( filesystems[mapping].prefix ), flags );
+    /* Yes, we have room, try the open */
+    void *ptr = fs->open( file + filesystems[mapping].prefix_len, flags );
 
-            if( ptr )
-            {
-                /* Create new internal handle */
-                handles[i].fileno = __get_new_handle();
-                handles[i].handle = ptr;
-                handles[i].fs_mapping = mapping;
+    if( ptr )
+    {
+        /* Fill in the new internal handle */
+        entry->fs = fs;
+        entry->handle = ptr;
+        entry->fs_mapping = mapping;
 
-                /* Return our own handle */
-                return handles[i].fileno;
-            }
-            else
-            {
-                /* Couldn't open for some reason */
-                errno = EPERM;
-                return -1;
-            }
-        }
+        /* Return our own handle */
+        return entry->fileno;
+    }
+    else
+    {
+        /* Couldn't open for some reason */
+        __free_handle( entry );
+        errno = EPERM;
+        return -1;
     }
-
-    /* No file handles available */
-    errno = ENOMEM;
-    return -1;
 }
 
 /**
@@ -925,23 +1087,22 @@ int read( int file, char *ptr, int len )
     else
     {
         /* Read from file */
-        filesystem_t *fs = __get_fs_pointer_by_handle( file );
-        void *handle = __get_fs_handle( file );
+        fs_handle_t *entry = __get_handle( file );
 
-        if( fs == 0 )
+        if( entry == 0 )
         {
             errno = EINVAL;
             return -1;
         }
 
-        if( fs->read == 0 )
+        if( entry->fs->read == 0 )
         {
             /* Filesystem doesn't support read */
             errno = ENOSYS;
             return -1;
         }
 
-        return fs->read( handle, (uint8_t *)ptr, len );
+        return entry->fs->read( entry->handle, (uint8_t *)ptr, len );
     }
 }
 
@@ -966,6 +1127,63 @@ int readlink( const char *path, char *buf, size_t bufsize )
     return -1;
 }
 
+/** @brief Current end of the heap */
+static char *heap_end = 0;
+/** @brief Address the heap may not grow past */
+static char *heap_top = 0;
+
+/**
+ * @brief Set up the heap bounds on first use
+ *
+ * @note Must be called with interrupts disabled.
+ */
+static void __heap_init( void )
+{
+    extern char end; /* Set by linker.  */
+
+    if( heap_end == 0 )
+    {
+        heap_end = &end;
+        heap_top = (char*)0x80000000 + get_memory_size() - STACK_SIZE;
+    }
+}
+
+/**
+ * @brief Limit how far the heap may grow
+ *
+ * This keeps the heap used by malloc out of a range of memory at the top of
+ * RDRAM, so that it can be managed separately.  The limit can only be
+ * lowered.
+ *
+ * @param[in] limit
+ *            Address the heap may not grow past
+ *
+ * @retval 0 if the limit was set
+ * @retval -1 if the heap has already grown past the limit
+ */
+int sys_set_heap_limit( void *limit )
+{
+    int ret = 0;
+
+    disable_interrupts();
+
+    __heap_init();
+
+    if( (char *)limit < heap_end )
+    {
+        errno = ENOMEM;
+        ret = -1;
+    }
+    else if( (char *)limit < heap_top )
+    {
+        heap_top = limit;
+    }
+
+    enable_interrupts();
+
+    return ret;
+}
+
 /**
  * @brief Return a new chunk of memory to be used as heap
  *
@@ -976,20 +1194,11 @@ int readlink( const char *path, char *buf, size_t bufsize )
  */
 void *sbrk( int incr )
 {
-    extern char   end; /* Set by linker.  */
-    static char * heap_end = 0;
-    static char * heap_top = 0;
-    char *        prev_heap_end;
+    char *prev_heap_end;
 
     disable_interrupts();
 
-    if( heap_end == 0 )
-    {
-        int osMemSize = (__bootcic != 6105) ? (*(int*)0xA0000318) : (*(int*)0xA00003F0);
-
-        heap_end = &end;
-        heap_top = (char*)0x80000000 + osMemSize - STACK_SIZE;
-    }
+    __heap_init();
 
     prev_heap_end = heap_end;
     heap_end += incr;
@@ -1081,15 +1290,16 @@ clock_t times( struct tms *buf )
  */
 int unlink( char *name )
 {
-    filesystem_t *fs = __get_fs_pointer_by_name( name );
     int mapping = __get_fs_link_by_name( name );
 
-    if( fs == 0 || mapping < 0 )
+    if( mapping < 0 )
     {
         errno = EINVAL;
         return -1;
     }
 
+    filesystem_t *fs = filesystems[mapping].fs;
+
     if( fs->unlink == 0 )
     {
         /* Filesystem doesn't support unlink */
@@ -1098,7 +1308,7 @@ int unlink( char *name )
     }
 
     /* Must offset past the prefix */
-    return fs->unlink( name + __strlen( filesystems[mapping].prefix ) );
+    return fs->unlink( name + filesystems[mapping].prefix_len );
 }
 
 /**
@@ -1165,23 +1375,22 @@ int write( int file, char *ptr, int len )
     else
     {
         /* Filesystem write */
-        filesystem_t *fs = __get_fs_pointer_by_handle( file );
-        void *handle = __get_fs_handle( file );
+        fs_handle_t *entry = __get_handle( file );
 
-        if( fs == 0 )
+        if( entry == 0 )
         {
             errno = EINVAL;
             return -1;
         }
 
-        if( fs->write == 0 )
+        if( entry->fs->write == 0 )
         {
             /* Filesystem doesn't support write */
             errno = ENOSYS;
             return -1;
         }
 
-        return fs->write( handle, (uint8_t *)ptr, len );
+        return entry->fs->write( entry->handle, (uint8_t *)ptr, len );
     }
 }
 
@@ -1200,15 +1409,16 @@ int write( int file, char *ptr, int len )
  */
 int dir_findfirst( const char * const path, dir_t *dir )
 {
-    filesystem_t *fs = __get_fs_pointer_by_name( path );
     int mapping = __get_fs_link_by_name( path );
 
-    if( fs == 0 )
+    if( mapping < 0 )
     {
         errno = EINVAL;
         return -1;
     }
 
+    filesystem_t *fs = filesystems[mapping].fs;
+
     if( fs->findfirst == 0 )
     {
         /* Filesystem doesn't support findfirst */
@@ -1216,7 +1426,7 @@ int dir_findfirst( const char * const path, dir_t *dir )
         return -1;
     }
 
-    return fs->findfirst( (char *)path + + __strlen( filesystems[mapping].prefix ), dir );
+    return fs->findfirst( (char *)path + filesystems[mapping].prefix_len, dir );
 }
 
 /**
@@ -0,0 +1,957 @@
+/**
+ * @file thread.c
+ * @brief Threads
+ * @ingroup thread
+ */
+#include <malloc.h>
+#include <string.h>
+#include <reent.h>
+#include "libdragon.h"
+
+/**
+ * @defgroup thread Threads
+ * @ingroup libdragon
+ * @brief Lightweight prioritized threads with their own stacks.
+ *
+ * The thread subsystem allows code to be split into several threads of
+ * execution, each with its own stack, instead of hand-written state machines
+ * driven from the main loop.  A thread runs until it yields with
+ * #thread_yield, sleeps with #thread_sleep or #thread_sleep_until, waits on
+ * an event with #thread_event_wait or on a mutex with #thread_mutex_lock,
+ * exits, or is preempted.  Switching between threads from one of these calls
+ * only saves the registers preserved across function calls, so it costs
+ * little more than a function call.
+ *
+ * Each thread has a priority set with #thread_set_priority, and the highest
+ * priority thread able to run is always the one running.  When an interrupt
+ * handler makes a higher priority thread able to run, for example by
+ * signaling an event, the interrupted thread is preempted on the way out of
+ * the interrupt.  Threads of equal priority only take turns when they give up
+ * the CPU, unless a time slice is set with #thread_set_timeslice.  Sleeping
+ * threads are woken up at the first interrupt after their wake up time, so a
+ * time slice also bounds how late a sleeping thread wakes up.
+ *
+ * Mutexes implement priority inheritance: a thread holding a mutex runs at
+ * the priority of the highest priority thread waiting on it.  The time each
+ * thread spends running is accounted and can be read with
+ * #thread_get_cpu_ticks, and time spent with nothing to run with
+ * #thread_get_idle_ticks.  Time spent in interrupt handlers is counted
+ * against the interrupted thread.
+ *
+ * Before creating threads, code should call #thread_init from the main
+ * thread, which turns the caller into the first thread of the system.  New
+ * threads are created with #thread_create and start running the next time
+ * the current thread gives up the CPU.  When a thread returns from its entry
+ * point it is finished, but its stack is not freed until another thread
+ * calls #thread_join on it.  Sleeping is based on #timer_ticks_fast, so the
+ * @ref timer must be initialized before threads can sleep.
+ *
+ * Events are simple flags that can be signaled from anywhere, including
+ * interrupt handlers.  The DMA controller, the controller subsystem and the
+ * audio subsystem use them, or #thread_yield, to let other threads run while
+ * they wait on hardware instead of spinning.  If the calling code is not
+ * allowed to block, such as inside an interrupt handler, with interrupts
+ * disabled or before #thread_init, these calls return immediately so that
+ * code outside of threads keeps working as before.
+ *
+ * Each thread has its own newlib state, so errno and the standard streams
+ * are separate for each thread, and the heap is locked so that a thread is
+ * never preempted in the middle of malloc or free.  Newlib is built without
+ * locks on streams, though, so a FILE used from several threads, or files
+ * opened and closed from several threads at once, must be guarded with a
+ * mutex by the calling code.  Interrupt handlers and deferred work must not
+ * allocate memory or use stdio, as they may have interrupted a thread doing
+ * the same.
+ * @{
+ */
+
+/** @brief Internal linked list of threads */
+static thread_t *threads = 0;
+/** @brief Thread currently running */
+static thread_t *current = 0;
+/** @brief Context of the main thread */
+static thread_t main_thread;
+/** @brief Nonzero while waiting with no thread able to run */
+static volatile int idle = 0;
+/** @brief Nonzero once the current time slice is used up */
+static volatile int slice_expired = 0;
+/** @brief Timer used to end time slices */
+static timer_link_t *slice_timer = 0;
+/** @brief Tick count at the last thread switch */
+static long long last_switch_tick = 0;
+/** @brief Ticks spent with no thread able to run */
+static long long idle_ticks = 0;
+
+/** @brief Status register interrupt enable bit */
+#define SR_IE   0x00000001
+/** @brief Status register exception level bit */
+#define SR_EXL  0x00000002
+
+/* Defined in thread_switch.S */
+extern void __thread_switch( thread_context_t *from, thread_context_t *to );
+extern void __thread_preempt( void );
+
+/**
+ * @brief Return the ticks elapsed since the last thread switch
+ *
+ * The count register wraps when the timer subsystem isn't running, so
+ * only the low 32 bits are trusted.  Threads never run for long enough
+ * without a switch for this to matter.
+ *
+ * @param[in] now
+ *            Current tick count
+ *
+ * @return Ticks elapsed since the last switch
+ */
+static inline long long __thread_elapsed( long long now )
+{
+    return (uint32_t)(now - last_switch_tick);
+}
+
+/**
+ * @brief Return whether a thread is able to run
+ *
+ * @param[in] thread
+ *            Thread to check
+ * @param[in] now
+ *            Current tick count
+ *
+ * @return Nonzero if the thread can be switched to
+ */
+static int __thread_runnable( thread_t *thread, long long now )
+{
+    switch( thread->state )
+    {
+        case THREAD_STATE_READY:
+        case THREAD_STATE_RUNNING:
+            return 1;
+        case THREAD_STATE_SLEEPING:
+            return now >= thread->wake_tick;
+        case THREAD_STATE_WAITING:
+            return thread->event->signaled;
+        case THREAD_STATE_LOCKING:
+            return thread->mutex->owner == 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Pick the next thread to run
+ *
+ * The highest priority thread able to run is picked.  Threads of equal
+ * priority are picked round robin, starting after the current thread so
+ * that the current thread is only picked again if nothing else can run.
+ *
+ * @return The next thread to run or null if no thread is able to run
+ */
+static thread_t *__thread_pick( void )
+{
+    long long now = timer_ticks_fast();
+    thread_t *best = 0;
+    thread_t *thread = current->next ? current->next : threads;
+
+    for( ;; )
+    {
+        if( __thread_runnable( thread, now ) )
+        {
+            if( !best || thread->priority > best->priority ) { best = thread; }
+        }
+
+        if( thread == current ) { return best; }
+
+        thread = thread->next ? thread->next : threads;
+    }
+}
+
+/**
+ * @brief Switch to the next thread able to run
+ *
+ * @note Must be called with interrupts disabled exactly once.  If no thread
+ *       can run, interrupts are briefly enabled in a loop until one can.
+ */
+static void __thread_schedule( void )
+{
+    thread_t *prev = current;
+    thread_t *next;
+    long long now = timer_ticks_fast();
+
+    /* Account the time slice that just ended */
+    prev->cpu_ticks += __thread_elapsed( now );
+    last_switch_tick = now;
+
+    if( !(next = __thread_pick()) )
+    {
+        idle = 1;
+
+        while( !(next = __thread_pick()) )
+        {
+            /* Nothing to do, give interrupts a chance to wake somebody up */
+            enable_interrupts();
+            disable_interrupts();
+        }
+
+        idle = 0;
+
+        now = timer_ticks_fast();
+        idle_ticks += __thread_elapsed( now );
+        last_switch_tick = now;
+    }
+
+    next->state = THREAD_STATE_RUNNING;
+    slice_expired = 0;
+
+    if( next != prev )
+    {
+        current = next;
+        _impure_ptr = next->reent;
+        __thread_switch( &prev->ctx, &next->ctx );
+    }
+}
+
+/**
+ * @brief Return whether a higher priority thread is able to run
+ *
+ * @note Must be called with interrupts disabled.
+ *
+ * @return Nonzero if the current thread should give up the CPU
+ */
+static int __thread_should_switch( void )
+{
+    thread_t *next = __thread_pick();
+
+    if( !next || next == current ) { return 0; }
+    if( next->priority > current->priority ) { return 1; }
+
+    return next->priority == current->priority && slice_expired;
+}
+
+/**
+ * @brief Check for preemption on the way out of an interrupt
+ *
+ * Called by the interrupt handler after all handlers have run.  If the
+ * interrupted thread should give up the CPU, the handler returns into
+ * #__thread_preempt instead, which saves the rest of the registers on the
+ * stack of the interrupted thread and calls #__thread_preempt_yield.
+ *
+ * @param[in] epc
+ *            Address the interrupted thread was running at
+ *
+ * @return The address to return to from the interrupt or 0 to return normally
+ */
+uint32_t __thread_irq_exit( uint32_t epc )
+{
+    /* Never preempt the idle loop or a thread already on its way out */
+    if( !current || idle || current->preempted ) { return 0; }
+    if( get_interrupts_state() != INTERRUPTS_ENABLED ) { return 0; }
+    if( !__thread_should_switch() ) { return 0; }
+
+    /* Switch once the thread leaves the section it can't be preempted in */
+    if( current->preempt_disable )
+    {
+        current->preempt_deferred = 1;
+        return 0;
+    }
+
+    current->preempted = 1;
+    current->preempt_epc = epc;
+
+    return (uint32_t)__thread_preempt;
+}
+
+/**
+ * @brief Give up the CPU after being preempted
+ *
+ * Called by #__thread_preempt in the context of the preempted thread.
+ *
+ * @return The address the thread was interrupted at
+ */
+uint32_t __thread_preempt_yield( void )
+{
+    uint32_t epc;
+
+    disable_interrupts();
+
+    current->state = THREAD_STATE_READY;
+    __thread_schedule();
+
+    epc = current->preempt_epc;
+    current->preempted = 0;
+
+    enable_interrupts();
+
+    return epc;
+}
+
+/**
+ * @brief Switch away if a higher priority thread became able to run
+ *
+ * @note Must be called with interrupts disabled exactly once.
+ */
+static void __thread_reschedule( void )
+{
+    if( __thread_should_switch() )
+    {
+        current->state = THREAD_STATE_READY;
+        __thread_schedule();
+    }
+}
+
+/**
+ * @brief Keep the current thread from being preempted
+ *
+ * The thread may still give up the CPU by itself.  Calls nest, and each
+ * must be matched by a call to #__thread_preempt_enable.
+ */
+void __thread_preempt_disable( void )
+{
+    if( current ) { current->preempt_disable++; }
+}
+
+/**
+ * @brief Allow the current thread to be preempted again
+ *
+ * If a preemption was put off meanwhile, it happens now.
+ */
+void __thread_preempt_enable( void )
+{
+    if( !current || !current->preempt_disable ) { return; }
+    if( --current->preempt_disable || !current->preempt_deferred ) { return; }
+
+    current->preempt_deferred = 0;
+
+    if( thread_can_block() )
+    {
+        disable_interrupts();
+        __thread_reschedule();
+        enable_interrupts();
+    }
+}
+
+/**
+ * @brief Lock the heap for newlib
+ *
+ * Newlib calls this around every heap operation, nested when one calls
+ * another.  Keeping the thread from being preempted is enough, as the
+ * allocator never blocks.
+ *
+ * @param[in] r
+ *            Newlib state of the caller
+ */
+void __malloc_lock( struct _reent *r )
+{
+    __thread_preempt_disable();
+}
+
+/**
+ * @brief Unlock the heap for newlib
+ *
+ * @param[in] r
+ *            Newlib state of the caller
+ */
+void __malloc_unlock( struct _reent *r )
+{
+    __thread_preempt_enable();
+}
+
+/**
+ * @brief Compute the priority a thread should run at
+ *
+ * This is the priority set for the thread, raised to the priority of any
+ * thread waiting on a mutex it holds.
+ *
+ * @param[in] thread
+ *            Thread to compute the priority of
+ *
+ * @return The effective priority of the thread
+ */
+static int __thread_effective_priority( thread_t *thread )
+{
+    int priority = thread->base_priority;
+
+    for( thread_t *waiter = threads; waiter; waiter = waiter->next )
+    {
+        if( waiter->state == THREAD_STATE_LOCKING &&
+            waiter->mutex->owner == thread &&
+            waiter->priority > priority )
+        {
+            priority = waiter->priority;
+        }
+    }
+
+    return priority;
+}
+
+/**
+ * @brief Lend a priority to the holder of a mutex
+ *
+ * The priority is passed down the chain of mutex holders in case the
+ * holder is itself waiting on another mutex.
+ *
+ * @param[in] owner
+ *            Thread holding the mutex
+ * @param[in] priority
+ *            Priority of the thread waiting on the mutex
+ */
+static void __thread_inherit_priority( thread_t *owner, int priority )
+{
+    while( owner && owner->priority < priority )
+    {
+        owner->priority = priority;
+
+        if( owner->state != THREAD_STATE_LOCKING ) { break; }
+
+        owner = owner->mutex->owner;
+    }
+}
+
+/**
+ * @brief First code run by a newly created thread
+ *
+ * The context switch returns here the first time a thread is switched to.
+ * It finishes the critical section started by the thread that switched
+ * away, then calls the entry point.
+ */
+static void __thread_start( void )
+{
+    enable_interrupts();
+
+    current->entry( current->arg );
+
+    thread_exit();
+}
+
+/**
+ * @brief Initialize the thread subsystem
+ *
+ * The calling code becomes the main thread.  It keeps running on the stack
+ * set up at boot.
+ */
+void thread_init( void )
+{
+    if( current ) { return; }
+
+    disable_interrupts();
+
+    main_thread.state = THREAD_STATE_RUNNING;
+    main_thread.priority = THREAD_PRIORITY_DEFAULT;
+    main_thread.base_priority = THREAD_PRIORITY_DEFAULT;
+    main_thread.stack = 0;
+    main_thread.reent = _impure_ptr;
+    main_thread.next = 0;
+
+    threads = &main_thread;
+    current = &main_thread;
+    last_switch_tick = timer_ticks_fast();
+
+    enable_interrupts();
+}
+
+/**
+ * @brief Create a new thread and add it to the list
+ *
+ * The new thread is ready to run at #THREAD_PRIORITY_DEFAULT, and starts
+ * the next time the scheduler runs.  Use #thread_set_priority to change
+ * its priority.
+ *
+ * @param[in] entry
+ *            Function to run in the new thread
+ * @param[in] arg
+ *            Argument to pass to the entry point
+ * @param[in] stack_size
+ *            Size in bytes of the stack of the new thread.  Pass 0 to use
+ *            #THREAD_DEFAULT_STACK_SIZE.
+ *
+ * @return A pointer to the thread structure created or null on error
+ */
+thread_t *thread_create( void (*entry)(void *arg), void *arg, int stack_size )
+{
+    if( !current || !entry ) { return 0; }
+
+    if( stack_size == 0 ) { stack_size = THREAD_DEFAULT_STACK_SIZE; }
+    if( stack_size < THREAD_MIN_STACK_SIZE ) { stack_size = THREAD_MIN_STACK_SIZE; }
+
+    /* Keep the stack pointer 16 byte aligned as the ABI expects */
+    stack_size = (stack_size + 15) & ~15;
+
+    thread_t *thread = memalign( 8, sizeof(thread_t) );
+    void *stack = memalign( 16, stack_size );
+    struct _reent *reent = malloc( sizeof(struct _reent) );
+
+    if( !thread || !stack || !reent )
+    {
+        free( thread );
+        free( stack );
+        free( reent );
+        return 0;
+    }
+
+    memset( thread, 0, sizeof(thread_t) );
+    _REENT_INIT_PTR( reent );
+    thread->reent = reent;
+    thread->entry = entry;
+    thread->arg = arg;
+    thread->stack = stack;
+    thread->stack_size = stack_size;
+    thread->state = THREAD_STATE_READY;
+    thread->priority = THREAD_PRIORITY_DEFAULT;
+    thread->base_priority = THREAD_PRIORITY_DEFAULT;
+
+    /* Leave room for the argument save area of the first call */
+    uint32_t top = (uint32_t)stack + stack_size - 32;
+    uint32_t gp;
+
+    asm volatile("move %0,$28" : "=r"(gp));
+
+    /* Pointers must be sign extended to be valid 64-bit kernel addresses */
+    thread->ctx.sp = (int64_t)(int32_t)top;
+    thread->ctx.fp = (int64_t)(int32_t)top;
+    thread->ctx.gp = (int64_t)(int32_t)gp;
+    thread->ctx.ra = (int64_t)(int32_t)(uint32_t)__thread_start;
+
+    disable_interrupts();
+
+    thread->next = threads;
+    threads = thread;
+
+    enable_interrupts();
+
+    return thread;
+}
+
+/**
+ * @brief Return the currently running thread
+ *
+ * @return The running thread or null if the thread subsystem isn't initialized
+ */
+thread_t *thread_self( void )
+{
+    return current;
+}
+
+/**
+ * @brief Return whether the calling code is allowed to block
+ *
+ * Blocking is only possible from a thread running with interrupts enabled.
+ * Interrupt handlers and critical sections must never switch threads.
+ *
+ * @return Nonzero if the calling code may block or 0 otherwise
+ */
+int thread_can_block( void )
+{
+    uint32_t sr;
+
+    if( !current ) { return 0; }
+    if( get_interrupts_state() != INTERRUPTS_ENABLED ) { return 0; }
+    if( in_interrupt() ) { return 0; }
+
+    asm volatile("mfc0 %0,$12" : "=r"(sr));
+
+    return (sr & (SR_EXL | SR_IE)) == SR_IE;
+}
+
+/**
+ * @brief Let other threads run
+ *
+ * Gives threads of equal priority a turn.  If no other thread of equal or
+ * higher priority is able to run, this returns immediately.
+ *
+ * @note Has no effect if the calling code is not allowed to block.
+ */
+void thread_yield( void )
+{
+    if( !thread_can_block() ) { return; }
+
+    disable_interrupts();
+
+    current->state = THREAD_STATE_READY;
+    __thread_schedule();
+
+    enable_interrupts();
+}
+
+/**
+ * @brief Sleep until the timer reaches a tick count
+ *
+ * @note If the calling code is not allowed to block, this spins instead.
+ *
+ * @param[in] tick
+ *            Tick count, as returned by #timer_ticks_fast, to wake up at
+ */
+void thread_sleep_until( long long tick )
+{
+    if( !thread_can_block() )
+    {
+        while( timer_ticks_fast() < tick ) ;
+        return;
+    }
+
+    disable_interrupts();
+
+    current->wake_tick = tick;
+    current->state = THREAD_STATE_SLEEPING;
+    __thread_schedule();
+
+    enable_interrupts();
+}
+
+/**
+ * @brief Sleep for a number of ticks
+ *
+ * @param[in] ticks
+ *            Number of ticks to sleep for.  See #TIMER_TICKS.
+ */
+void thread_sleep( long long ticks )
+{
+    thread_sleep_until( timer_ticks_fast() + ticks );
+}
+
+/**
+ * @brief End the current thread
+ *
+ * This is called automatically when a thread returns from its entry point.
+ * The stack of the thread is freed by #thread_join.
+ *
+ * @note Calling this from the main thread hangs, as there is always
+ *       something left waiting to run.
+ */
+void thread_exit( void )
+{
+    disable_interrupts();
+
+    current->state = THREAD_STATE_FINISHED;
+    __thread_schedule();
+
+    /* Never gets here */
+    for( ;; ) ;
+}
+
+/**
+ * @brief Wait for a thread to finish and free it
+ *
+ * @param[in] thread
+ *            Thread to wait for.  Must not be the main or calling thread.
+ */
+void thread_join( thread_t *thread )
+{
+    if( !thread || thread == current || thread == &main_thread ) { return; }
+
+    while( thread->state != THREAD_STATE_FINISHED )
+    {
+        thread_yield();
+    }
+
+    disable_interrupts();
+
+    /* Remove from list */
+    thread_t **link = &threads;
+    while( *link && *link != thread ) { link = &(*link)->next; }
+    if( *link ) { *link = thread->next; }
+
+    enable_interrupts();
+
+    /* Flushes and closes the streams the thread left open */
+    _reclaim_reent( thread->reent );
+
+    free( thread->reent );
+    free( thread->stack );
+    free( thread );
+}
+
+/**
+ * @brief Initialize an event
+ *
+ * @param[out] event
+ *             Event to initialize as not signaled
+ */
+void thread_event_init( thread_event_t *event )
+{
+    event->signaled = 0;
+}
+
+/**
+ * @brief Signal an event
+ *
+ * Any thread waiting on the event will be able to run.  Safe to call from
+ * interrupt handlers.
+ *
+ * @param[in] event
+ *            Event to signal
+ */
+void thread_event_signal( thread_event_t *event )
+{
+    event->signaled = 1;
+}
+
+/**
+ * @brief Clear an event without waiting for it
+ *
+ * @param[in] event
+ *            Event to clear
+ */
+void thread_event_clear( thread_event_t *event )
+{
+    event->signaled = 0;
+}
+
+/**
+ * @brief Wait for an event to be signaled
+ *
+ * The event is cleared again before returning.  Code that must keep
+ * working outside of threads should recheck its condition in a loop, as
+ * this returns immediately when the calling code is not allowed to block.
+ *
+ * @param[in] event
+ *            Event to wait on
+ *
+ * @retval 0 if the event was signaled
+ * @retval -1 if the calling code is not allowed to block
+ */
+int thread_event_wait( thread_event_t *event )
+{
+    if( !thread_can_block() ) { return -1; }
+
+    disable_interrupts();
+
+    while( !event->signaled )
+    {
+        current->event = event;
+        current->state = THREAD_STATE_WAITING;
+        __thread_schedule();
+    }
+
+    event->signaled = 0;
+    current->event = 0;
+
+    enable_interrupts();
+
+    return 0;
+}
+
+/**
+ * @brief Change the priority of a thread
+ *
+ * If this makes a higher priority thread able to run than the calling
+ * thread, the calling thread gives up the CPU.
+ *
+ * @param[in] thread
+ *            Thread to change
+ * @param[in] priority
+ *            New priority, between #THREAD_PRIORITY_MIN and #THREAD_PRIORITY_MAX
+ */
+void thread_set_priority( thread_t *thread, int priority )
+{
+    if( !thread ) { return; }
+
+    if( priority < THREAD_PRIORITY_MIN ) { priority = THREAD_PRIORITY_MIN; }
+    if( priority > THREAD_PRIORITY_MAX ) { priority = THREAD_PRIORITY_MAX; }
+
+    disable_interrupts();
+
+    thread->base_priority = priority;
+    thread->priority = __thread_effective_priority( thread );
+
+    if( thread->state == THREAD_STATE_LOCKING )
+    {
+        __thread_inherit_priority( thread->mutex->owner, thread->priority );
+    }
+
+    enable_interrupts();
+
+    if( thread_can_block() )
+    {
+        disable_interrupts();
+        __thread_reschedule();
+        enable_interrupts();
+    }
+}
+
+/**
+ * @brief Return the priority set for a thread
+ *
+ * @param[in] thread
+ *            Thread to query
+ *
+ * @return The priority set with #thread_set_priority, not including any
+ *         priority inherited through a mutex
+ */
+int thread_get_priority( thread_t *thread )
+{
+    return thread ? thread->base_priority : THREAD_PRIORITY_DEFAULT;
+}
+
+/**
+ * @brief Callback ending the current time slice
+ *
+ * @param[in] ovfl
+ *            Unused
+ */
+static void __thread_slice_callback( int ovfl )
+{
+    slice_expired = 1;
+}
+
+/**
+ * @brief Set the time slice for threads of equal priority
+ *
+ * When set, a thread is preempted in favor of another thread of the same
+ * priority once it has run for a time slice.  This uses a continuous timer,
+ * so the @ref timer must be initialized.
+ *
+ * @param[in] ticks
+ *            Length of a time slice in ticks, or 0 to only switch between
+ *            threads of equal priority when they give up the CPU.
+ */
+void thread_set_timeslice( int ticks )
+{
+    if( slice_timer )
+    {
+        delete_timer( slice_timer );
+        slice_timer = 0;
+    }
+
+    slice_expired = 0;
+
+    if( ticks > 0 )
+    {
+        slice_timer = new_timer( ticks, TF_CONTINUOUS, __thread_slice_callback );
+    }
+}
+
+/**
+ * @brief Return the ticks a thread has spent running
+ *
+ * @param[in] thread
+ *            Thread to query
+ *
+ * @return Number of ticks the thread has spent running, including the
+ *         time spent in interrupt handlers while it was running
+ */
+long long thread_get_cpu_ticks( thread_t *thread )
+{
+    long long ticks;
+
+    if( !thread ) { return 0; }
+
+    disable_interrupts();
+
+    ticks = thread->cpu_ticks;
+
+    if( thread == current && !idle )
+    {
+        ticks += __thread_elapsed( timer_ticks_fast() );
+    }
+
+    enable_interrupts();
+
+    return ticks;
+}
+
+/**
+ * @brief Return the ticks spent with no thread able to run
+ *
+ * @return Number of ticks spent idle since #thread_init
+ */
+long long thread_get_idle_ticks( void )
+{
+    return idle_ticks;
+}
+
+/**
+ * @brief Initialize a mutex
+ *
+ * @param[out] mutex
+ *             Mutex to initialize as unlocked
+ */
+void thread_mutex_init( thread_mutex_t *mutex )
+{
+    mutex->owner = 0;
+}
+
+/**
+ * @brief Lock a mutex
+ *
+ * If another thread holds the mutex, the calling thread waits until it is
+ * unlocked, lending its priority to the holder in the meantime.
+ *
+ * @note Mutexes are not recursive and must not be used from interrupt
+ *       handlers.  Outside of threads this has no effect.
+ *
+ * @param[in] mutex
+ *            Mutex to lock
+ */
+void thread_mutex_lock( thread_mutex_t *mutex )
+{
+    if( !thread_can_block() ) { return; }
+
+    disable_interrupts();
+
+    while( mutex->owner )
+    {
+        __thread_inherit_priority( mutex->owner, current->priority );
+
+        current->mutex = mutex;
+        current->state = THREAD_STATE_LOCKING;
+        __thread_schedule();
+    }
+
+    mutex->owner = current;
+    current->mutex = 0;
+
+    enable_interrupts();
+}
+
+/**
+ * @brief Lock a mutex if it is not held by another thread
+ *
+ * @param[in] mutex
+ *            Mutex to lock
+ *
+ * @retval 0 if the mutex was locked
+ * @retval -1 if the mutex is held by another thread
+ */
+int thread_mutex_trylock( thread_mutex_t *mutex )
+{
+    int ret = -1;
+
+    if( !current ) { return 0; }
+
+    disable_interrupts();
+
+    if( !mutex->owner )
+    {
+        mutex->owner = current;
+        ret = 0;
+    }
+
+    enable_interrupts();
+
+    return ret;
+}
+
+/**
+ * @brief Unlock a mutex
+ *
+ * Drops any priority inherited through the mutex.  If a higher priority
+ * thread was waiting on it, that thread runs right away.
+ *
+ * @param[in] mutex
+ *            Mutex held by the calling thread
+ */
+void thread_mutex_unlock( thread_mutex_t *mutex )
+{
+    int can_block = thread_can_block();
+
+    if( !current || mutex->owner != current ) { return; }
+
+    disable_interrupts();
+
+    mutex->owner = 0;
+    current->priority = __thread_effective_priority( current );
+
+    if( can_block ) { __thread_reschedule(); }
+
+    enable_interrupts();
+}
+
+/** @} */
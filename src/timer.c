@@ -34,7 +34,7 @@
 /** @brief Internal linked list of timers */
 static timer_link_t *TI_timers = 0;
 /** @brief Total ticks elapsed since timer subsystem initialization */
-static long long total_ticks;
+static volatile long long total_ticks;
 
 /**
  * @brief Read the count out of the count register
@@ -61,6 +61,27 @@ static long long total_ticks;
  */
 #define write_compare(x) asm volatile("mtc0 %0,$11\n\t nop \n\t" :  : "r" (x) )
 
+/**
+ * @brief Move the ticks counted so far into the total
+ *
+ * The count register is rebased by the amount moved rather than cleared,
+ * so ticks counted meanwhile are not lost and #timer_ticks_fast never
+ * counts a tick twice.  Must be called with interrupts disabled.
+ *
+ * @return The number of ticks moved into the total
+ */
+static int __fold_count(void)
+{
+	int start, now;
+
+	read_count(start);
+	total_ticks += start;
+	read_count(now);
+	write_count(now - start);
+
+	return start;
+}
+
 /**
  * @brief Process linked list of timers
  *
@@ -82,8 +103,8 @@ static int __proc_timers(timer_link_t * head)
     int smallest = 0x3FFFFFFF;			// ~ 22.9 secs
 	int start, now;
 
-	read_count(start);
-	total_ticks += start;
+	/* from here on, the count is the time spent processing the list */
+	start = __fold_count();
 
     while (head)
     {
@@ -127,15 +148,11 @@ static int __proc_timers(timer_link_t * head)
 
 	/* check if shortest time left < 5us */
 	read_count(now);
-	if (smallest < (now - start + 234))
-	{
-		total_ticks += (now - start);
-		write_count(now - start);
+	if (smallest < (now + 234))
 		return 1;						// reprocess the list
-	}
-	/* set compare to shortest time left */
-	write_count(0);
-	write_compare(smallest - (now - start));
+
+	/* set compare to shortest time left, counted from start */
+	write_compare(smallest);
 	return 0;							// exit timer callback
 }
 
@@ -147,18 +164,19 @@ static int __proc_timers(timer_link_t * head)
  */
 static void timer_callback(void)
 {
+	trace_begin( TRACE_ID_TIMER );
+
 	if (TI_timers)
 	{
 		while (__proc_timers(TI_timers)) ;
 	}
 	else
 	{
-		int now;
-		read_count(now);
-		total_ticks += now;
-		write_count(0);
+		__fold_count();
 		write_compare(0x7FFFFFFF);
 	}
+
+	trace_end( TRACE_ID_TIMER );
 }
 
 /**
@@ -201,7 +219,7 @@ timer_link_t *new_timer(int ticks, int flags, void (*callback)(int ovfl))
 		if (timer->next == 0)
 		{
 			/* first timer added to list */
-			write_count(0);
+			__fold_count();
 			write_compare(timer->left);
 		}
 		else
@@ -240,7 +258,7 @@ void start_timer(timer_link_t *timer, int ticks, int flags, void (*callback)(int
 		if (timer->next == 0)
 		{
 			/* first timer added to list */
-			write_count(0);
+			__fold_count();
 			write_compare(timer->left);
 		}
 		else
@@ -351,4 +369,30 @@ long long timer_ticks(void)
 	return total_ticks;
 }
 
+/**
+ * @brief Return total ticks since timer was initialized without processing timers
+ *
+ * Unlike #timer_ticks, this does not walk the timer list or touch the
+ * interrupt state, so it is cheap enough to call from schedulers,
+ * interrupt handlers and timer callbacks.  The timer interrupt moves the
+ * count register into the accumulated total, so the value is built from the
+ * total plus the current count, retrying if a timer interrupt lands between
+ * the two reads.
+ *
+ * @return The number of ticks since the timer was initialized
+ */
+long long timer_ticks_fast(void)
+{
+	long long base;
+	unsigned int now;
+
+	do
+	{
+		base = total_ticks;
+		read_count(now);
+	} while (base != total_ticks);
+
+	return base + now;
+}
+
 /** @} */
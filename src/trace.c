@@ -0,0 +1,311 @@
+/**
+ * @file trace.c
+ * @brief Event Tracing
+ * @ingroup trace
+ */
+#include <malloc.h>
+#include <string.h>
+#include "libdragon.h"
+
+/**
+ * @defgroup trace Event Tracing
+ * @ingroup libdragon
+ * @brief Timeline recording of sections, counters and hardware events.
+ *
+ * The trace recorder stores timestamped events in a ring in RAM, so the
+ * structure of a frame can be looked at afterwards: which CPU sections ran
+ * when, when display lists went to the RDP, when DMA transfers and audio
+ * and timer interrupts happened.
+ *
+ * Set the recorder up with #trace_init and start recording with
+ * #trace_start.  Sections are marked with #trace_begin and #trace_end,
+ * counters with #trace_counter and single points in time with
+ * #trace_instant.  Events are identified by a name ID, either one of the
+ * TRACE_ID values used by libdragon itself, or one returned by
+ * #trace_register.  The #TRACE_ID macro registers a name the first time it
+ * runs and remembers the ID.  While not recording, each call costs a
+ * single load and branch.
+ *
+ * Each event takes 12 bytes and is stamped with the timer tick count,
+ * which is CP0 Count corrected for the resets done by the timer module.
+ * When the ring is full the oldest events are overwritten, so it always
+ * holds the latest stretch of time.  #trace_dump writes the names and
+ * events into a buffer, which can then be stored on save media, and
+ * #trace_dump_usb sends the same data over 64drive USB.  The trace2json
+ * tool converts a dump into Chrome trace JSON, which can be opened in
+ * chrome://tracing or Perfetto.
+ * @{
+ */
+
+/** @brief Largest piece of a dump sent over USB at once */
+#define USB_CHUNK       (64 * 1024)
+
+/** @brief Nonzero while events are being recorded */
+volatile int __trace_active = 0;
+
+/** @brief Ring of recorded events */
+static trace_event_t *events = 0;
+/** @brief Number of events in the ring, a power of two */
+static uint32_t num_events = 0;
+/** @brief Number of events recorded since the last reset */
+static uint32_t next_event = 0;
+/** @brief Registered event names */
+static const char *names[TRACE_MAX_NAMES] = {
+    [TRACE_ID_VBLANK] = "vblank",
+    [TRACE_ID_DISPLAY_SHOW] = "display_show",
+    [TRACE_ID_RDP_SUBMIT] = "rdp_submit",
+    [TRACE_ID_RDP_SYNC] = "rdp_sync_full",
+    [TRACE_ID_AUDIO] = "audio",
+    [TRACE_ID_DMA_READ] = "dma_read",
+    [TRACE_ID_DMA_WRITE] = "dma_write",
+    [TRACE_ID_TIMER] = "timer",
+};
+/** @brief Number of entries used in #names */
+static int num_names = TRACE_ID_FIRST_USER;
+
+/**
+ * @brief Set up the trace recorder
+ *
+ * @param[in] count
+ *            Number of events to keep, rounded up to a power of two, or 0
+ *            for #TRACE_DEFAULT_EVENTS
+ *
+ * @retval 0 on success
+ * @retval -1 if the ring could not be allocated
+ */
+int trace_init( int count )
+{
+    uint32_t rounded = 1;
+
+    trace_close();
+
+    if( count <= 0 ) { count = TRACE_DEFAULT_EVENTS; }
+    while( rounded < count ) { rounded <<= 1; }
+
+    events = malloc( rounded * sizeof(trace_event_t) );
+    if( !events ) { return -1; }
+
+    num_events = rounded;
+    next_event = 0;
+
+    return 0;
+}
+
+/**
+ * @brief Stop recording and free the event ring
+ */
+void trace_close( void )
+{
+    __trace_active = 0;
+
+    if( events )
+    {
+        free( events );
+        events = 0;
+        num_events = 0;
+    }
+}
+
+/**
+ * @brief Start recording events
+ */
+void trace_start( void )
+{
+    if( events ) { __trace_active = 1; }
+}
+
+/**
+ * @brief Stop recording events, keeping the ones recorded so far
+ */
+void trace_stop( void )
+{
+    __trace_active = 0;
+}
+
+/**
+ * @brief Forget all recorded events
+ */
+void trace_reset( void )
+{
+    uint32_t state = interrupt_disable_save();
+    next_event = 0;
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Register an event name
+ *
+ * Registering the same name again returns the same ID.
+ *
+ * @param[in] name
+ *            Name of the event, which must stay valid while tracing
+ *
+ * @return The ID of the name, or -1 if there are too many names
+ */
+int trace_register( const char *name )
+{
+    int id = -1;
+    uint32_t state = interrupt_disable_save();
+
+    for( int i = 0; i < num_names; i++ )
+    {
+        if( !strcmp( names[i], name ) ) { id = i; break; }
+    }
+
+    if( id < 0 && num_names < TRACE_MAX_NAMES )
+    {
+        id = num_names++;
+        names[id] = name;
+    }
+
+    interrupt_restore( state );
+
+    return id;
+}
+
+/**
+ * @brief Record an event
+ *
+ * Use #trace_begin, #trace_end, #trace_counter and #trace_instant instead,
+ * which skip the call while not recording.
+ *
+ * @param[in] type
+ *            A #trace_event_type_t
+ * @param[in] id
+ *            Event ID
+ * @param[in] value
+ *            Counter value or argument
+ */
+void __trace_record( int type, int id, int value )
+{
+    int nest = in_interrupt();
+    uint32_t state = interrupt_disable_save();
+
+    if( events && __trace_active )
+    {
+        trace_event_t *ev = &events[next_event & (num_events - 1)];
+
+        ev->time = (uint32_t)timer_ticks_fast();
+        ev->id = id;
+        ev->type = type;
+        ev->track = nest < 255 ? nest : 255;
+        ev->value = value;
+
+        next_event++;
+    }
+
+    interrupt_restore( state );
+}
+
+/**
+ * @brief Return the size in bytes of a dump of the current events
+ */
+int trace_dump_size( void )
+{
+    uint32_t count = next_event < num_events ? next_event : num_events;
+
+    return sizeof(trace_header_t) + num_names * TRACE_NAME_LEN + count * sizeof(trace_event_t);
+}
+
+/**
+ * @brief Write the recorded events into a buffer
+ *
+ * Recording is paused while the events are copied.  If the buffer is too
+ * small, only the newest events that fit are written.
+ *
+ * @param[out] buf
+ *             Buffer to write the dump to, 4 byte aligned
+ * @param[in]  size
+ *             Size of the buffer in bytes
+ *
+ * @return The number of bytes written, or -1 if not even the names fit
+ */
+int trace_dump( void *buf, int size )
+{
+    trace_header_t *header = buf;
+    int fixed = sizeof(trace_header_t) + num_names * TRACE_NAME_LEN;
+
+    if( !events || size < fixed ) { return -1; }
+
+    int was_active = __trace_active;
+    __trace_active = 0;
+
+    uint32_t count = next_event < num_events ? next_event : num_events;
+    uint32_t fit = (size - fixed) / sizeof(trace_event_t);
+    if( count > fit ) { count = fit; }
+
+    header->magic = TRACE_MAGIC;
+    header->version = TRACE_VERSION;
+    header->event_size = sizeof(trace_event_t);
+    header->ticks_per_second = COUNTS_PER_SECOND;
+    header->num_names = num_names;
+    header->num_events = count;
+    header->overwritten = next_event - count;
+
+    char *name = (char *)(header + 1);
+
+    for( int i = 0; i < num_names; i++, name += TRACE_NAME_LEN )
+    {
+        memset( name, 0, TRACE_NAME_LEN );
+        strncpy( name, names[i], TRACE_NAME_LEN - 1 );
+    }
+
+    /* Oldest first, only the newest that fit */
+    trace_event_t *out = (trace_event_t *)name;
+
+    for( uint32_t i = next_event - count; i != next_event; i++ )
+    {
+        *out++ = events[i & (num_events - 1)];
+    }
+
+    __trace_active = was_active;
+
+    return fixed + count * sizeof(trace_event_t);
+}
+
+/**
+ * @brief Send the recorded events over 64drive USB
+ *
+ * The dump has the same format as #trace_dump and is sent as binary data.
+ * This waits for every transfer, so it should not be called in the middle
+ * of a frame that is being measured.
+ *
+ * @retval 0 on success
+ * @retval -1 if there is nothing to send or no memory for the dump
+ */
+int trace_dump_usb( void )
+{
+    int size = trace_dump_size();
+    uint8_t *buf = memalign( 8, size );
+
+    if( !buf ) { return -1; }
+
+    size = trace_dump( buf, size );
+
+    if( size < 0 )
+    {
+        free( buf );
+        return -1;
+    }
+
+    _64Drive_rom_writable( 1 );
+
+    for( int sent = 0; sent < size; )
+    {
+        int part = size - sent;
+        if( part > USB_CHUNK ) { part = USB_CHUNK; }
+
+        /* Nonzero once the transfer could be started */
+        while( !_64Drive_usb_write_data( buf + sent, part, USB_DATATYPE_BINARY ) ) { }
+
+        sent += part;
+    }
+
+    /* Don't return while the host is still receiving */
+    _64Drive_usb_spin_write();
+    free( buf );
+
+    return 0;
+}
+
+/** @} */
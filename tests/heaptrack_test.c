@@ -0,0 +1,416 @@
+/**
+ * @file heaptrack_test.c
+ * @brief Host tests for the heap tracker
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "heaptrack.h"
+#include "test.h"
+
+/** @brief Report lines captured from the tracker */
+static char output[32768];
+/** @brief Length of the captured report */
+static int output_len;
+
+static void capture( char *line )
+{
+    int len = strlen( line );
+
+    if( output_len + len < sizeof(output) )
+    {
+        memcpy( output + output_len, line, len + 1 );
+        output_len += len;
+    }
+}
+
+static void clear_output( void )
+{
+    output[0] = 0;
+    output_len = 0;
+}
+
+/**
+ * @brief Return whether a histogram section of the report has a bar
+ *
+ * The section starts at a heading and runs to the next line that isn't
+ * indented, so the same label in another histogram doesn't match.
+ */
+static int has_bar( const char *heading, const char *label, unsigned long value )
+{
+    char bar[64];
+    const char *start = strstr( output, heading );
+
+    if( !start ) { return 0; }
+
+    const char *end = strchr( start, '\n' );
+
+    while( end && end[1] == ' ' ) { end = strchr( end + 1, '\n' ); }
+
+    snprintf( bar, sizeof(bar), "\n  %-8s %8lu #", label, value );
+
+    const char *found = strstr( start, bar );
+
+    return found && (!end || found < end);
+}
+
+/** @brief Find the site table entry of a source line */
+static int find_site( const char *file, int line, heap_track_site_t *site )
+{
+    for( int i = 0; i < HEAP_TRACK_MAX_SITES; i++ )
+    {
+        if( heap_track_get_site( i, site ) && site->line == line && !strcmp( site->file, file ) )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void test_live_and_peak( void )
+{
+    heap_track_stats_t s;
+    heap_track_site_t site;
+
+    heap_track_reset();
+
+    void *a = heap_track_malloc( 100, "src/a.c", 1 );
+    void *b = heap_track_malloc( 50, "src/a.c", 2 );
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 2 );
+    CHECK( s.live_bytes == 150 );
+    CHECK( s.peak_bytes == 150 );
+
+    heap_track_free( a );
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 1 );
+    CHECK( s.live_bytes == 50 );
+    CHECK( s.peak_bytes == 150 );
+    CHECK( s.frees == 1 );
+
+    void *c = heap_track_calloc( 4, 25, "src/a.c", 1 );
+    void *d = heap_track_memalign( 64, 200, "src/a.c", 3 );
+    char *e = heap_track_strdup( "hello", "src/a.c", 4 );
+
+    CHECK( c && ((char *)c)[99] == 0 );
+    CHECK( d && ((uintptr_t)d & 63) == 0 );
+    CHECK( e && !strcmp( e, "hello" ) );
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 4 );
+    CHECK( s.live_bytes == 356 );
+    CHECK( s.peak_bytes == 356 );
+    CHECK( s.allocs == 5 );
+
+    /* Line 1 was freed once and allocated again */
+    CHECK( find_site( "src/a.c", 1, &site ) );
+    CHECK( site.live_count == 1 );
+    CHECK( site.live_bytes == 100 );
+    CHECK( site.peak_bytes == 100 );
+    CHECK( site.total_count == 2 );
+
+    heap_track_free( b );
+    heap_track_free( c );
+    heap_track_free( d );
+    heap_track_free( e );
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 0 );
+    CHECK( s.live_bytes == 0 );
+    CHECK( s.peak_bytes == 356 );
+    CHECK( s.frees == 5 );
+
+    CHECK( find_site( "src/a.c", 3, &site ) );
+    CHECK( site.live_count == 0 );
+    CHECK( site.peak_bytes == 200 );
+
+    /* The same line in another file is another site */
+    void *f = heap_track_malloc( 8, "src/b.c", 1 );
+
+    CHECK( find_site( "src/b.c", 1, &site ) );
+    CHECK( site.live_bytes == 8 );
+    CHECK( find_site( "src/a.c", 1, &site ) );
+    CHECK( site.live_bytes == 0 );
+
+    heap_track_free( f );
+}
+
+static void test_checkpoint_and_leaks( void )
+{
+    heap_track_reset();
+
+    void *before = heap_track_malloc( 10, "src/leak.c", 1 );
+    uint32_t checkpoint = heap_track_checkpoint();
+    void *leaked = heap_track_malloc( 32, "src/leak.c", 10 );
+    void *freed = heap_track_malloc( 16, "src/leak.c", 11 );
+
+    heap_track_free( freed );
+
+    clear_output();
+    CHECK( heap_track_leaks( checkpoint, capture ) == 1 );
+    CHECK( strstr( output, "32 bytes from leak.c:10\n" ) != NULL );
+    CHECK( strstr( output, "leak.c:11" ) == NULL );
+    CHECK( strstr( output, "leak.c:1\n" ) == NULL );
+    CHECK( strstr( output, "1 allocations, 32 bytes live since checkpoint" ) != NULL );
+
+    clear_output();
+    CHECK( heap_track_leaks( 0, capture ) == 2 );
+    CHECK( strstr( output, "10 bytes from leak.c:1\n" ) != NULL );
+    CHECK( strstr( output, "2 allocations, 42 bytes live since checkpoint" ) != NULL );
+
+    heap_track_free( leaked );
+    heap_track_free( before );
+
+    clear_output();
+    CHECK( heap_track_leaks( checkpoint, capture ) == 0 );
+    CHECK( heap_track_checkpoint() > checkpoint );
+}
+
+static void test_histograms( void )
+{
+    void *p[8];
+    heap_track_stats_t s;
+
+    heap_track_reset();
+
+    /* Frame 1: four allocations of mixed sizes */
+    p[0] = heap_track_malloc( 1, "src/h.c", 1 );
+    p[1] = heap_track_malloc( 10, "src/h.c", 2 );
+    p[2] = heap_track_malloc( 10, "src/h.c", 2 );
+    p[3] = heap_track_malloc( 1000, "src/h.c", 3 );
+
+    heap_track_get_stats( &s );
+    CHECK( s.frame_allocs == 4 );
+    CHECK( s.frame_bytes == 1021 );
+
+    heap_track_frame();
+
+    heap_track_get_stats( &s );
+    CHECK( s.frame == 1 );
+    CHECK( s.frame_allocs == 0 );
+    CHECK( s.frame_bytes == 0 );
+
+    /* Frame 2: none, frame 3: five small ones and a huge one */
+    heap_track_frame();
+
+    for( int i = 0; i < 4; i++ ) { heap_track_free( p[i] ); }
+    for( int i = 0; i < 5; i++ ) { p[i] = heap_track_malloc( 3, "src/h.c", 4 ); }
+    p[5] = heap_track_malloc( 100000, "src/h.c", 5 );
+
+    heap_track_frame();
+
+    clear_output();
+    heap_track_report( capture );
+
+    CHECK( strstr( output, "allocation sizes:\n" ) != NULL );
+    CHECK( has_bar( "allocation sizes:", "<2", 1 ) );
+    CHECK( has_bar( "allocation sizes:", "<4", 5 ) );
+    CHECK( has_bar( "allocation sizes:", "<16", 2 ) );
+    CHECK( has_bar( "allocation sizes:", "<1024", 1 ) );
+    CHECK( has_bar( "allocation sizes:", ">=32768", 1 ) );
+    CHECK( !has_bar( "allocation sizes:", "<8", 0 ) );
+
+    /* 4 and 6 allocations both fall in 4..7 */
+    CHECK( strstr( output, "allocations per frame over 3 frames, avg 3, max 6:\n" ) != NULL );
+    CHECK( has_bar( "allocations per frame", "0", 1 ) );
+    CHECK( has_bar( "allocations per frame", "<8", 2 ) );
+
+    for( int i = 0; i < 6; i++ ) { heap_track_free( p[i] ); }
+
+    /* Only the last frames are kept */
+    for( int i = 0; i < HEAP_TRACK_FRAMES + 6; i++ ) { heap_track_frame(); }
+
+    clear_output();
+    heap_track_report( capture );
+
+    char line[128];
+    snprintf( line, sizeof(line), "allocations per frame over %d frames, avg 0, max 0:\n", HEAP_TRACK_FRAMES );
+    CHECK( strstr( output, line ) != NULL );
+    CHECK( has_bar( "allocations per frame", "0", HEAP_TRACK_FRAMES ) );
+
+    /* No frames ended yet, so there is no per frame histogram */
+    heap_track_reset();
+    clear_output();
+    heap_track_report( capture );
+    CHECK( strstr( output, "allocations per frame" ) == NULL );
+}
+
+static void test_realloc_and_untracked_free( void )
+{
+    heap_track_stats_t s;
+
+    heap_track_reset();
+
+    /* Memory from untracked code becomes tracked once reallocated */
+    void *untracked = malloc( 16 );
+    void *p = heap_track_realloc( untracked, 64, "src/r.c", 1 );
+
+    heap_track_get_stats( &s );
+    CHECK( p != NULL );
+    CHECK( s.live_count == 1 );
+    CHECK( s.live_bytes == 64 );
+    CHECK( s.frees == 0 );
+
+    /* Growing a tracked block moves the accounting with it */
+    p = heap_track_realloc( p, 128, "src/r.c", 2 );
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 1 );
+    CHECK( s.live_bytes == 128 );
+    CHECK( s.peak_bytes == 128 );
+    CHECK( s.allocs == 2 );
+    CHECK( s.frees == 1 );
+
+    heap_track_site_t site;
+    CHECK( find_site( "src/r.c", 1, &site ) && site.live_count == 0 );
+    CHECK( find_site( "src/r.c", 2, &site ) && site.live_bytes == 128 );
+
+    /* Failing keeps the old block tracked */
+    void *fail = heap_track_realloc( p, (size_t)-1 / 2, "src/r.c", 3 );
+
+    heap_track_get_stats( &s );
+    CHECK( fail == NULL );
+    CHECK( s.failures == 1 );
+    CHECK( s.live_count == 1 );
+    CHECK( s.live_bytes == 128 );
+
+    clear_output();
+    CHECK( heap_track_leaks( 0, capture ) == 1 );
+    CHECK( strstr( output, "128 bytes from r.c:2\n" ) != NULL );
+
+    /* Realloc of null is malloc */
+    void *q = heap_track_realloc( NULL, 32, "src/r.c", 4 );
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 2 );
+    CHECK( s.live_bytes == 160 );
+
+    /* Freeing untracked memory and null changes nothing */
+    untracked = malloc( 16 );
+    heap_track_free( untracked );
+    heap_track_free( NULL );
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 2 );
+    CHECK( s.live_bytes == 160 );
+    CHECK( s.frees == 1 );
+
+    heap_track_free( p );
+    heap_track_free( q );
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 0 );
+    CHECK( s.live_bytes == 0 );
+}
+
+static void test_full_site_table( void )
+{
+    enum { COUNT = HEAP_TRACK_MAX_SITES + 72 };
+    static void *p[COUNT];
+    heap_track_stats_t s;
+    heap_track_site_t site;
+
+    heap_track_reset();
+
+    for( int i = 0; i < COUNT; i++ ) { p[i] = heap_track_malloc( 4, "src/full.c", i + 1 ); }
+
+    int used = 0;
+    for( int i = 0; i < HEAP_TRACK_MAX_SITES; i++ ) { used += heap_track_get_site( i, &site ); }
+
+    CHECK( used == HEAP_TRACK_MAX_SITES );
+    CHECK( !heap_track_get_site( HEAP_TRACK_MAX_SITES, &site ) );
+    CHECK( !heap_track_get_site( -1, &site ) );
+
+    /* Allocations without a site are still counted */
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == COUNT );
+    CHECK( s.live_bytes == COUNT * 4 );
+    CHECK( s.allocs == COUNT );
+    CHECK( s.dropped == 0 );
+
+    clear_output();
+    CHECK( heap_track_leaks( 0, capture ) == COUNT );
+
+    int untracked = 0;
+    for( char *line = strstr( output, "(untracked site)" ); line; line = strstr( line + 1, "(untracked site)" ) )
+    {
+        untracked++;
+    }
+    CHECK( untracked == COUNT - HEAP_TRACK_MAX_SITES );
+
+    /* Known sites still match */
+    void *again = heap_track_malloc( 4, "src/full.c", 1 );
+    CHECK( find_site( "src/full.c", 1, &site ) );
+    CHECK( site.live_count == 2 );
+    CHECK( site.total_count == 2 );
+    heap_track_free( again );
+
+    for( int i = 0; i < COUNT; i++ ) { heap_track_free( p[i] ); }
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 0 );
+    CHECK( s.live_bytes == 0 );
+    CHECK( s.frees == COUNT + 1 );
+
+    for( int i = 0; i < HEAP_TRACK_MAX_SITES; i++ )
+    {
+        if( heap_track_get_site( i, &site ) ) { CHECK( site.live_count == 0 && site.live_bytes == 0 ); }
+    }
+}
+
+static void test_full_alloc_table( void )
+{
+    enum { COUNT = HEAP_TRACK_MAX_ALLOCS + 10 };
+    static void *p[COUNT];
+    heap_track_stats_t s;
+    heap_track_site_t site;
+
+    heap_track_reset();
+
+    for( int i = 0; i < COUNT; i++ ) { p[i] = heap_track_malloc( 8, "src/many.c", 1 ); }
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == HEAP_TRACK_MAX_ALLOCS );
+    CHECK( s.live_bytes == HEAP_TRACK_MAX_ALLOCS * 8 );
+    CHECK( s.dropped == 10 );
+    CHECK( s.allocs == COUNT );
+
+    CHECK( find_site( "src/many.c", 1, &site ) );
+    CHECK( site.live_count == HEAP_TRACK_MAX_ALLOCS );
+    CHECK( site.total_count == COUNT );
+
+    /* The dropped ones are untracked when freed */
+    for( int i = 0; i < COUNT; i++ ) { heap_track_free( p[i] ); }
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == 0 );
+    CHECK( s.live_bytes == 0 );
+    CHECK( s.frees == HEAP_TRACK_MAX_ALLOCS );
+
+    CHECK( find_site( "src/many.c", 1, &site ) );
+    CHECK( site.live_count == 0 );
+    CHECK( site.live_bytes == 0 );
+
+    /* Freed slots are reused */
+    for( int i = 0; i < HEAP_TRACK_MAX_ALLOCS; i++ ) { p[i] = heap_track_malloc( 8, "src/many.c", 1 ); }
+
+    heap_track_get_stats( &s );
+    CHECK( s.live_count == HEAP_TRACK_MAX_ALLOCS );
+    CHECK( s.dropped == 10 );
+
+    for( int i = 0; i < HEAP_TRACK_MAX_ALLOCS; i++ ) { heap_track_free( p[i] ); }
+}
+
+int main( void )
+{
+    RUN( test_live_and_peak );
+    RUN( test_checkpoint_and_leaks );
+    RUN( test_histograms );
+    RUN( test_realloc_and_untracked_free );
+    RUN( test_full_site_table );
+    RUN( test_full_alloc_table );
+
+    return TEST_RESULT();
+}
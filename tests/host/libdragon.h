@@ -0,0 +1,17 @@
+/**
+ * @file libdragon.h
+ * @brief Host Stand-In for libdragon.h
+ *
+ * Library sources built for the host tests include this instead of the
+ * real libdragon.h, which pulls in hardware access that only builds for
+ * the console.  It only provides what those sources use.
+ */
+#ifndef __LIBDRAGON_LIBDRAGON_H
+#define __LIBDRAGON_LIBDRAGON_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sd.h"
+
+#endif
@@ -0,0 +1,358 @@
+/**
+ * @file sd_test.c
+ * @brief Host tests for the SD card driver over the simulated backend
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "sd.h"
+#include "system.h"
+#include "test.h"
+
+/** @brief Sectors in the test image, enough for several chunks */
+#define IMAGE_SECTORS   (5 * SD_CHUNK_SECTORS + 3)
+/** @brief Size of the test image in bytes */
+#define IMAGE_SIZE      (IMAGE_SECTORS * SD_SECTOR_SIZE)
+/** @brief Guard bytes around each read, checked to be left alone */
+#define GUARD           32
+/** @brief Value of the guard bytes */
+#define GUARD_BYTE      0x5A
+
+/** @brief Disk image read through the driver */
+static uint8_t image[IMAGE_SIZE];
+/** @brief Destination of reads, with room for guards and misalignment */
+static uint8_t dest[IMAGE_SIZE + 2 * GUARD + 64] __attribute__((aligned(16)));
+/** @brief Filesystem attached by #sd_init */
+static filesystem_t *sd_fs = NULL;
+
+int attach_filesystem( const char * const prefix, filesystem_t *filesystem )
+{
+    CHECK( !strcmp( prefix, "sd:/" ) );
+    sd_fs = filesystem;
+    return 0;
+}
+
+int detach_filesystem( const char * const prefix )
+{
+    CHECK( !strcmp( prefix, "sd:/" ) );
+    sd_fs = NULL;
+    return 0;
+}
+
+/** @brief Fill the image with bytes that differ from sector to sector */
+static void make_image( void )
+{
+    uint32_t x = 0x12345678;
+
+    for( int i = 0; i < IMAGE_SIZE; i++ )
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        image[i] = x;
+    }
+}
+
+/**
+ * @brief Return a destination with guard bytes around it
+ *
+ * @param[in] misalign
+ *            Offset from a 16 byte boundary
+ * @param[in] len
+ *            Bytes that will be read into it
+ */
+static uint8_t *guarded( int misalign, int len )
+{
+    memset( dest, GUARD_BYTE, sizeof(dest) );
+
+    return dest + GUARD + misalign;
+}
+
+/** @brief Return whether the guard bytes around a destination are intact */
+static int guards_intact( uint8_t *buf, int len )
+{
+    for( uint8_t *p = dest; p < buf; p++ ) { if( *p != GUARD_BYTE ) { return 0; } }
+    for( uint8_t *p = buf + len; p < dest + sizeof(dest); p++ ) { if( *p != GUARD_BYTE ) { return 0; } }
+
+    return 1;
+}
+
+/** @brief Return whether a buffer holds the expected part of the image */
+static int matches( const uint8_t *buf, uint32_t pos, int len )
+{
+    for( int i = 0; i < len; i++, pos++ )
+    {
+        uint8_t want = pos < IMAGE_SIZE ? image[pos] : 0;
+
+        if( buf[i] != want ) { return 0; }
+    }
+
+    return 1;
+}
+
+static void test_init( void )
+{
+    uint8_t buf[SD_SECTOR_SIZE] __attribute__((aligned(8)));
+
+    CHECK( sd_read_sectors( 0, 1, buf ) == SD_ENODEV );
+    CHECK( sd_init( NULL ) == SD_ENODEV );
+    CHECK( sd_fs == NULL );
+
+    CHECK( sd_init( sd_sim_backend( image, IMAGE_SECTORS ) ) == SD_ESUCCESS );
+    CHECK( sd_fs != NULL );
+
+    sd_close();
+    CHECK( sd_fs == NULL );
+    CHECK( sd_read_sectors( 0, 1, buf ) == SD_ENODEV );
+
+    CHECK( sd_init( sd_sim_backend( image, IMAGE_SECTORS ) ) == SD_ESUCCESS );
+}
+
+static void test_read_sectors( void )
+{
+    static const uint32_t counts[] = { 1, 2, SD_CHUNK_SECTORS - 1, SD_CHUNK_SECTORS, SD_CHUNK_SECTORS + 1,
+                                       2 * SD_CHUNK_SECTORS, 3 * SD_CHUNK_SECTORS + 5, IMAGE_SECTORS - 1 };
+    static const int misaligns[] = { 0, 8 };
+
+    for( int m = 0; m < sizeof(misaligns) / sizeof(misaligns[0]); m++ )
+    {
+        for( int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++ )
+        {
+            uint32_t len = counts[c] * SD_SECTOR_SIZE;
+            uint8_t *buf = guarded( misaligns[m], len );
+
+            CHECK( sd_read_sectors( 1, counts[c], buf ) == SD_ESUCCESS );
+            CHECK( matches( buf, SD_SECTOR_SIZE, len ) );
+            CHECK( guards_intact( buf, len ) );
+        }
+    }
+
+    /* Past the end of the image reads zeros */
+    uint8_t *buf = guarded( 0, 4 * SD_SECTOR_SIZE );
+    CHECK( sd_read_sectors( IMAGE_SECTORS - 2, 4, buf ) == SD_ESUCCESS );
+    CHECK( matches( buf, (IMAGE_SECTORS - 2) * SD_SECTOR_SIZE, 4 * SD_SECTOR_SIZE ) );
+
+    /* The PI needs 8 byte aligned memory */
+    CHECK( sd_read_sectors( 0, 1, dest + 4 ) == SD_EBADINPUT );
+    CHECK( sd_read_sectors( 0, 0, dest ) == SD_ESUCCESS );
+}
+
+static void test_open( void )
+{
+    void *files[SD_MAX_OPEN_FILES];
+    struct stat st;
+
+    CHECK( sd_fs->open( "abc", O_RDONLY ) == NULL );
+    CHECK( sd_fs->open( "12x", O_RDONLY ) == NULL );
+    CHECK( sd_fs->open( "12+", O_RDONLY ) == NULL );
+    CHECK( sd_fs->open( "12+0", O_RDONLY ) == NULL );
+    CHECK( sd_fs->open( "12", O_WRONLY ) == NULL );
+    CHECK( sd_fs->open( "12", O_RDWR ) == NULL );
+    CHECK( sd_fs->write == NULL );
+
+    for( int i = 0; i < SD_MAX_OPEN_FILES; i++ ) { files[i] = sd_fs->open( "0x10+0x200", O_RDONLY ); }
+    for( int i = 0; i < SD_MAX_OPEN_FILES; i++ ) { CHECK( files[i] != NULL ); }
+
+    CHECK( sd_fs->open( "0", O_RDONLY ) == NULL );
+
+    CHECK( sd_fs->fstat( files[0], &st ) == 0 );
+    CHECK( st.st_size == 0x200 );
+
+    CHECK( sd_fs->close( files[1] ) == 0 );
+    files[1] = sd_fs->open( "16", O_RDONLY );
+    CHECK( files[1] != NULL );
+
+    CHECK( sd_fs->fstat( files[1], &st ) == 0 );
+    CHECK( st.st_size == 0 );
+
+    for( int i = 0; i < SD_MAX_OPEN_FILES; i++ ) { sd_fs->close( files[i] ); }
+}
+
+static void test_read_unaligned( void )
+{
+    static const uint32_t offsets[] = { 0, 1, 7, 8, 15, 16, 511, 512, 513, SD_CHUNK_SIZE - 3,
+                                        SD_CHUNK_SIZE + 8, 2 * SD_CHUNK_SIZE + 100 };
+    static const int lengths[] = { 1, 7, 8, 15, 16, 17, 511, 512, 513, 1000, 4096,
+                                   SD_CHUNK_SIZE + 9, 3 * SD_CHUNK_SIZE + 100 };
+    static const int misaligns[] = { 0, 1, 8, 9, 15 };
+    const uint32_t lba = 2;
+
+    void *file = sd_fs->open( "2", O_RDONLY );
+
+    CHECK( file != NULL );
+
+    for( int o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++ )
+    {
+        for( int l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++ )
+        {
+            for( int m = 0; m < sizeof(misaligns) / sizeof(misaligns[0]); m++ )
+            {
+                uint8_t *buf = guarded( misaligns[m], lengths[l] );
+                uint32_t pos = lba * SD_SECTOR_SIZE + offsets[o];
+
+                CHECK( sd_fs->lseek( file, offsets[o], SEEK_SET ) == offsets[o] );
+                CHECK( sd_fs->read( file, buf, lengths[l] ) == lengths[l] );
+                CHECK( matches( buf, pos, lengths[l] ) );
+                CHECK( guards_intact( buf, lengths[l] ) );
+                CHECK( sd_fs->lseek( file, 0, SEEK_CUR ) == offsets[o] + lengths[l] );
+            }
+        }
+    }
+
+    /* Without a size the region runs on past the image, which reads zeros */
+    uint32_t near_end = IMAGE_SIZE - lba * SD_SECTOR_SIZE - 100;
+    uint8_t *buf = guarded( 1, 1000 );
+
+    CHECK( sd_fs->lseek( file, near_end, SEEK_SET ) == near_end );
+    CHECK( sd_fs->read( file, buf, 1000 ) == 1000 );
+    CHECK( matches( buf, IMAGE_SIZE - 100, 1000 ) );
+    CHECK( guards_intact( buf, 1000 ) );
+
+    /* Only a region with a size has an end */
+    CHECK( sd_fs->lseek( file, 0, SEEK_END ) < 0 );
+    CHECK( sd_fs->lseek( file, -1, SEEK_SET ) < 0 );
+
+    sd_fs->close( file );
+}
+
+static void test_sized_region( void )
+{
+    const uint32_t lba = 3, size = 10000;
+    void *file = sd_fs->open( "3+10000", O_RDONLY );
+    uint8_t *buf;
+
+    CHECK( file != NULL );
+
+    CHECK( sd_fs->lseek( file, 0, SEEK_END ) == size );
+    CHECK( sd_fs->lseek( file, -100, SEEK_END ) == size - 100 );
+    CHECK( sd_fs->lseek( file, -20000, SEEK_END ) < 0 );
+
+    /* Reads stop at the end of the region */
+    buf = guarded( 3, 500 );
+    CHECK( sd_fs->lseek( file, -100, SEEK_END ) == size - 100 );
+    CHECK( sd_fs->read( file, buf, 500 ) == 100 );
+    CHECK( matches( buf, lba * SD_SECTOR_SIZE + size - 100, 100 ) );
+    CHECK( guards_intact( buf, 100 ) );
+
+    buf = guarded( 0, 16 );
+    CHECK( sd_fs->read( file, buf, 16 ) == 0 );
+    CHECK( guards_intact( buf, 0 ) );
+
+    /* Seeking past the end is allowed, reading there is not */
+    CHECK( sd_fs->lseek( file, 100, SEEK_END ) == size + 100 );
+    CHECK( sd_fs->read( file, buf, 16 ) == 0 );
+    CHECK( guards_intact( buf, 0 ) );
+
+    /* The whole region in one go */
+    buf = guarded( 8, size );
+    CHECK( sd_fs->lseek( file, 0, SEEK_SET ) == 0 );
+    CHECK( sd_fs->read( file, buf, size + 1000 ) == size );
+    CHECK( matches( buf, lba * SD_SECTOR_SIZE, size ) );
+    CHECK( guards_intact( buf, size ) );
+
+    sd_fs->close( file );
+}
+
+/** @brief stdio read through the SD filesystem hooks */
+static ssize_t cookie_read( void *cookie, char *buf, size_t size )
+{
+    return sd_fs->read( cookie, (uint8_t *)buf, size );
+}
+
+/** @brief stdio seek through the SD filesystem hooks */
+static int cookie_seek( void *cookie, off64_t *offset, int whence )
+{
+    int pos = sd_fs->lseek( cookie, *offset, whence );
+
+    if( pos < 0 ) { return -1; }
+
+    *offset = pos;
+    return 0;
+}
+
+/** @brief stdio close through the SD filesystem hooks */
+static int cookie_close( void *cookie )
+{
+    return sd_fs->close( cookie );
+}
+
+/** @brief Open a region of the card as a stdio stream */
+static FILE *sd_fopen( char *name )
+{
+    cookie_io_functions_t io = { cookie_read, NULL, cookie_seek, cookie_close };
+    void *file = sd_fs->open( name, O_RDONLY );
+
+    return file ? fopencookie( file, "r", io ) : NULL;
+}
+
+static void test_fread( void )
+{
+    const uint32_t lba = 1, size = 3 * SD_CHUNK_SIZE + 777;
+    static const int lengths[] = { 1, 3, 100, 511, 4096, SD_CHUNK_SIZE + 5 };
+    char name[32];
+
+    snprintf( name, sizeof(name), "%lu+0x%lx", (unsigned long)lba, (unsigned long)size );
+
+    FILE *fp = sd_fopen( name );
+
+    CHECK( fp != NULL );
+
+    /* Reads of mixed sizes straight through, as stdio refills its buffer */
+    uint8_t *buf = guarded( 5, size );
+    uint32_t done = 0;
+
+    for( int i = 0; done < size; i++ )
+    {
+        int len = lengths[i % (sizeof(lengths) / sizeof(lengths[0]))];
+
+        done += fread( buf + done, 1, len, fp );
+    }
+
+    CHECK( done == size );
+    CHECK( matches( buf, lba * SD_SECTOR_SIZE, size ) );
+    CHECK( guards_intact( buf, size ) );
+    CHECK( fread( buf, 1, 1, fp ) == 0 );
+    CHECK( feof( fp ) );
+
+    /* Seeks relative to the end */
+    buf = guarded( 9, 300 );
+    CHECK( fseek( fp, -300, SEEK_END ) == 0 );
+    CHECK( ftell( fp ) == size - 300 );
+    CHECK( fread( buf, 1, 1000, fp ) == 300 );
+    CHECK( matches( buf, lba * SD_SECTOR_SIZE + size - 300, 300 ) );
+    CHECK( guards_intact( buf, 300 ) );
+
+    fclose( fp );
+
+    /* Unbuffered, so reads go straight to the driver with odd pointers */
+    fp = sd_fopen( "1" );
+    CHECK( fp != NULL );
+    setvbuf( fp, NULL, _IONBF, 0 );
+
+    buf = guarded( 1, 2 * SD_CHUNK_SIZE + 3 );
+    CHECK( fseek( fp, 511, SEEK_SET ) == 0 );
+    CHECK( fread( buf, 1, 2 * SD_CHUNK_SIZE + 3, fp ) == 2 * SD_CHUNK_SIZE + 3 );
+    CHECK( matches( buf, lba * SD_SECTOR_SIZE + 511, 2 * SD_CHUNK_SIZE + 3 ) );
+    CHECK( guards_intact( buf, 2 * SD_CHUNK_SIZE + 3 ) );
+    CHECK( fseek( fp, 0, SEEK_END ) != 0 );
+
+    fclose( fp );
+}
+
+int main( void )
+{
+    make_image();
+
+    RUN( test_init );
+    RUN( test_read_sectors );
+    RUN( test_open );
+    RUN( test_read_unaligned );
+    RUN( test_sized_region );
+    RUN( test_fread );
+
+    sd_close();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,37 @@
+/**
+ * @file test.h
+ * @brief Minimal checks for the host tests
+ *
+ * The tests build library sources with the native compiler, so they run on
+ * the development machine instead of needing a console or an emulator.
+ */
+#ifndef __LIBDRAGON_TEST_H
+#define __LIBDRAGON_TEST_H
+
+#include <stdio.h>
+
+/** @brief Number of checks that failed */
+static int test_failures = 0;
+
+/** @brief Report a failed check and keep going */
+#define CHECK(cond) \
+    do { \
+        if( !(cond) ) \
+        { \
+            printf( "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond ); \
+            test_failures++; \
+        } \
+    } while( 0 )
+
+/** @brief Run one test function */
+#define RUN(test) \
+    do { \
+        int before = test_failures; \
+        test(); \
+        printf( "%s %s\n", test_failures == before ? "pass" : "FAIL", #test ); \
+    } while( 0 )
+
+/** @brief Exit status of the test program */
+#define TEST_RESULT() (test_failures ? 1 : 0)
+
+#endif
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include "crash.h"
+#include "elfsym.h"
+
+#if BYTE_ORDER == BIG_ENDIAN
+#define SWAPLONG(i) (i)
+#define SWAPSHORT(i) (i)
+#else
+#define SWAPLONG(i) (((uint32_t)(i & 0xFF000000) >> 24) | ((uint32_t)(i & 0x00FF0000) >>  8) | ((uint32_t)(i & 0x0000FF00) <<  8) | ((uint32_t)(i & 0x000000FF) << 24))
+#define SWAPSHORT(i) ((uint16_t)(((uint16_t)(i) >> 8) | ((uint16_t)(i) << 8)))
+#endif
+
+static const char *exception_names[32] =
+{
+    "Interrupt", "TLB modification", "TLB miss on load", "TLB miss on store",
+    "Address error on load", "Address error on store", "Bus error on instruction fetch", "Bus error on data access",
+    "Syscall", "Breakpoint", "Reserved instruction", "Coprocessor unusable",
+    "Arithmetic overflow", "Trap", NULL, "Floating point",
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, "Watch",
+};
+
+static const char *register_names[32] =
+{
+    "zr", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra",
+};
+
+void print_usage(char *name)
+{
+    fprintf(stderr, "Usage: %s <program elf> <crash report>\n", name);
+    fprintf(stderr, "       %s -a <program elf> <address>...\n", name);
+    fprintf(stderr, "\nPrints a crash report written by crash_send_usb or read back with\n");
+    fprintf(stderr, "crash_load_eeprom, with addresses turned into function names.  With -a,\n");
+    fprintf(stderr, "looks up addresses copied from a report printed on the console.\n");
+}
+
+/* Read a whole file into memory, returning its size or -1 */
+long read_file(const char *path, uint8_t **out)
+{
+    FILE *fp = fopen(path, "rb");
+    long size;
+
+    if(!fp)
+    {
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    *out = malloc(size > 0 ? size : 1);
+
+    if(!*out || fread(*out, 1, size, fp) != size)
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    return size;
+}
+
+/* Write an address as function+offset, or nothing if it is not in a function */
+const char *symbolize(const elf_symtab_t *symtab, uint32_t addr, char *buf)
+{
+    const elf_symbol_t *sym = elf_find_symbol(symtab, addr);
+
+    if(!sym)
+    {
+        buf[0] = 0;
+    }
+    else if(addr == sym->addr)
+    {
+        snprintf(buf, 256, "%s", sym->name);
+    }
+    else
+    {
+        snprintf(buf, 256, "%s+0x%x", sym->name, addr - sym->addr);
+    }
+
+    return buf;
+}
+
+int main(int argc, char *argv[])
+{
+    elf_symtab_t symtab;
+    uint8_t *data;
+    char buf[256];
+    long size;
+
+    if(argc >= 3 && !strcmp(argv[1], "-a"))
+    {
+        if(elf_load_symbols(argv[2], &symtab) < 0)
+        {
+            fprintf(stderr, "Cannot read function symbols from %s!\n", argv[2]);
+            return -1;
+        }
+
+        for(int i = 3; i < argc; i++)
+        {
+            uint32_t addr = strtoul(argv[i], NULL, 16);
+
+            printf("%08x  %s\n", addr, symbolize(&symtab, addr, buf)[0] ? buf : "??");
+        }
+
+        elf_free_symbols(&symtab);
+        return 0;
+    }
+
+    if(argc != 3)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    if(elf_load_symbols(argv[1], &symtab) < 0)
+    {
+        fprintf(stderr, "Cannot read function symbols from %s!\n", argv[1]);
+        return -1;
+    }
+
+    size = read_file(argv[2], &data);
+
+    if(size < 0)
+    {
+        fprintf(stderr, "Cannot read %s!\n", argv[2]);
+        return -1;
+    }
+
+    crash_report_t *report = (crash_report_t *)data;
+
+    if(size < sizeof(crash_report_t) || SWAPLONG(report->magic) != CRASH_MAGIC ||
+       SWAPSHORT(report->version) != CRASH_VERSION)
+    {
+        fprintf(stderr, "%s is not a version %d crash report!\n", argv[2], CRASH_VERSION);
+        return -1;
+    }
+
+    uint32_t cause = SWAPLONG(report->cause);
+    uint32_t epc = SWAPLONG(report->epc);
+    uint32_t badvaddr = SWAPLONG(report->badvaddr);
+    int num_frames = SWAPSHORT(report->num_frames);
+    int code = (cause >> 2) & 0x1F;
+
+    if(num_frames > CRASH_MAX_FRAMES)
+    {
+        num_frames = CRASH_MAX_FRAMES;
+    }
+
+    printf("%s exception (code %d)", exception_names[code] ? exception_names[code] : "Unknown", code);
+
+    /* Then pc is the branch, and the faulting instruction the one after it */
+    if(cause & 0x80000000)
+    {
+        printf(" in a branch delay slot");
+    }
+
+    printf("\n\n  pc       %08x  %s\n", epc, symbolize(&symtab, epc, buf));
+    printf("  badvaddr %08x\n", badvaddr);
+    printf("  cause    %08x\n", cause);
+    printf("  sr       %08x\n", SWAPLONG(report->sr));
+    printf("  hi       %08x\n", SWAPLONG(report->hi));
+    printf("  lo       %08x\n", SWAPLONG(report->lo));
+
+    printf("\nRegisters:\n");
+
+    for(int i = 0; i < 32; i += 4)
+    {
+        printf(" ");
+
+        for(int j = i; j < i + 4; j++)
+        {
+            printf(" %s %08x", register_names[j], SWAPLONG(report->gpr[j]));
+        }
+
+        printf("\n");
+    }
+
+    printf("  ra is %s\n", symbolize(&symtab, SWAPLONG(report->gpr[31]), buf)[0] ? buf : "not in a function");
+
+    printf("\nBacktrace:\n");
+
+    for(int i = 0; i < num_frames; i++)
+    {
+        uint32_t addr = SWAPLONG(report->frames[i]);
+
+        printf("  #%-2d %08x  %s\n", i, addr, symbolize(&symtab, addr, buf)[0] ? buf : "??");
+    }
+
+    printf("\nCode:\n");
+
+    for(int i = 0; i < CRASH_CODE_WORDS; i++)
+    {
+        uint32_t addr = epc + (i - CRASH_CODE_WORDS / 2) * 4;
+
+        printf("%s %08x  %08x\n", i == CRASH_CODE_WORDS / 2 ? "->" : "  ", addr, SWAPLONG(report->code[i]));
+    }
+
+    /* Code addresses on the stack are often return addresses, which help
+       where the backtrace stopped early */
+    printf("\nStack:\n");
+
+    for(int i = 0; i < CRASH_STACK_WORDS; i++)
+    {
+        uint32_t addr = SWAPLONG(report->gpr[29]) + i * 4;
+        uint32_t value = SWAPLONG(report->stack[i]);
+
+        symbolize(&symtab, value, buf);
+        printf("  %08x  %08x%s%s\n", addr, value, buf[0] ? "  " : "", buf);
+    }
+
+    elf_free_symbols(&symtab);
+    free(data);
+
+    return 0;
+}
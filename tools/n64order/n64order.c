@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include "profile.h"
+#include "elfsym.h"
+
+#if BYTE_ORDER == BIG_ENDIAN
+#define SWAPLONG(i) (i)
+#define SWAPSHORT(i) (i)
+#else
+#define SWAPLONG(i) (((uint32_t)(i & 0xFF000000) >> 24) | ((uint32_t)(i & 0x00FF0000) >>  8) | ((uint32_t)(i & 0x0000FF00) <<  8) | ((uint32_t)(i & 0x000000FF) << 24))
+#define SWAPSHORT(i) ((uint16_t)(((uint16_t)(i) >> 8) | ((uint16_t)(i) << 8)))
+#endif
+
+/* Size of the VR4300 instruction cache */
+#define ICACHE_SIZE (16 * 1024)
+
+/* Samples in which a function was running or was the caller of the one running */
+typedef struct
+{
+    const elf_symbol_t *sym;
+    uint32_t count;
+    uint32_t self;
+} entry_t;
+
+void print_usage(char *name)
+{
+    fprintf(stderr, "Usage: %s [-c <percent>] <program elf> <profile dump>\n", name);
+    fprintf(stderr, "\nOrders functions hottest first from a dump written by profile_dump or\n");
+    fprintf(stderr, "profile_dump_usb, and prints it as n64order.ld for the linker scripts.\n");
+    fprintf(stderr, "A function counts the samples taken in it and in the functions it was\n");
+    fprintf(stderr, "calling.  With -c, stops once the functions listed cover that percentage\n");
+    fprintf(stderr, "of the samples.  Only functions compiled with -ffunction-sections move.\n");
+}
+
+/* Read a whole file into memory, returning its size or -1 */
+long read_file(const char *path, uint8_t **out)
+{
+    FILE *fp = fopen(path, "rb");
+    long size;
+
+    if(!fp)
+    {
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    *out = malloc(size > 0 ? size : 1);
+
+    if(!*out || fread(*out, 1, size, fp) != size)
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    return size;
+}
+
+int compare_entries(const void *a, const void *b)
+{
+    const entry_t *ea = a;
+    const entry_t *eb = b;
+
+    if(ea->count != eb->count)
+    {
+        return ea->count > eb->count ? -1 : 1;
+    }
+
+    return strcmp(ea->sym->name, eb->sym->name);
+}
+
+int main(int argc, char *argv[])
+{
+    elf_symtab_t symtab;
+    uint8_t *data;
+    long size;
+    double coverage = 100.0;
+    int arg = 1;
+
+    if(argc > 2 && !strcmp(argv[1], "-c"))
+    {
+        coverage = atof(argv[2]);
+        arg += 2;
+    }
+
+    if(argc - arg != 2 || coverage <= 0.0)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    if(elf_load_symbols(argv[arg], &symtab) < 0)
+    {
+        fprintf(stderr, "Cannot read function symbols from %s!\n", argv[arg]);
+        return -1;
+    }
+
+    size = read_file(argv[arg + 1], &data);
+
+    if(size < 0)
+    {
+        fprintf(stderr, "Cannot read %s!\n", argv[arg + 1]);
+        return -1;
+    }
+
+    profile_header_t *header = (profile_header_t *)data;
+
+    if(size < sizeof(profile_header_t) || SWAPLONG(header->magic) != PROFILE_MAGIC ||
+       SWAPSHORT(header->version) != PROFILE_VERSION || SWAPSHORT(header->slot_size) != sizeof(profile_slot_t))
+    {
+        fprintf(stderr, "%s is not a version %d profile dump!\n", argv[arg + 1], PROFILE_VERSION);
+        return -1;
+    }
+
+    uint32_t num_slots = SWAPLONG(header->num_slots);
+    profile_slot_t *slots = (profile_slot_t *)(header + 1);
+
+    if(size < sizeof(profile_header_t) + (long)num_slots * sizeof(profile_slot_t))
+    {
+        fprintf(stderr, "%s is truncated!\n", argv[arg + 1]);
+        return -1;
+    }
+
+    /* One entry per symbol, so a symbol's entry is found by its index */
+    entry_t *entries = calloc(symtab.count ? symtab.count : 1, sizeof(entry_t));
+    uint64_t total = 0;
+
+    for(int i = 0; i < symtab.count; i++)
+    {
+        entries[i].sym = &symtab.syms[i];
+    }
+
+    for(uint32_t i = 0; i < num_slots; i++)
+    {
+        uint32_t count = SWAPLONG(slots[i].count);
+        const elf_symbol_t *callee = elf_find_symbol(&symtab, SWAPLONG(slots[i].pc));
+        const elf_symbol_t *caller = elf_find_symbol(&symtab, SWAPLONG(slots[i].ra) - 8);
+
+        total += count;
+
+        if(callee)
+        {
+            entries[callee - symtab.syms].count += count;
+            entries[callee - symtab.syms].self += count;
+        }
+
+        /* The caller runs its call sites as often, so keep it close by, unless
+           the return address is only left over from a call it made earlier */
+        if(caller && caller != callee)
+        {
+            entries[caller - symtab.syms].count += count;
+        }
+    }
+
+    qsort(entries, symtab.count, sizeof(entry_t), compare_entries);
+
+    printf("/* Generated by n64order from %s and %s */\n", argv[arg], argv[arg + 1]);
+
+    uint64_t covered = 0;
+    uint32_t bytes = 0;
+    int listed = 0;
+
+    for(int i = 0; i < symtab.count && entries[i].count; i++)
+    {
+        if(total && covered * 100.0 >= coverage * total)
+        {
+            break;
+        }
+
+        printf("*(.text.%s)\n", entries[i].sym->name);
+
+        covered += entries[i].self;
+        bytes += entries[i].sym->size;
+        listed++;
+    }
+
+    fprintf(stderr, "%d functions, %u bytes", listed, bytes);
+
+    if(bytes > ICACHE_SIZE)
+    {
+        fprintf(stderr, ", more than the %d byte instruction cache", ICACHE_SIZE);
+    }
+
+    fprintf(stderr, "\n");
+
+    free(entries);
+    elf_free_symbols(&symtab);
+    free(data);
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "elfsym.h"
+
+#define EI_CLASS        4
+#define EI_DATA         5
+#define ELFCLASS32      1
+#define ELFCLASS64      2
+#define ELFDATA2MSB     2
+#define SHT_SYMTAB      2
+#define STT_FUNC        2
+#define SHN_UNDEF       0
+
+/* File being parsed, its size, and its layout */
+static uint8_t *elf;
+static long elf_size;
+static int is64;
+static int msb;
+
+/* Read a field of the given size at an offset, in the file's byte order */
+static uint64_t get(long offset, int size)
+{
+    uint64_t value = 0;
+
+    if(offset < 0 || offset + size > elf_size)
+    {
+        return 0;
+    }
+
+    for(int i = 0; i < size; i++)
+    {
+        int byte = msb ? i : size - 1 - i;
+        value = (value << 8) | elf[offset + byte];
+    }
+
+    return value;
+}
+
+/* Read a word-sized field, which is 4 or 8 bytes depending on the class */
+static uint64_t get_word(long offset)
+{
+    return get(offset, is64 ? 8 : 4);
+}
+
+static int compare_symbols(const void *a, const void *b)
+{
+    const elf_symbol_t *sa = a;
+    const elf_symbol_t *sb = b;
+
+    if(sa->addr != sb->addr)
+    {
+        return sa->addr < sb->addr ? -1 : 1;
+    }
+
+    /* Prefer sized symbols, then keep the order they were read in */
+    if(!sa->size != !sb->size)
+    {
+        return sa->size ? -1 : 1;
+    }
+
+    return sa < sb ? -1 : 1;
+}
+
+/* Load the function symbols of an ELF file, returning 0 or -1 on error */
+int elf_load_symbols(const char *path, elf_symtab_t *symtab)
+{
+    FILE *fp = fopen(path, "rb");
+
+    memset(symtab, 0, sizeof(*symtab));
+
+    if(!fp)
+    {
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    elf_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    elf = malloc(elf_size > 0 ? elf_size : 1);
+
+    if(!elf || fread(elf, 1, elf_size, fp) != elf_size || elf_size < 64 || memcmp(elf, "\177ELF", 4))
+    {
+        fclose(fp);
+        free(elf);
+        return -1;
+    }
+
+    fclose(fp);
+
+    is64 = (elf[EI_CLASS] == ELFCLASS64);
+    msb = (elf[EI_DATA] == ELFDATA2MSB);
+
+    long shoff = get_word(is64 ? 0x28 : 0x20);
+    int shentsize = get(is64 ? 0x3A : 0x2E, 2);
+    int shnum = get(is64 ? 0x3C : 0x30, 2);
+    int max = 0;
+
+    for(int i = 0; i < shnum; i++)
+    {
+        long sh = shoff + (long)i * shentsize;
+
+        if(get(sh + 4, 4) != SHT_SYMTAB)
+        {
+            continue;
+        }
+
+        long offset = get_word(sh + (is64 ? 0x18 : 0x10));
+        long size = get_word(sh + (is64 ? 0x20 : 0x14));
+        int link = get(sh + (is64 ? 0x28 : 0x18), 4);
+        long entsize = get_word(sh + (is64 ? 0x38 : 0x24));
+        long strtab = get_word(shoff + (long)link * shentsize + (is64 ? 0x18 : 0x10));
+
+        if(!entsize)
+        {
+            continue;
+        }
+
+        for(long sym = offset; sym + entsize <= offset + size; sym += entsize)
+        {
+            uint32_t name = get(sym, 4);
+            int info = get(sym + (is64 ? 4 : 12), 1);
+            uint32_t value = get_word(sym + (is64 ? 8 : 4));
+            uint32_t symsize = get_word(sym + (is64 ? 16 : 8));
+            int shndx = get(sym + (is64 ? 6 : 14), 2);
+
+            if((info & 0xF) != STT_FUNC || shndx == SHN_UNDEF || strtab + name >= elf_size)
+            {
+                continue;
+            }
+
+            if(symtab->count == max)
+            {
+                max = max ? max * 2 : 1024;
+                symtab->syms = realloc(symtab->syms, max * sizeof(elf_symbol_t));
+            }
+
+            symtab->syms[symtab->count].addr = value;
+            symtab->syms[symtab->count].size = symsize;
+            symtab->syms[symtab->count].name = (const char *)elf + strtab + name;
+            symtab->count++;
+        }
+    }
+
+    qsort(symtab->syms, symtab->count, sizeof(elf_symbol_t), compare_symbols);
+
+    /* Drop aliases and give unsized symbols the room up to the next one */
+    int out = 0;
+
+    for(int i = 0; i < symtab->count; i++)
+    {
+        if(out && symtab->syms[out - 1].addr == symtab->syms[i].addr)
+        {
+            continue;
+        }
+
+        symtab->syms[out++] = symtab->syms[i];
+    }
+
+    symtab->count = out;
+
+    for(int i = 0; i < symtab->count; i++)
+    {
+        if(!symtab->syms[i].size && i + 1 < symtab->count)
+        {
+            symtab->syms[i].size = symtab->syms[i + 1].addr - symtab->syms[i].addr;
+        }
+    }
+
+    symtab->data = elf;
+
+    return symtab->count ? 0 : -1;
+}
+
+/* Find the function containing an address, or NULL */
+const elf_symbol_t *elf_find_symbol(const elf_symtab_t *symtab, uint32_t addr)
+{
+    int lo = 0;
+    int hi = symtab->count - 1;
+
+    while(lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        const elf_symbol_t *sym = &symtab->syms[mid];
+
+        if(addr < sym->addr)
+        {
+            hi = mid - 1;
+        }
+        else if(addr - sym->addr >= sym->size)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            return sym;
+        }
+    }
+
+    return NULL;
+}
+
+void elf_free_symbols(elf_symtab_t *symtab)
+{
+    free(symtab->syms);
+    free(symtab->data);
+    memset(symtab, 0, sizeof(*symtab));
+}
@@ -0,0 +1,26 @@
+#ifndef __ELFSYM_H
+#define __ELFSYM_H
+
+#include <stdint.h>
+
+/* A function symbol from an ELF file */
+typedef struct
+{
+    uint32_t addr;
+    uint32_t size;
+    const char *name;
+} elf_symbol_t;
+
+/* Function symbols of an ELF file, sorted by address */
+typedef struct
+{
+    elf_symbol_t *syms;
+    int count;
+    uint8_t *data;
+} elf_symtab_t;
+
+int elf_load_symbols(const char *path, elf_symtab_t *symtab);
+const elf_symbol_t *elf_find_symbol(const elf_symtab_t *symtab, uint32_t addr);
+void elf_free_symbols(elf_symtab_t *symtab);
+
+#endif
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include "profile.h"
+#include "elfsym.h"
+
+#if BYTE_ORDER == BIG_ENDIAN
+#define SWAPLONG(i) (i)
+#define SWAPSHORT(i) (i)
+#else
+#define SWAPLONG(i) (((uint32_t)(i & 0xFF000000) >> 24) | ((uint32_t)(i & 0x00FF0000) >>  8) | ((uint32_t)(i & 0x0000FF00) <<  8) | ((uint32_t)(i & 0x000000FF) << 24))
+#define SWAPSHORT(i) ((uint16_t)(((uint16_t)(i) >> 8) | ((uint16_t)(i) << 8)))
+#endif
+
+/* Samples attributed to one function, or to one caller and callee pair */
+typedef struct
+{
+    char *name;
+    uint32_t count;
+} entry_t;
+
+static entry_t *entries = NULL;
+static int num_entries = 0;
+
+void print_usage(char *name)
+{
+    fprintf(stderr, "Usage: %s [-f] <program elf> <profile dump>\n", name);
+    fprintf(stderr, "\nSymbolizes a dump written by profile_dump or profile_dump_usb.\n");
+    fprintf(stderr, "Prints a flat profile by default, or with -f folded stacks for\n");
+    fprintf(stderr, "flamegraph.pl and speedscope.\n");
+}
+
+/* Read a whole file into memory, returning its size or -1 */
+long read_file(const char *path, uint8_t **out)
+{
+    FILE *fp = fopen(path, "rb");
+    long size;
+
+    if(!fp)
+    {
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    *out = malloc(size > 0 ? size : 1);
+
+    if(!*out || fread(*out, 1, size, fp) != size)
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    return size;
+}
+
+/* Name of the function containing an address, or the address itself */
+const char *symbolize(const elf_symtab_t *symtab, uint32_t addr, char *buf)
+{
+    const elf_symbol_t *sym = elf_find_symbol(symtab, addr);
+
+    if(sym)
+    {
+        return sym->name;
+    }
+
+    sprintf(buf, "0x%08x", addr);
+    return buf;
+}
+
+/* Add samples to the entry with the given name */
+void add_entry(const char *name, uint32_t count)
+{
+    static int max = 0;
+
+    for(int i = 0; i < num_entries; i++)
+    {
+        if(!strcmp(entries[i].name, name))
+        {
+            entries[i].count += count;
+            return;
+        }
+    }
+
+    if(num_entries == max)
+    {
+        max = max ? max * 2 : 256;
+        entries = realloc(entries, max * sizeof(entry_t));
+    }
+
+    entries[num_entries].name = strdup(name);
+    entries[num_entries].count = count;
+    num_entries++;
+}
+
+int compare_entries(const void *a, const void *b)
+{
+    const entry_t *ea = a;
+    const entry_t *eb = b;
+
+    if(ea->count != eb->count)
+    {
+        return ea->count > eb->count ? -1 : 1;
+    }
+
+    return strcmp(ea->name, eb->name);
+}
+
+int main(int argc, char *argv[])
+{
+    elf_symtab_t symtab;
+    uint8_t *data;
+    long size;
+    int folded = 0;
+    int arg = 1;
+
+    if(argc > 1 && !strcmp(argv[1], "-f"))
+    {
+        folded = 1;
+        arg++;
+    }
+
+    if(argc - arg != 2)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    if(elf_load_symbols(argv[arg], &symtab) < 0)
+    {
+        fprintf(stderr, "Cannot read function symbols from %s!\n", argv[arg]);
+        return -1;
+    }
+
+    size = read_file(argv[arg + 1], &data);
+
+    if(size < 0)
+    {
+        fprintf(stderr, "Cannot read %s!\n", argv[arg + 1]);
+        return -1;
+    }
+
+    profile_header_t *header = (profile_header_t *)data;
+
+    if(size < sizeof(profile_header_t) || SWAPLONG(header->magic) != PROFILE_MAGIC ||
+       SWAPSHORT(header->version) != PROFILE_VERSION || SWAPSHORT(header->slot_size) != sizeof(profile_slot_t))
+    {
+        fprintf(stderr, "%s is not a version %d profile dump!\n", argv[arg + 1], PROFILE_VERSION);
+        return -1;
+    }
+
+    uint32_t hz = SWAPLONG(header->hz);
+    uint32_t num_slots = SWAPLONG(header->num_slots);
+    uint32_t samples = SWAPLONG(header->samples);
+    uint32_t dropped = SWAPLONG(header->dropped);
+    profile_slot_t *slots = (profile_slot_t *)(header + 1);
+
+    if(size < sizeof(profile_header_t) + (long)num_slots * sizeof(profile_slot_t))
+    {
+        fprintf(stderr, "%s is truncated!\n", argv[arg + 1]);
+        return -1;
+    }
+
+    for(uint32_t i = 0; i < num_slots; i++)
+    {
+        uint32_t pc = SWAPLONG(slots[i].pc);
+        uint32_t ra = SWAPLONG(slots[i].ra);
+        uint32_t count = SWAPLONG(slots[i].count);
+        char pc_buf[16];
+        const char *func = symbolize(&symtab, pc, pc_buf);
+
+        if(!folded)
+        {
+            add_entry(func, count);
+            continue;
+        }
+
+        /* The return address is the caller unless it points back into the
+           function itself, which happens once that function made a call */
+        const elf_symbol_t *callee = elf_find_symbol(&symtab, pc);
+        const elf_symbol_t *caller = elf_find_symbol(&symtab, ra - 8);
+
+        if(caller && caller != callee)
+        {
+            char *line = malloc(strlen(caller->name) + strlen(func) + 2);
+
+            sprintf(line, "%s;%s", caller->name, func);
+            add_entry(line, count);
+            free(line);
+        }
+        else
+        {
+            add_entry(func, count);
+        }
+    }
+
+    qsort(entries, num_entries, sizeof(entry_t), compare_entries);
+
+    if(folded)
+    {
+        for(int i = 0; i < num_entries; i++)
+        {
+            printf("%s %u\n", entries[i].name, entries[i].count);
+        }
+    }
+    else
+    {
+        uint32_t counted = samples - dropped;
+
+        printf("%u samples at %u Hz, %.2f seconds", samples, hz, hz ? (double)samples / hz : 0.0);
+
+        if(dropped)
+        {
+            printf(", %u dropped because the histogram was full", dropped);
+        }
+
+        printf("\n\n  %%time   samples  function\n");
+
+        for(int i = 0; i < num_entries; i++)
+        {
+            printf("%7.2f %9u  %s\n", counted ? entries[i].count * 100.0 / counted : 0.0, entries[i].count, entries[i].name);
+        }
+    }
+
+    elf_free_symbols(&symtab);
+    free(data);
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include "trace.h"
+
+#if BYTE_ORDER == BIG_ENDIAN
+#define SWAPLONG(i) (i)
+#define SWAPSHORT(i) (i)
+#else
+#define SWAPLONG(i) (((uint32_t)(i & 0xFF000000) >> 24) | ((uint32_t)(i & 0x00FF0000) >>  8) | ((uint32_t)(i & 0x0000FF00) <<  8) | ((uint32_t)(i & 0x000000FF) << 24))
+#define SWAPSHORT(i) ((uint16_t)(((uint16_t)(i) >> 8) | ((uint16_t)(i) << 8)))
+#endif
+
+void print_usage(char *name)
+{
+    fprintf(stderr, "Usage: %s <trace dump> [<output json>]\n", name);
+    fprintf(stderr, "\nConverts a trace dump written by trace_dump or trace_dump_usb into\n");
+    fprintf(stderr, "Chrome trace JSON, for chrome://tracing or Perfetto.\n");
+}
+
+/* Read a whole file into memory, returning its size or -1 */
+long read_file(const char *path, uint8_t **out)
+{
+    FILE *fp = fopen(path, "rb");
+    long size;
+
+    if(!fp)
+    {
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    *out = malloc(size > 0 ? size : 1);
+
+    if(!*out || fread(*out, 1, size, fp) != size)
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    return size;
+}
+
+/* Print a string as a JSON string literal */
+void print_string(FILE *out, const char *str)
+{
+    fputc('"', out);
+
+    for(; *str; str++)
+    {
+        if(*str == '"' || *str == '\\')
+        {
+            fprintf(out, "\\%c", *str);
+        }
+        else if((unsigned char)*str < 0x20)
+        {
+            fprintf(out, "\\u%04x", (unsigned char)*str);
+        }
+        else
+        {
+            fputc(*str, out);
+        }
+    }
+
+    fputc('"', out);
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t *data;
+    long size;
+    FILE *out = stdout;
+
+    if(argc < 2 || argc > 3)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    size = read_file(argv[1], &data);
+
+    if(size < 0)
+    {
+        fprintf(stderr, "Cannot read %s!\n", argv[1]);
+        return -1;
+    }
+
+    if(size < sizeof(trace_header_t))
+    {
+        fprintf(stderr, "%s is too short to be a trace dump!\n", argv[1]);
+        return -1;
+    }
+
+    trace_header_t *header = (trace_header_t *)data;
+    uint32_t magic = SWAPLONG(header->magic);
+    uint16_t version = SWAPSHORT(header->version);
+    uint16_t event_size = SWAPSHORT(header->event_size);
+    uint32_t ticks_per_second = SWAPLONG(header->ticks_per_second);
+    uint32_t num_names = SWAPLONG(header->num_names);
+    uint32_t num_events = SWAPLONG(header->num_events);
+    uint32_t overwritten = SWAPLONG(header->overwritten);
+
+    if(magic != TRACE_MAGIC || version != TRACE_VERSION || event_size != sizeof(trace_event_t))
+    {
+        fprintf(stderr, "%s is not a version %d trace dump!\n", argv[1], TRACE_VERSION);
+        return -1;
+    }
+
+    if(!ticks_per_second || num_names > TRACE_MAX_NAMES ||
+       size < sizeof(trace_header_t) + (long)num_names * TRACE_NAME_LEN + (long)num_events * event_size)
+    {
+        fprintf(stderr, "%s is truncated or corrupt!\n", argv[1]);
+        return -1;
+    }
+
+    char *names = (char *)(header + 1);
+    trace_event_t *events = (trace_event_t *)(names + num_names * TRACE_NAME_LEN);
+
+    /* Names are stored padded, but make sure they are terminated */
+    for(int i = 0; i < num_names; i++)
+    {
+        names[i * TRACE_NAME_LEN + TRACE_NAME_LEN - 1] = 0;
+    }
+
+    if(argc == 3)
+    {
+        out = fopen(argv[2], "w");
+
+        if(!out)
+        {
+            fprintf(stderr, "Cannot open %s for writing!\n", argv[2]);
+            return -1;
+        }
+    }
+
+    if(overwritten)
+    {
+        fprintf(stderr, "%u older events were overwritten before the dump\n", overwritten);
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    /* Track 0 is normal code, the others are interrupt nesting levels */
+    int tracks = 1;
+
+    for(uint32_t i = 0; i < num_events; i++)
+    {
+        if(events[i].track >= tracks)
+        {
+            tracks = events[i].track + 1;
+        }
+    }
+
+    for(int i = 0; i < tracks; i++)
+    {
+        if(i)
+        {
+            fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"interrupt %d\"}},\n", i, i);
+        }
+        else
+        {
+            fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"main\"}},\n");
+        }
+    }
+
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"N64\"}}");
+
+    /* Event times are the low 32 bits of the tick count, which wrap every
+       ninety seconds or so, so rebuild the full count from the differences */
+    uint64_t ticks = 0;
+    uint32_t last = num_events ? SWAPLONG(events[0].time) : 0;
+
+    for(uint32_t i = 0; i < num_events; i++)
+    {
+        trace_event_t *ev = &events[i];
+        uint32_t time = SWAPLONG(ev->time);
+        uint16_t id = SWAPSHORT(ev->id);
+        int32_t value = (int32_t)SWAPLONG((uint32_t)ev->value);
+        const char *name = id < num_names ? &names[id * TRACE_NAME_LEN] : "unknown";
+
+        ticks += (uint32_t)(time - last);
+        last = time;
+
+        fprintf(out, ",\n{\"name\":");
+        print_string(out, name);
+        fprintf(out, ",\"ts\":%.3f,\"pid\":0,\"tid\":%d", ticks * 1000000.0 / ticks_per_second, ev->track);
+
+        switch(ev->type)
+        {
+            case TRACE_EVENT_BEGIN:
+                fprintf(out, ",\"ph\":\"B\"}");
+                break;
+            case TRACE_EVENT_END:
+                fprintf(out, ",\"ph\":\"E\"}");
+                break;
+            case TRACE_EVENT_COUNTER:
+                fprintf(out, ",\"ph\":\"C\",\"args\":{\"value\":%d}}", value);
+                break;
+            default:
+                fprintf(out, ",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"value\":%d}}", value);
+                break;
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+
+    free(data);
+
+    return 0;
+}